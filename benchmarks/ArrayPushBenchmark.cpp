@@ -0,0 +1,109 @@
+/*---[ArrayPushBenchmark.cpp]----------------------------------m(._.)m--------*\
+ |
+ |  Project   : KFoundation
+ |  Declares  : -
+ |  Implements: main()
+ |
+ |  Copyright (c) 2013, 2014, 2015, RIKEN (The Institute of Physical and
+ |  Chemial Research) All rights reserved.
+ |
+ |  Author: Hamed KHANDAN (hamed.khandan@port.kobe-u.ac.jp)
+ |
+ |  This file is distributed under the KnoRBA Free Public License. See
+ |  LICENSE.TXT for details.
+ |
+ *//////////////////////////////////////////////////////////////////////////////
+
+// Compares Array::push() with std::vector::push_back(), starting from an
+// empty container each time, for a trivially copyable type (int) and for one
+// that is not (std::string). Prints the best of several repetitions.
+
+// Std
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// KFoundation
+#include <kfoundation/Ptr.h>
+#include <kfoundation/Array.h>
+
+// Internal
+#include "Benchmark.h"
+
+using namespace kfoundation;
+
+const int N_REPETITIONS = 5;
+const int N_INTS = 10000000;
+const int N_STRINGS = 1000000;
+
+
+double pushIntsToArray() {
+  double start = Benchmark::getTime();
+  Ptr< Array<int> > a(new Array<int>());
+  for(int i = 0; i < N_INTS; i++) {
+    a->push(i);
+  }
+  return Benchmark::getTime() - start;
+}
+
+
+double pushIntsToVector() {
+  double start = Benchmark::getTime();
+  std::vector<int> v;
+  for(int i = 0; i < N_INTS; i++) {
+    v.push_back(i);
+  }
+  return Benchmark::getTime() - start;
+}
+
+
+double pushStringsToArray(const std::string& s) {
+  double start = Benchmark::getTime();
+  Ptr< Array<std::string> > a(new Array<std::string>());
+  for(int i = 0; i < N_STRINGS; i++) {
+    a->push(s);
+  }
+  return Benchmark::getTime() - start;
+}
+
+
+double pushStringsToVector(const std::string& s) {
+  double start = Benchmark::getTime();
+  std::vector<std::string> v;
+  for(int i = 0; i < N_STRINGS; i++) {
+    v.push_back(s);
+  }
+  return Benchmark::getTime() - start;
+}
+
+
+double best(double current, double t) {
+  return current < 0 || t < current ? t : current;
+}
+
+
+int main() {
+  // Longer than the small string buffer, so every copy allocates.
+  const std::string s("a string that does not fit in the object itself");
+
+  double tArrayInt = -1;
+  double tVectorInt = -1;
+  double tArrayString = -1;
+  double tVectorString = -1;
+
+  for(int r = 0; r < N_REPETITIONS; r++) {
+    tArrayInt = best(tArrayInt, pushIntsToArray());
+    tVectorInt = best(tVectorInt, pushIntsToVector());
+    tArrayString = best(tArrayString, pushStringsToArray(s));
+    tVectorString = best(tVectorString, pushStringsToVector(s));
+  }
+
+  printf("%-12s %10s %14s %14s\n", "element", "count", "Array (ms)",
+      "vector (ms)");
+  printf("%-12s %10d %14.1f %14.1f\n", "int", N_INTS, tArrayInt * 1e3,
+      tVectorInt * 1e3);
+  printf("%-12s %10d %14.1f %14.1f\n", "std::string", N_STRINGS,
+      tArrayString * 1e3, tVectorString * 1e3);
+
+  return 0;
+}
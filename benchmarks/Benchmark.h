@@ -0,0 +1,162 @@
+/*---[Benchmark.h]---------------------------------------------m(._.)m--------*\
+ |
+ |  Project   : KFoundation
+ |  Declares  : Benchmark::*
+ |  Implements: Benchmark::*
+ |
+ |  Copyright (c) 2013, 2014, 2015, RIKEN (The Institute of Physical and
+ |  Chemial Research) All rights reserved.
+ |
+ |  Author: Hamed KHANDAN (hamed.khandan@port.kobe-u.ac.jp)
+ |
+ |  This file is distributed under the KnoRBA Free Public License. See
+ |  LICENSE.TXT for details.
+ |
+ *//////////////////////////////////////////////////////////////////////////////
+
+#ifndef KFOUNDATION_BENCHMARK
+#define KFOUNDATION_BENCHMARK
+
+// Posix
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+// Std
+#include <cstdlib>
+#include <cstdio>
+#include <vector>
+
+/**
+ * Helpers shared by the benchmarks in this directory. Each benchmark is a
+ * standalone program that prints one line per measurement. For meaningful
+ * numbers, the library should be built with optimization, e.g. by
+ * configuring with `-DCMAKE_BUILD_TYPE=Release`.
+ */
+
+class Benchmark {
+
+// --- NESTED TYPES --- //
+
+  /**
+   * Work to be run on several threads at once by runOnThreads().
+   */
+
+  public: class Task {
+    public: virtual ~Task() {}
+
+    /**
+     * Runs the measured work. Called once on each thread.
+     *
+     * @param thread The index of the calling thread, from 0.
+     * @param nThreads The number of threads.
+     */
+
+    public: virtual void run(const int thread, const int nThreads) = 0;
+  };
+
+  private: struct Worker {
+    Task* task;
+    pthread_barrier_t* barrier;
+    int thread;
+    int nThreads;
+  };
+
+
+// --- STATIC METHODS --- //
+
+  private: static void* runWorker(void* arg) {
+    Worker* w = (Worker*)arg;
+    pthread_barrier_wait(w->barrier);
+    w->task->run(w->thread, w->nThreads);
+    return NULL;
+  }
+
+
+  /**
+   * Returns the current time in seconds, with microsecond resolution.
+   */
+
+  public: static double getTime() {
+    timeval t;
+    gettimeofday(&t, NULL);
+    return t.tv_sec + t.tv_usec * 1e-6;
+  }
+
+
+  /**
+   * Returns the number of processor cores online.
+   */
+
+  public: static int getNumberOfCores() {
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int)n : 1;
+  }
+
+
+  /**
+   * Returns the peak resident set size of this process in kilobytes.
+   */
+
+  public: static long getPeakRss() {
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+  }
+
+
+  /**
+   * Returns the thread counts to measure scaling with: powers of two up to
+   * the number of cores, and the number of cores itself. At least
+   * `minCount` is included even on smaller machines.
+   */
+
+  public: static std::vector<int> getThreadCounts(const int minCount = 4) {
+    int max = getNumberOfCores();
+    if(max < minCount) {
+      max = minCount;
+    }
+
+    std::vector<int> counts;
+    for(int n = 1; n < max; n *= 2) {
+      counts.push_back(n);
+    }
+    counts.push_back(max);
+    return counts;
+  }
+
+
+  /**
+   * Runs the given task on `nThreads` threads, which start together, and
+   * returns the time in seconds until all of them have finished.
+   */
+
+  public: static double runOnThreads(Task& task, const int nThreads) {
+    std::vector<pthread_t> threads(nThreads);
+    std::vector<Worker> workers(nThreads);
+    pthread_barrier_t barrier;
+    pthread_barrier_init(&barrier, NULL, nThreads + 1);
+
+    for(int i = 0; i < nThreads; i++) {
+      workers[i].task = &task;
+      workers[i].barrier = &barrier;
+      workers[i].thread = i;
+      workers[i].nThreads = nThreads;
+      pthread_create(&threads[i], NULL, &Benchmark::runWorker, &workers[i]);
+    }
+
+    double start = getTime();
+    pthread_barrier_wait(&barrier);
+    for(int i = 0; i < nThreads; i++) {
+      pthread_join(threads[i], NULL);
+    }
+    double elapsed = getTime() - start;
+
+    pthread_barrier_destroy(&barrier);
+    return elapsed;
+  }
+
+};
+
+#endif /* defined(KFOUNDATION_BENCHMARK) */
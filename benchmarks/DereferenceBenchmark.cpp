@@ -0,0 +1,105 @@
+/*---[DereferenceBenchmark.cpp]--------------------------------m(._.)m--------*\
+ |
+ |  Project   : KFoundation
+ |  Declares  : -
+ |  Implements: main()
+ |
+ |  Copyright (c) 2013, 2014, 2015, RIKEN (The Institute of Physical and
+ |  Chemial Research) All rights reserved.
+ |
+ |  Author: Hamed KHANDAN (hamed.khandan@port.kobe-u.ac.jp)
+ |
+ |  This file is distributed under the KnoRBA Free Public License. See
+ |  LICENSE.TXT for details.
+ |
+ *//////////////////////////////////////////////////////////////////////////////
+
+// Measures the time of Ptr::operator->() by summing a field over an array of
+// pointers many times, once in order and once in a shuffled order. With many
+// live objects, shuffled access is dominated by how many cache lines each
+// validation touches in the object table. Build once as is and once with
+// KF_PTR_UNCHECKED to compare the checked and the unchecked dereference.
+
+// Std
+#include <cstdio>
+
+// KFoundation
+#include <kfoundation/Ptr.h>
+#include <kfoundation/ManagedObject.h>
+
+// Internal
+#include "Benchmark.h"
+
+using namespace kfoundation;
+
+const int N_DEREFERENCES = 300000000;
+
+class Item : public ManagedObject {
+  public: kf_int32_t value;
+};
+
+
+void measure(const char* mode, const int n, const bool isShuffled) {
+  Ptr<Item>* items = new Ptr<Item>[n];
+  for(int i = 0; i < n; i++) {
+    items[i] = new Item();
+    items[i]->value = i;
+  }
+
+  // Shuffled with a fixed linear congruential sequence, so that every run
+  // visits the objects in the same order.
+  int* order = new int[n];
+  for(int i = 0; i < n; i++) {
+    order[i] = i;
+  }
+  if(isShuffled) {
+    unsigned int seed = 12345;
+    for(int i = n - 1; i > 0; i--) {
+      seed = seed * 1103515245 + 12345;
+      int j = (int)((seed >> 8) % (unsigned int)(i + 1));
+      int tmp = order[i];
+      order[i] = order[j];
+      order[j] = tmp;
+    }
+  }
+
+  kf_int64_t sum = 0;
+  double start = Benchmark::getTime();
+  for(int r = 0; r < N_DEREFERENCES / n; r++) {
+    for(int i = 0; i < n; i++) {
+      sum += items[order[i]]->value;
+    }
+  }
+  double t = Benchmark::getTime() - start;
+  int nDereferences = (N_DEREFERENCES / n) * n;
+
+  printf("%-10s %8d %-9s %14.2f %14ld\n", mode, n,
+      isShuffled ? "shuffled" : "in order", t / nDereferences * 1e9,
+      (long)sum);
+
+  delete[] order;
+  delete[] items;
+}
+
+
+int main() {
+  #ifdef KF_PTR_UNCHECKED
+  const char* mode = "unchecked";
+  #else
+  const char* mode = "checked";
+  #endif
+
+  // The narrow record layout limits a manager to 32768 records.
+  const int objectCounts[] = {1000, 30000};
+  const int nCounts = sizeof(objectCounts) / sizeof(int);
+
+  printf("%-10s %8s %-9s %14s %14s\n", "mode", "objects", "order",
+      "ns/deref", "checksum");
+
+  for(int c = 0; c < nCounts; c++) {
+    measure(mode, objectCounts[c], false);
+    measure(mode, objectCounts[c], true);
+  }
+
+  return 0;
+}
@@ -0,0 +1,84 @@
+/*---[ObjectRecordStressTest.cpp]------------------------------m(._.)m--------*\
+ |
+ |  Project   : KFoundation
+ |  Declares  : -
+ |  Implements: main()
+ |
+ |  Copyright (c) 2013, 2014, 2015, RIKEN (The Institute of Physical and
+ |  Chemial Research) All rights reserved.
+ |
+ |  Author: Hamed KHANDAN (hamed.khandan@port.kobe-u.ac.jp)
+ |
+ |  This file is distributed under the KnoRBA Free Public License. See
+ |  LICENSE.TXT for details.
+ |
+ *//////////////////////////////////////////////////////////////////////////////
+
+// Registers 10M objects at once, or the given number, checks that each is
+// reachable through its pointer, and releases them all. Requires the wide
+// record layout (KF_WIDE_OBJECT_RECORD); with the narrow layout the count is
+// limited to what a single manager can hold. Exits with a non-zero status on
+// failure.
+
+// Std
+#include <cstdio>
+#include <cstdlib>
+
+// KFoundation
+#include <kfoundation/System.h>
+#include <kfoundation/MasterMemoryManager.h>
+#include <kfoundation/Ptr.h>
+#include <kfoundation/ManagedObject.h>
+
+// Internal
+#include "Benchmark.h"
+
+using namespace kfoundation;
+
+class Item : public ManagedObject {
+  public: kf_int32_t value;
+};
+
+
+int main(int argc, char** argv) {
+  int n = argc > 1 ? atoi(argv[1]) : 10000000;
+
+  if(sizeof(kf_objectindex_t) < 4 && n > 32000) {
+    printf("Built without KF_WIDE_OBJECT_RECORD, registering 32000 objects "
+        "instead of %d.\n", n);
+    n = 32000;
+  }
+
+  MemoryManager* manager
+      = System::getMasterMemoryManager().getManagerAtIndex(0);
+  kf_int64_t nBefore = manager->getStats().nObjects;
+
+  double start = Benchmark::getTime();
+  Ptr<Item>* items = new Ptr<Item>[n];
+  for(int i = 0; i < n; i++) {
+    items[i] = new Item();
+    items[i]->value = i;
+  }
+  double tRegister = Benchmark::getTime() - start;
+
+  kf_int64_t nAlive = manager->getStats().nObjects - nBefore;
+  int nFailed = 0;
+  for(int i = 0; i < n; i++) {
+    if(!items[i].isValid() || items[i]->value != i) {
+      nFailed++;
+    }
+  }
+
+  start = Benchmark::getTime();
+  delete[] items;
+  double tRelease = Benchmark::getTime() - start;
+
+  kf_int64_t nLeft = manager->getStats().nObjects - nBefore;
+
+  printf("objects: %d, alive: %ld, invalid: %d, left after release: %ld\n",
+      n, (long)nAlive, nFailed, (long)nLeft);
+  printf("register: %.2f s, release: %.2f s, peak RSS: %ld MB\n", tRegister,
+      tRelease, Benchmark::getPeakRss() / 1024);
+
+  return nAlive == n && nFailed == 0 && nLeft == 0 ? 0 : 1;
+}
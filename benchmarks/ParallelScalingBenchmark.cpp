@@ -0,0 +1,124 @@
+/*---[ParallelScalingBenchmark.cpp]----------------------------m(._.)m--------*\
+ |
+ |  Project   : KFoundation
+ |  Declares  : -
+ |  Implements: main()
+ |
+ |  Copyright (c) 2013, 2014, 2015, RIKEN (The Institute of Physical and
+ |  Chemial Research) All rights reserved.
+ |
+ |  Author: Hamed KHANDAN (hamed.khandan@port.kobe-u.ac.jp)
+ |
+ |  This file is distributed under the KnoRBA Free Public License. See
+ |  LICENSE.TXT for details.
+ |
+ *//////////////////////////////////////////////////////////////////////////////
+
+// Measures how Parallel::sort, transform, reduce and inclusiveScan scale with
+// the number of threads, on 4M ints. A ThreadPool of each size in
+// Benchmark::getThreadCounts() is used in turn. std::sort is measured once as
+// a serial reference. The times of transform, reduce and scan are averages
+// over several calls.
+
+// Std
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+
+// KFoundation
+#include <kfoundation/Ptr.h>
+#include <kfoundation/Array.h>
+#include <kfoundation/ThreadPool.h>
+#include <kfoundation/Parallel.h>
+
+// Internal
+#include "Benchmark.h"
+
+using namespace kfoundation;
+
+const int N_ELEMENTS = 4000000;
+const int N_REPETITIONS = 20;
+
+// Keeps the result of reduce observable, so it is not optimized out.
+volatile kf_int32_t sink;
+
+struct Square {
+  kf_int32_t operator()(const kf_int32_t x) const {
+    return (x % 1000) * (x % 1000);
+  }
+};
+
+// Adds with wrap-around, since the sums of the input overflow.
+struct Plus {
+  kf_int32_t operator()(const kf_int32_t a, const kf_int32_t b) const {
+    return (kf_int32_t)((unsigned int)a + (unsigned int)b);
+  }
+};
+
+
+void copy(const Array<kf_int32_t>& source, Array<kf_int32_t>& target) {
+  target.setSize(source.getSize());
+  memcpy(target.getData(), source.getData(),
+      source.getSize() * sizeof(kf_int32_t));
+}
+
+
+void report(const char* algorithm, const int nThreads, const double t) {
+  printf("%-10s %8d %12.2f\n", algorithm, nThreads, t * 1e3);
+}
+
+
+int main() {
+  Ptr< Array<kf_int32_t> > input(new Array<kf_int32_t>());
+  Ptr< Array<kf_int32_t> > output(new Array<kf_int32_t>());
+  input->setSize(N_ELEMENTS);
+
+  unsigned int seed = 12345;
+  for(int i = 0; i < N_ELEMENTS; i++) {
+    seed = seed * 1103515245 + 12345;
+    input->at(i) = (kf_int32_t)(seed >> 1);
+  }
+
+  printf("%-10s %8s %12s\n", "algorithm", "threads", "time (ms)");
+
+  copy(*input, *output);
+  double start = Benchmark::getTime();
+  std::sort(output->getData(), output->getData() + N_ELEMENTS);
+  report("std::sort", 1, Benchmark::getTime() - start);
+
+  std::vector<int> counts = Benchmark::getThreadCounts();
+  for(size_t c = 0; c < counts.size(); c++) {
+    ThreadPool pool(counts[c]);
+
+    copy(*input, *output);
+    start = Benchmark::getTime();
+    Parallel::sort(*output, Parallel::DEFAULT_GRAIN, pool);
+    report("sort", counts[c], Benchmark::getTime() - start);
+
+    start = Benchmark::getTime();
+    for(int r = 0; r < N_REPETITIONS; r++) {
+      Parallel::transform(*input, *output, Square(), Parallel::DEFAULT_GRAIN,
+          pool);
+    }
+    report("transform", counts[c],
+        (Benchmark::getTime() - start) / N_REPETITIONS);
+
+    start = Benchmark::getTime();
+    for(int r = 0; r < N_REPETITIONS; r++) {
+      sink = Parallel::reduce(*output, 0, Plus(), Parallel::DEFAULT_GRAIN,
+          pool);
+    }
+    report("reduce", counts[c],
+        (Benchmark::getTime() - start) / N_REPETITIONS);
+
+    start = Benchmark::getTime();
+    for(int r = 0; r < N_REPETITIONS; r++) {
+      Parallel::inclusiveScan(*input, *output, Plus(),
+          Parallel::DEFAULT_GRAIN, pool);
+    }
+    report("scan", counts[c],
+        (Benchmark::getTime() - start) / N_REPETITIONS);
+  }
+
+  return 0;
+}
@@ -0,0 +1,107 @@
+/*---[RetainReleaseBenchmark.cpp]------------------------------m(._.)m--------*\
+ |
+ |  Project   : KFoundation
+ |  Declares  : -
+ |  Implements: main()
+ |
+ |  Copyright (c) 2013, 2014, 2015, RIKEN (The Institute of Physical and
+ |  Chemial Research) All rights reserved.
+ |
+ |  Author: Hamed KHANDAN (hamed.khandan@port.kobe-u.ac.jp)
+ |
+ |  This file is distributed under the KnoRBA Free Public License. See
+ |  LICENSE.TXT for details.
+ |
+ *//////////////////////////////////////////////////////////////////////////////
+
+// Measures the throughput of RefCountMemoryManager::retain() and release()
+// from several threads, with the manager's mutex and in lock-free mode. In
+// the "private" case each thread retains and releases its own object; in the
+// "shared" case all threads use the same one.
+
+// Std
+#include <cstdio>
+#include <vector>
+
+// KFoundation
+#include <kfoundation/System.h>
+#include <kfoundation/MasterMemoryManager.h>
+#include <kfoundation/RefCountMemoryManager.h>
+#include <kfoundation/ObjectTable.h>
+#include <kfoundation/Ptr.h>
+
+// Internal
+#include "Benchmark.h"
+
+using namespace kfoundation;
+
+const int N_OPERATIONS = 2000000;
+
+class Item : public ManagedObject {
+  // Nothing;
+};
+
+
+class RetainReleaseTask : public Benchmark::Task {
+  public: RefCountMemoryManager* manager;
+  public: std::vector<kf_int32_t> indexes;
+  public: std::vector<kf_objectkey_t> keys;
+  public: bool isShared;
+
+  public: void run(const int thread, const int) {
+    int i = isShared ? 0 : thread;
+    kf_int32_t index = indexes[i];
+    kf_objectkey_t key = keys[i];
+    for(int k = 0; k < N_OPERATIONS; k++) {
+      manager->retain(index, key);
+      manager->release(index, key);
+    }
+  }
+};
+
+
+int main() {
+  std::vector<int> counts = Benchmark::getThreadCounts();
+  int maxThreads = counts.back();
+
+  // The objects are never released, so they live until the end.
+  std::vector<Item*> items;
+  for(int i = 0; i < maxThreads; i++) {
+    items.push_back(new Item());
+  }
+
+  printf("%-10s %-8s %8s %14s\n", "mode", "objects", "threads",
+      "Mops/s");
+
+  for(int lockFree = 0; lockFree < 2; lockFree++) {
+    RefCountMemoryManager* manager = new RefCountMemoryManager(
+        &System::getMasterMemoryManager(), lockFree == 1);
+
+    // Each object is registered a second time with this manager, holding
+    // one reference that is never released, so it is never deleted here.
+    RetainReleaseTask task;
+    task.manager = manager;
+    for(int i = 0; i < maxThreads; i++) {
+      const ObjectRecordInfo& info = manager->registerObject(items[i]);
+      kf_int32_t index = info.index;
+      ObjectRecord* page
+          = manager->getTable()[index >> KF_OBJECT_TABLE_PAGE_BITS];
+      task.indexes.push_back(index);
+      task.keys.push_back(page[index & KF_OBJECT_TABLE_PAGE_MASK].key);
+    }
+
+    for(int shared = 0; shared < 2; shared++) {
+      task.isShared = shared == 1;
+      for(size_t c = 0; c < counts.size(); c++) {
+        double t = Benchmark::runOnThreads(task, counts[c]);
+        double ops = 2.0 * N_OPERATIONS * counts[c];
+        printf("%-10s %-8s %8d %14.2f\n", lockFree ? "lock-free" : "mutex",
+            shared ? "shared" : "private", counts[c], ops / t * 1e-6);
+      }
+    }
+
+    delete manager;
+  }
+
+  return 0;
+}
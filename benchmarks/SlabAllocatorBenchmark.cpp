@@ -0,0 +1,89 @@
+/*---[SlabAllocatorBenchmark.cpp]------------------------------m(._.)m--------*\
+ |
+ |  Project   : KFoundation
+ |  Declares  : -
+ |  Implements: main()
+ |
+ |  Copyright (c) 2013, 2014, 2015, RIKEN (The Institute of Physical and
+ |  Chemial Research) All rights reserved.
+ |
+ |  Author: Hamed KHANDAN (hamed.khandan@port.kobe-u.ac.jp)
+ |
+ |  This file is distributed under the KnoRBA Free Public License. See
+ |  LICENSE.TXT for details.
+ |
+ *//////////////////////////////////////////////////////////////////////////////
+
+// Compares SlabAllocator with the global `new` operator. Each thread
+// repeatedly allocates a batch of small blocks of mixed sizes and frees them
+// again. Pass "slab" or "malloc" to measure only one of them, so that the
+// reported peak RSS belongs to that allocator alone.
+
+// Std
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+// KFoundation
+#include <kfoundation/SlabAllocator.h>
+
+// Internal
+#include "Benchmark.h"
+
+using namespace kfoundation;
+
+const int N_ROUNDS = 200;
+const int BATCH_SIZE = 10000;
+const size_t SIZES[] = {24, 48, 96, 200};
+const int N_SIZES = sizeof(SIZES) / sizeof(size_t);
+
+class AllocationTask : public Benchmark::Task {
+  public: bool useSlab;
+
+  public: void run(const int, const int) {
+    std::vector<void*> blocks(BATCH_SIZE);
+    for(int r = 0; r < N_ROUNDS; r++) {
+      for(int i = 0; i < BATCH_SIZE; i++) {
+        size_t size = SIZES[i % N_SIZES];
+        blocks[i] = useSlab ? SlabAllocator::allocate(size)
+            : ::operator new(size);
+        *(char*)blocks[i] = (char)i;
+      }
+      for(int i = 0; i < BATCH_SIZE; i++) {
+        if(useSlab) {
+          SlabAllocator::deallocate(blocks[i], SIZES[i % N_SIZES]);
+        } else {
+          ::operator delete(blocks[i]);
+        }
+      }
+    }
+  }
+};
+
+
+int main(int argc, char** argv) {
+  bool runSlab = argc < 2 || strcmp(argv[1], "slab") == 0;
+  bool runMalloc = argc < 2 || strcmp(argv[1], "malloc") == 0;
+
+  std::vector<int> counts = Benchmark::getThreadCounts();
+
+  printf("%-8s %8s %14s %14s\n", "mode", "threads", "ns/alloc+free",
+      "peak RSS (MB)");
+
+  for(int slab = 0; slab < 2; slab++) {
+    if(slab ? !runSlab : !runMalloc) {
+      continue;
+    }
+
+    AllocationTask task;
+    task.useSlab = slab == 1;
+    for(size_t c = 0; c < counts.size(); c++) {
+      double t = Benchmark::runOnThreads(task, counts[c]);
+      double n = (double)N_ROUNDS * BATCH_SIZE * counts[c];
+      printf("%-8s %8d %14.1f %14ld\n", slab ? "slab" : "malloc", counts[c],
+          t / n * 1e9, Benchmark::getPeakRss() / 1024);
+    }
+  }
+
+  return 0;
+}
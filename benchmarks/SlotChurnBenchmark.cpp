@@ -0,0 +1,78 @@
+/*---[SlotChurnBenchmark.cpp]----------------------------------m(._.)m--------*\
+ |
+ |  Project   : KFoundation
+ |  Declares  : -
+ |  Implements: main()
+ |
+ |  Copyright (c) 2013, 2014, 2015, RIKEN (The Institute of Physical and
+ |  Chemial Research) All rights reserved.
+ |
+ |  Author: Hamed KHANDAN (hamed.khandan@port.kobe-u.ac.jp)
+ |
+ |  This file is distributed under the KnoRBA Free Public License. See
+ |  LICENSE.TXT for details.
+ |
+ *//////////////////////////////////////////////////////////////////////////////
+
+// Creates and releases millions of short-lived objects while a number of
+// long-lived survivors are scattered over the object table, every other
+// record being taken. With O(1) slot allocation, the time per object should
+// not depend on the number of survivors.
+
+// Std
+#include <cstdio>
+
+// KFoundation
+#include <kfoundation/System.h>
+#include <kfoundation/MasterMemoryManager.h>
+#include <kfoundation/Ptr.h>
+#include <kfoundation/ManagedObject.h>
+
+// Internal
+#include "Benchmark.h"
+
+using namespace kfoundation;
+
+const int N_OBJECTS = 5000000;
+
+class Item : public ManagedObject {
+  // Nothing;
+};
+
+
+int main() {
+  // The narrow record layout limits a manager to 32768 records.
+  const int survivorCounts[] = {0, 100, 1000, 10000, 16000};
+  const int nCounts = sizeof(survivorCounts) / sizeof(int);
+
+  printf("%10s %14s %14s\n", "survivors", "table size", "ns/object");
+
+  for(int c = 0; c < nCounts; c++) {
+    int nSurvivors = survivorCounts[c];
+
+    // Every other object is released, leaving the survivors scattered.
+    Ptr<Item>* survivors = new Ptr<Item>[2 * nSurvivors];
+    for(int i = 0; i < 2 * nSurvivors; i++) {
+      survivors[i] = new Item();
+    }
+    for(int i = 1; i < 2 * nSurvivors; i += 2) {
+      survivors[i] = (Item*)NULL;
+    }
+
+    double start = Benchmark::getTime();
+    for(int i = 0; i < N_OBJECTS; i++) {
+      Ptr<Item> p(new Item());
+    }
+    double t = Benchmark::getTime() - start;
+
+    MemoryManager* manager = System::getMasterMemoryManager()
+        .getManagerAtIndex(0);
+
+    printf("%10d %14d %14.1f\n", nSurvivors, manager->getTableSize(),
+        t / N_OBJECTS * 1e9);
+
+    delete[] survivors;
+  }
+
+  return 0;
+}
@@ -0,0 +1,91 @@
+/*---[VectorExpressionBenchmark.cpp]---------------------------m(._.)m--------*\
+ |
+ |  Project   : KFoundation
+ |  Declares  : -
+ |  Implements: main()
+ |
+ |  Copyright (c) 2013, 2014, 2015, RIKEN (The Institute of Physical and
+ |  Chemial Research) All rights reserved.
+ |
+ |  Author: Hamed KHANDAN (hamed.khandan@port.kobe-u.ac.jp)
+ |
+ |  This file is distributed under the KnoRBA Free Public License. See
+ |  LICENSE.TXT for details.
+ |
+ *//////////////////////////////////////////////////////////////////////////////
+
+// Computes (a + b - c) * k over vectors of 64K floats in three ways: with
+// the eager methods, each returning a new vector; with the in-place methods,
+// one pass each; and with a single fused expression.
+
+// Std
+#include <cstdio>
+
+// KFoundation
+#include <kfoundation/Ptr.h>
+#include <kfoundation/NumericVector.h>
+
+// Internal
+#include "Benchmark.h"
+
+using namespace kfoundation;
+
+typedef NumericVector<float> Vector;
+
+const int N_ELEMENTS = 65536;
+const int N_REPETITIONS = 2000;
+
+
+int main() {
+  float* values = new float[N_ELEMENTS];
+
+  for(int i = 0; i < N_ELEMENTS; i++) {
+    values[i] = (float)(i % 100);
+  }
+  Ptr<Vector> a(new Vector(values, N_ELEMENTS));
+
+  for(int i = 0; i < N_ELEMENTS; i++) {
+    values[i] = (float)(i % 7);
+  }
+  Ptr<Vector> b(new Vector(values, N_ELEMENTS));
+
+  for(int i = 0; i < N_ELEMENTS; i++) {
+    values[i] = (float)(i % 13);
+  }
+  Ptr<Vector> c(new Vector(values, N_ELEMENTS));
+
+  delete[] values;
+
+  const float k = 0.5f;
+  Ptr<Vector> r(new Vector(a->expr()));
+  double start;
+  double t;
+
+  printf("%-10s %12s %14s\n", "method", "time (ms)", "checksum");
+
+  start = Benchmark::getTime();
+  for(int i = 0; i < N_REPETITIONS; i++) {
+    r = a->add(b)->sub(c)->mul(k);
+  }
+  t = Benchmark::getTime() - start;
+  printf("%-10s %12.1f %14.1f\n", "eager", t * 1e3, r->sum());
+
+  start = Benchmark::getTime();
+  for(int i = 0; i < N_REPETITIONS; i++) {
+    r->assign(a->expr());
+    r->addInPlace(b);
+    r->subInPlace(c);
+    r->mulInPlace(k);
+  }
+  t = Benchmark::getTime() - start;
+  printf("%-10s %12.1f %14.1f\n", "in place", t * 1e3, r->sum());
+
+  start = Benchmark::getTime();
+  for(int i = 0; i < N_REPETITIONS; i++) {
+    r->assign((a->expr() + b->expr() - c->expr()) * k);
+  }
+  t = Benchmark::getTime() - start;
+  printf("%-10s %12.1f %14.1f\n", "fused", t * 1e3, r->sum());
+
+  return 0;
+}
@@ -0,0 +1,138 @@
+/*---[VectorKernelsBenchmark.cpp]------------------------------m(._.)m--------*\
+ |
+ |  Project   : KFoundation
+ |  Declares  : -
+ |  Implements: main()
+ |
+ |  Copyright (c) 2013, 2014, 2015, RIKEN (The Institute of Physical and
+ |  Chemial Research) All rights reserved.
+ |
+ |  Author: Hamed KHANDAN (hamed.khandan@port.kobe-u.ac.jp)
+ |
+ |  This file is distributed under the KnoRBA Free Public License. See
+ |  LICENSE.TXT for details.
+ |
+ *//////////////////////////////////////////////////////////////////////////////
+
+// Measures the throughput of VectorKernels with each instruction set this
+// machine supports, selected with VectorKernels::setIsa(). The arrays are
+// small enough to stay in the L1 and L2 caches, so the numbers reflect the
+// kernels rather than memory bandwidth.
+
+// Std
+#include <cstdio>
+
+// KFoundation
+#include <kfoundation/VectorKernels.h>
+
+// Internal
+#include "Benchmark.h"
+
+using namespace kfoundation;
+
+const int N_ELEMENTS = 4096;
+const int N_REPETITIONS = 50000;
+
+float fa[N_ELEMENTS];
+float fb[N_ELEMENTS];
+float fr[N_ELEMENTS];
+double da[N_ELEMENTS];
+double db[N_ELEMENTS];
+double dr[N_ELEMENTS];
+kf_int32_t ia[N_ELEMENTS];
+kf_int32_t ib[N_ELEMENTS];
+kf_int32_t ir[N_ELEMENTS];
+
+// Keeps the results of reductions observable, so they are not optimized out.
+volatile double sink;
+
+
+void report(const VectorKernels::isa_t isa, const char* kernel, double t) {
+  double elements = (double)N_ELEMENTS * N_REPETITIONS;
+  printf("%-8s %-14s %12.2f\n", VectorKernels::isaToString(isa).c_str(),
+      kernel, elements / t * 1e-9);
+}
+
+
+void measure(const VectorKernels::isa_t isa) {
+  VectorKernels::setIsa(isa);
+  double start;
+  double acc;
+
+  start = Benchmark::getTime();
+  for(int r = 0; r < N_REPETITIONS; r++) {
+    VectorKernels::add(fa, fb, fr, N_ELEMENTS);
+  }
+  report(isa, "float add", Benchmark::getTime() - start);
+
+  start = Benchmark::getTime();
+  for(int r = 0; r < N_REPETITIONS; r++) {
+    VectorKernels::fma(fa, 0.5f, fb, fr, N_ELEMENTS);
+  }
+  report(isa, "float fma", Benchmark::getTime() - start);
+
+  acc = 0;
+  start = Benchmark::getTime();
+  for(int r = 0; r < N_REPETITIONS; r++) {
+    acc += VectorKernels::dot(fa, fb, N_ELEMENTS);
+  }
+  report(isa, "float dot", Benchmark::getTime() - start);
+  sink = acc;
+
+  acc = 0;
+  start = Benchmark::getTime();
+  for(int r = 0; r < N_REPETITIONS; r++) {
+    acc += VectorKernels::sum(fa, N_ELEMENTS);
+  }
+  report(isa, "float sum", Benchmark::getTime() - start);
+  sink = acc;
+
+  start = Benchmark::getTime();
+  for(int r = 0; r < N_REPETITIONS; r++) {
+    VectorKernels::add(da, db, dr, N_ELEMENTS);
+  }
+  report(isa, "double add", Benchmark::getTime() - start);
+
+  acc = 0;
+  start = Benchmark::getTime();
+  for(int r = 0; r < N_REPETITIONS; r++) {
+    acc += VectorKernels::dot(da, db, N_ELEMENTS);
+  }
+  report(isa, "double dot", Benchmark::getTime() - start);
+  sink = acc;
+
+  start = Benchmark::getTime();
+  for(int r = 0; r < N_REPETITIONS; r++) {
+    VectorKernels::add(ia, ib, ir, N_ELEMENTS);
+  }
+  report(isa, "int32 add", Benchmark::getTime() - start);
+
+  acc = 0;
+  start = Benchmark::getTime();
+  for(int r = 0; r < N_REPETITIONS; r++) {
+    acc += VectorKernels::max(ia, N_ELEMENTS);
+  }
+  report(isa, "int32 max", Benchmark::getTime() - start);
+  sink = acc;
+}
+
+
+int main() {
+  for(int i = 0; i < N_ELEMENTS; i++) {
+    fa[i] = (float)(i % 100) * 0.01f;
+    fb[i] = (float)(i % 37) * 0.02f;
+    da[i] = fa[i];
+    db[i] = fb[i];
+    ia[i] = i % 1000;
+    ib[i] = i % 333;
+  }
+
+  printf("%-8s %-14s %12s\n", "isa", "kernel", "Gelem/s");
+
+  VectorKernels::isa_t best = VectorKernels::getBestIsa();
+  for(int isa = VectorKernels::SCALAR; isa <= best; isa++) {
+    measure((VectorKernels::isa_t)isa);
+  }
+
+  return 0;
+}
@@ -0,0 +1,485 @@
+/*---[AllocationProfiler.cpp]----------------------------------m(._.)m--------*\
+ |
+ |  Project   : KFoundation
+ |  Declares  : -
+ |  Implements: kfoundation::AllocationProfiler::*
+ |
+ |  Copyright (c) 2013, 2014, 2015, RIKEN (The Institute of Physical and
+ |  Chemial Research) All rights reserved.
+ |
+ |  Author: Hamed KHANDAN (hamed.khandan@port.kobe-u.ac.jp)
+ |
+ |  This file is distributed under the KnoRBA Free Public License. See
+ |  LICENSE.TXT for details.
+ |
+ *//////////////////////////////////////////////////////////////////////////////
+
+// Std
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <vector>
+#include <algorithm>
+#include <typeinfo>
+
+// Posix
+#include <pthread.h>
+
+// Internal
+#include "System.h"
+#include "ManagedObject.h"
+
+// Self
+#include "AllocationProfiler.h"
+
+namespace kfoundation {
+
+//\/ Internal /\///////////////////////////////////////////////////////////////
+
+  struct __k_AllocationStack {
+    void* frames[AllocationProfiler::MAX_FRAMES];
+    kf_int32_t nFrames;
+    kf_int64_t count;
+  };
+
+
+  struct __k_TypeProfile {
+    string name;
+    kf_int64_t nLive;
+    kf_int64_t nAllocated;
+    kf_int64_t liveBytes;
+    kf_int64_t allocatedBytes;
+    kf_int64_t nDroppedStacks;
+    vector<__k_AllocationStack> stacks;
+  };
+
+
+  /**
+   * A live object. `stack` holds the sampled call stack of its allocation
+   * until its type is resolved, or NULL if it was not sampled.
+   */
+
+  struct __k_LiveObject {
+    size_t size;
+    kf_int32_t type;
+    __k_AllocationStack* stack;
+  };
+
+
+  struct __k_TypeInfoLess {
+    bool operator()(const type_info* a, const type_info* b) const {
+      return a->before(*b) != 0;
+    }
+  };
+
+
+  typedef map<const void*, __k_LiveObject> __k_LiveObjectMap;
+  typedef map<const type_info*, kf_int32_t, __k_TypeInfoLess> __k_TypeMap;
+
+
+  static pthread_mutex_t __k_profilerMutex = PTHREAD_MUTEX_INITIALIZER;
+  static __k_LiveObjectMap* __k_liveObjects = NULL;
+  static __k_TypeMap* __k_typeIndexes = NULL;
+  static vector<__k_TypeProfile>* __k_types = NULL;
+  static kf_int32_t __k_samplingInterval = 0;
+  static kf_int64_t __k_nAllocations = 0;
+
+
+  /**
+   * Index of the profile of objects whose type is not resolved yet.
+   */
+
+  static const kf_int32_t __k_UNRESOLVED = 0;
+
+
+  static void __k_addType(const string& name) {
+    __k_TypeProfile profile;
+    profile.name = name;
+    profile.nLive = 0;
+    profile.nAllocated = 0;
+    profile.liveBytes = 0;
+    profile.allocatedBytes = 0;
+    profile.nDroppedStacks = 0;
+    __k_types->push_back(profile);
+  }
+
+
+  /**
+   * Creates the tables on first use. Should be called while holding the
+   * mutex. The tables are allocated on heap and never deleted, so that they
+   * are still available to objects deleted by static deconstructors.
+   */
+
+  static void __k_initProfiler() {
+    if(__k_types != NULL) {
+      return;
+    }
+    __k_liveObjects = new __k_LiveObjectMap();
+    __k_typeIndexes = new __k_TypeMap();
+    __k_types = new vector<__k_TypeProfile>();
+    __k_addType("(unresolved)");
+  }
+
+
+  /**
+   * Removes the given live object from the profile of its type. Should be
+   * called while holding the mutex.
+   */
+
+  static void __k_discard(__k_LiveObjectMap::iterator it) {
+    __k_TypeProfile& profile = (*__k_types)[it->second.type];
+    profile.nLive--;
+    profile.liveBytes -= it->second.size;
+    delete it->second.stack;
+    __k_liveObjects->erase(it);
+  }
+
+
+  /**
+   * Adds the given stack to the given profile, merging it with an identical
+   * stack if there is one. Should be called while holding the mutex.
+   */
+
+  static void __k_addStack(__k_TypeProfile& profile,
+      const __k_AllocationStack& stack)
+  {
+    for(size_t i = 0; i < profile.stacks.size(); i++) {
+      __k_AllocationStack& s = profile.stacks[i];
+      if(s.nFrames == stack.nFrames
+          && memcmp(s.frames, stack.frames, sizeof(void*) * s.nFrames) == 0)
+      {
+        s.count++;
+        return;
+      }
+    }
+
+    if(profile.stacks.size() == (size_t)AllocationProfiler::MAX_STACKS_PER_TYPE)
+    {
+      profile.nDroppedStacks++;
+      return;
+    }
+
+    profile.stacks.push_back(stack);
+    profile.stacks.back().count = 1;
+  }
+
+
+  static bool __k_compareProfiles(const __k_TypeProfile* a,
+      const __k_TypeProfile* b)
+  {
+    if(a->liveBytes != b->liveBytes) {
+      return a->liveBytes > b->liveBytes;
+    }
+    return a->allocatedBytes > b->allocatedBytes;
+  }
+
+
+  static bool __k_compareStacks(const __k_AllocationStack& a,
+      const __k_AllocationStack& b)
+  {
+    return a.count > b.count;
+  }
+
+
+  static string __k_frameToString(void* frame) {
+    string name = System::resolveSymbolName(frame);
+    if(!name.empty()) {
+      return System::demangle(name);
+    }
+
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "%p", frame);
+    return string(buffer);
+  }
+
+
+//\/ AllocationProfiler /\/////////////////////////////////////////////////////
+
+// --- STATIC FIELDS --- //
+
+  volatile bool AllocationProfiler::_isEnabled = false;
+
+
+// --- STATIC METHODS --- //
+
+  /**
+   * Starts profiling.
+   *
+   * @param samplingInterval The call stack of one in every this many
+   *                         allocations is captured. 0 disables sampling.
+   */
+
+  void AllocationProfiler::enable(const kf_int32_t samplingInterval) {
+    pthread_mutex_lock(&__k_profilerMutex);
+    __k_initProfiler();
+    __k_samplingInterval = samplingInterval;
+    _isEnabled = true;
+    pthread_mutex_unlock(&__k_profilerMutex);
+  }
+
+
+  /**
+   * Stops profiling. The data collected so far is kept, and can still be
+   * reported.
+   */
+
+  void AllocationProfiler::disable() {
+    _isEnabled = false;
+  }
+
+
+  /**
+   * Discards all the data collected so far. Cached type names are kept.
+   */
+
+  void AllocationProfiler::reset() {
+    pthread_mutex_lock(&__k_profilerMutex);
+
+    if(__k_types != NULL) {
+      for(__k_LiveObjectMap::iterator it = __k_liveObjects->begin();
+          it != __k_liveObjects->end(); it++)
+      {
+        delete it->second.stack;
+      }
+      __k_liveObjects->clear();
+
+      for(size_t i = 0; i < __k_types->size(); i++) {
+        __k_TypeProfile& profile = (*__k_types)[i];
+        profile.nLive = 0;
+        profile.nAllocated = 0;
+        profile.liveBytes = 0;
+        profile.allocatedBytes = 0;
+        profile.nDroppedStacks = 0;
+        profile.stacks.clear();
+      }
+    }
+
+    __k_nAllocations = 0;
+
+    pthread_mutex_unlock(&__k_profilerMutex);
+  }
+
+
+  /**
+   * Called by ManagedObject's `new` operator once the memory for a new
+   * object is allocated.
+   *
+   * @param obj The allocated memory.
+   * @param size The size of the allocated memory.
+   */
+
+  void AllocationProfiler::onAllocate(void* const obj, const size_t size) {
+    __k_AllocationStack* stack = NULL;
+
+    pthread_mutex_lock(&__k_profilerMutex);
+
+    __k_initProfiler();
+
+    __k_nAllocations++;
+    bool isSampled = __k_samplingInterval > 0
+        && __k_nAllocations % __k_samplingInterval == 0;
+
+    // The memory of objects deconstructed without being freed, such as those
+    // in a reset arena, can be handed out again.
+    __k_LiveObjectMap::iterator it = __k_liveObjects->find(obj);
+    if(it != __k_liveObjects->end()) {
+      __k_discard(it);
+    }
+
+    __k_LiveObject& live = (*__k_liveObjects)[obj];
+    live.size = size;
+    live.type = __k_UNRESOLVED;
+    live.stack = NULL;
+
+    __k_TypeProfile& profile = (*__k_types)[__k_UNRESOLVED];
+    profile.nLive++;
+    profile.nAllocated++;
+    profile.liveBytes += size;
+    profile.allocatedBytes += size;
+
+    pthread_mutex_unlock(&__k_profilerMutex);
+
+    if(!isSampled) {
+      return;
+    }
+
+    // Captured outside the lock. The first two frames are this method and
+    // the `new` operator.
+    void* frames[MAX_FRAMES + 2];
+    kf_int32_t n = System::backtrace(frames, MAX_FRAMES + 2) - 2;
+    if(n <= 0) {
+      return;
+    }
+
+    stack = new __k_AllocationStack();
+    memcpy(stack->frames, frames + 2, sizeof(void*) * n);
+    stack->nFrames = n;
+    stack->count = 1;
+
+    pthread_mutex_lock(&__k_profilerMutex);
+    it = __k_liveObjects->find(obj);
+    if(it != __k_liveObjects->end() && it->second.type == __k_UNRESOLVED
+        && it->second.stack == NULL)
+    {
+      it->second.stack = stack;
+      stack = NULL;
+    }
+    pthread_mutex_unlock(&__k_profilerMutex);
+
+    delete stack;
+  }
+
+
+  /**
+   * Called by ManagedObject's `delete` operator, and by ArenaMemoryManager
+   * for each object it deconstructs.
+   *
+   * @param obj The memory of the object being freed.
+   */
+
+  void AllocationProfiler::onFree(void* const obj) {
+    pthread_mutex_lock(&__k_profilerMutex);
+    if(__k_liveObjects != NULL) {
+      __k_LiveObjectMap::iterator it = __k_liveObjects->find(obj);
+      if(it != __k_liveObjects->end()) {
+        __k_discard(it);
+      }
+    }
+    pthread_mutex_unlock(&__k_profilerMutex);
+  }
+
+
+  /**
+   * Moves the given object from `(unresolved)` to the profile of its dynamic
+   * type. Called by Ptr when it is given a raw pointer. Has no effect if the
+   * type of the object is already resolved, or if the object was not
+   * allocated while profiling.
+   *
+   * @param obj A fully constructed object.
+   */
+
+  void AllocationProfiler::resolve(const ManagedObject* const obj) {
+    pthread_mutex_lock(&__k_profilerMutex);
+
+    if(__k_liveObjects == NULL) {
+      pthread_mutex_unlock(&__k_profilerMutex);
+      return;
+    }
+
+    __k_LiveObjectMap::iterator it = __k_liveObjects->find(obj);
+    if(it == __k_liveObjects->end() || it->second.type != __k_UNRESOLVED) {
+      pthread_mutex_unlock(&__k_profilerMutex);
+      return;
+    }
+
+    const type_info* type = &typeid(*obj);
+    __k_TypeMap::iterator t = __k_typeIndexes->find(type);
+    kf_int32_t index;
+    if(t == __k_typeIndexes->end()) {
+      index = (kf_int32_t)__k_types->size();
+      __k_addType(System::demangle(type->name()));
+      (*__k_typeIndexes)[type] = index;
+    } else {
+      index = t->second;
+    }
+
+    __k_LiveObject& live = it->second;
+    __k_TypeProfile& from = (*__k_types)[__k_UNRESOLVED];
+    __k_TypeProfile& to = (*__k_types)[index];
+
+    from.nLive--;
+    from.nAllocated--;
+    from.liveBytes -= live.size;
+    from.allocatedBytes -= live.size;
+
+    to.nLive++;
+    to.nAllocated++;
+    to.liveBytes += live.size;
+    to.allocatedBytes += live.size;
+
+    live.type = index;
+    if(live.stack != NULL) {
+      __k_addStack(to, *live.stack);
+      delete live.stack;
+      live.stack = NULL;
+    }
+
+    pthread_mutex_unlock(&__k_profilerMutex);
+  }
+
+
+  /**
+   * Prints the collected data, one type per row, sorted by the number of
+   * live bytes in descending order. Sampled call stacks are printed below
+   * each type, most frequent first, one frame per line starting from the
+   * caller of `new`.
+   *
+   * @param os The stream to print to.
+   * @param maxTypes Maximum number of types to print. 0 prints all.
+   */
+
+  void AllocationProfiler::printReport(ostream& os, const kf_int32_t maxTypes)
+  {
+    // The data is copied under the lock, and symbols are resolved after it
+    // is released.
+    vector<__k_TypeProfile> types;
+    pthread_mutex_lock(&__k_profilerMutex);
+    if(__k_types != NULL) {
+      types = *__k_types;
+    }
+    pthread_mutex_unlock(&__k_profilerMutex);
+
+    vector<const __k_TypeProfile*> sorted;
+    kf_int64_t nLive = 0;
+    kf_int64_t liveBytes = 0;
+    for(size_t i = 0; i < types.size(); i++) {
+      if(types[i].nAllocated == 0) {
+        continue;
+      }
+      nLive += types[i].nLive;
+      liveBytes += types[i].liveBytes;
+      sorted.push_back(&types[i]);
+    }
+    std::sort(sorted.begin(), sorted.end(), __k_compareProfiles);
+
+    size_t n = sorted.size();
+    if(maxTypes > 0 && (size_t)maxTypes < n) {
+      n = maxTypes;
+    }
+
+    char buffer[200];
+    snprintf(buffer, sizeof(buffer),
+        "Allocation profile: %ld live objects, %ld bytes, %d types\n",
+        nLive, liveBytes, (int)sorted.size());
+    os << buffer;
+
+    snprintf(buffer, sizeof(buffer), "%12s %14s %12s %14s  %s\n",
+        "Live", "Live bytes", "Allocated", "Alloc. bytes", "Type");
+    os << buffer;
+
+    for(size_t i = 0; i < n; i++) {
+      const __k_TypeProfile& p = *sorted[i];
+      snprintf(buffer, sizeof(buffer), "%12ld %14ld %12ld %14ld  ",
+          p.nLive, p.liveBytes, p.nAllocated, p.allocatedBytes);
+      os << buffer << p.name << "\n";
+
+      vector<__k_AllocationStack> stacks = p.stacks;
+      std::sort(stacks.begin(), stacks.end(), __k_compareStacks);
+
+      for(size_t j = 0; j < stacks.size(); j++) {
+        os << "    " << stacks[j].count << " sampled allocations at:\n";
+        for(kf_int32_t k = 0; k < stacks[j].nFrames; k++) {
+          os << "        " << __k_frameToString(stacks[j].frames[k]) << "\n";
+        }
+      }
+
+      if(p.nDroppedStacks > 0) {
+        os << "    " << p.nDroppedStacks
+           << " sampled allocations at other places\n";
+      }
+    }
+
+    os.flush();
+  }
+
+} // namespace kfoundation
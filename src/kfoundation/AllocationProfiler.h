@@ -0,0 +1,98 @@
+/*---[AllocationProfiler.h]------------------------------------m(._.)m--------*\
+ |
+ |  Project   : KFoundation
+ |  Declares  : kfoundation::AllocationProfiler::*
+ |  Implements: kfoundation::AllocationProfiler::isEnabled()
+ |
+ |  Copyright (c) 2013, 2014, 2015, RIKEN (The Institute of Physical and
+ |  Chemial Research) All rights reserved.
+ |
+ |  Author: Hamed KHANDAN (hamed.khandan@port.kobe-u.ac.jp)
+ |
+ |  This file is distributed under the KnoRBA Free Public License. See
+ |  LICENSE.TXT for details.
+ |
+ *//////////////////////////////////////////////////////////////////////////////
+
+#ifndef KFOUNDATION_ALLOCATIONPROFILER
+#define KFOUNDATION_ALLOCATIONPROFILER
+
+// Std
+#include <cstddef>
+#include <ostream>
+
+// Internal
+#include "definitions.h"
+
+namespace kfoundation {
+
+  using namespace std;
+
+  class ManagedObject;
+
+
+  /**
+   * Opt-in profiler that aggregates the ManagedObjects allocated with `new`
+   * by their dynamic type. For each type, it keeps the number of live and
+   * allocated objects and their sizes in bytes. Usage:
+   *
+   *     AllocationProfiler::enable(1000);
+   *     // Run the workload
+   *     AllocationProfiler::printReport(cout, 20);
+   *
+   * The dynamic type of an object is not known to the `new` operator, so it
+   * is resolved the first time the object is assigned to a Ptr. Until then,
+   * the object is counted under `(unresolved)`. Type names are demangled
+   * once per type and cached.
+   *
+   * Optionally, the call stack of one in every `samplingInterval`
+   * allocations is captured with System::backtrace(). Up to
+   * MAX_STACKS_PER_TYPE distinct stacks are kept for each type, along with
+   * the number of sampled allocations made from each.
+   *
+   * While enabled, every allocation and deallocation of a ManagedObject
+   * takes a global lock. While disabled, the cost is a single comparison.
+   * Objects allocated while the profiler is disabled are not accounted for,
+   * and objects freed while it is disabled remain counted as live until
+   * reset() is called.
+   *
+   * @ingroup memory
+   * @headerfile AllocationProfiler.h <kfoundation/AllocationProfiler.h>
+   */
+
+  class AllocationProfiler {
+
+  // --- STATIC FIELDS --- //
+
+    public: static const kf_int32_t MAX_FRAMES = 16;
+    public: static const kf_int32_t MAX_STACKS_PER_TYPE = 8;
+    private: static volatile bool _isEnabled;
+
+
+  // --- STATIC METHODS --- //
+
+    public: static void enable(const kf_int32_t samplingInterval = 0);
+    public: static void disable();
+    public: static inline bool isEnabled();
+    public: static void reset();
+    public: static void onAllocate(void* const obj, const size_t size);
+    public: static void onFree(void* const obj);
+    public: static void resolve(const ManagedObject* const obj);
+    public: static void printReport(ostream& os, const kf_int32_t maxTypes = 0);
+
+  };
+
+
+// --- INLINE METHODS --- //
+
+  /**
+   * Checks if the profiler is enabled.
+   */
+
+  inline bool AllocationProfiler::isEnabled() {
+    return _isEnabled;
+  }
+
+} // namespace kfoundation
+
+#endif /* defined(KFOUNDATION_ALLOCATIONPROFILER) */
@@ -0,0 +1,546 @@
+/*---[ArenaMemoryManager.cpp]----------------------------------m(._.)m--------*\
+ |
+ |  Project   : KFoundation
+ |  Declares  : -
+ |  Implements: kfoundation::ArenaMemoryManager::*
+ |
+ |  Copyright (c) 2013, 2014, 2015, RIKEN (The Institute of Physical and
+ |  Chemial Research) All rights reserved.
+ |
+ |  Author: Hamed KHANDAN (hamed.khandan@port.kobe-u.ac.jp)
+ |
+ |  This file is distributed under the KnoRBA Free Public License. See
+ |  LICENSE.TXT for details.
+ |
+ *//////////////////////////////////////////////////////////////////////////////
+
+// Std
+#include <cstdlib>
+#include <cstdio>
+#include <new>
+
+// Internal
+#include "Int.h"
+#include "InvalidPointerException.h"
+#include "OutOfMemoryException.h"
+#include "MasterMemoryManager.h"
+#include "Logger.h"
+#include "ObjectSerializer.h"
+#include "System.h"
+#include "Ptr.h"
+#include "AllocationProfiler.h"
+
+// Self
+#include "ArenaMemoryManager.h"
+
+namespace kfoundation {
+
+//\/ Internal /\///////////////////////////////////////////////////////////////
+
+  struct __k_ArenaBlock {
+    __k_ArenaBlock* next;
+    size_t size;
+  };
+
+
+  /**
+   * Size of the block header, rounded up so that the data following it is
+   * aligned.
+   */
+
+  static const size_t __k_ARENA_HEADER_SIZE
+      = (sizeof(__k_ArenaBlock) + ArenaMemoryManager::ALIGNMENT - 1)
+      & ~(size_t)(ArenaMemoryManager::ALIGNMENT - 1);
+
+
+  inline char* __k_blockData(__k_ArenaBlock* block) {
+    return (char*)block + __k_ARENA_HEADER_SIZE;
+  }
+
+
+//\/ ArenaMemoryManager::Scope /\//////////////////////////////////////////////
+
+  /**
+   * Constructor. Enters the given arena on the calling thread.
+   */
+
+  ArenaMemoryManager::Scope::Scope(ArenaMemoryManager& arena)
+  : _arena(arena)
+  {
+    _arena.enter();
+  }
+
+
+  /**
+   * Deconstructor. Leaves the arena.
+   */
+
+  ArenaMemoryManager::Scope::~Scope() {
+    _arena.leave();
+  }
+
+
+//\/ ArenaMemoryManager /\/////////////////////////////////////////////////////
+
+// --- STATIC FIELDS --- //
+
+  const int ArenaMemoryManager::INITIAL_SIZE = 64;
+  pthread_key_t ArenaMemoryManager::_currentKey;
+  pthread_once_t ArenaMemoryManager::_keyOnce = PTHREAD_ONCE_INIT;
+  volatile kf_int32_t ArenaMemoryManager::_nActive = 0;
+
+
+// --- (DE)CONSTRUCTORS --- //
+
+  /**
+   * Constructor.
+   *
+   * @param blockSize The size of memory blocks obtained from the system.
+   *                  Objects larger than half of it get a block of their own.
+   */
+
+  ArenaMemoryManager::ArenaMemoryManager(const kf_int32_t blockSize) {
+    _size = INITIAL_SIZE;
+    _count = 0;
+    _nLive = 0;
+    _nStatics = 0;
+    _peakCount = 0;
+    _nGrowths = 0;
+    _nAllocations = 0;
+    _generation = 0;
+    _blockSize = blockSize;
+    _blocks = NULL;
+    _cursor = NULL;
+    _limit = NULL;
+    _parent = NULL;
+    _isActive = false;
+    _trace = false;
+
+    _table.reserve(_size);
+
+    _master = &System::getMasterMemoryManager();
+    _id = _master->registerManager(this);
+  }
+
+
+  /**
+   * Deconstructor. Deconstructs all remaining objects and frees all memory.
+   */
+
+  ArenaMemoryManager::~ArenaMemoryManager() {
+    reset();
+    freeBlocks(_blocks);
+    _master->unregisterManager(_id);
+  }
+
+
+// --- STATIC METHODS --- //
+
+  void ArenaMemoryManager::createKey() {
+    pthread_key_create(&_currentKey, NULL);
+  }
+
+
+// --- METHODS --- //
+
+  /**
+   * Extends the table by appending new pages.
+   *
+   * @throw OutOfMemoryException if the table has reached
+   *        KF_OBJECT_TABLE_MAX_SIZE.
+   */
+
+  void ArenaMemoryManager::grow() {
+    int newSize = _size * 4;
+    if(newSize > KF_OBJECT_TABLE_MAX_SIZE) {
+      newSize = KF_OBJECT_TABLE_MAX_SIZE;
+    }
+
+    if(newSize == _size) {
+      // Int::toString() is used since constructing an Int would register a
+      // new object to this arena.
+      throw OutOfMemoryException("ArenaMemoryManager "
+          + Int::toString(_id) + " cannot hold more than "
+          + Int::toString(_size) + " objects.");
+    }
+
+    _table.reserve(newSize);
+    _size = newSize;
+    _nGrowths++;
+  }
+
+
+  /**
+   * Obtains a block with at least the given number of usable bytes from the
+   * system.
+   *
+   * @throw std::bad_alloc if the system is out of memory.
+   */
+
+  __k_ArenaBlock* ArenaMemoryManager::newBlock(const size_t size) {
+    __k_ArenaBlock* block
+        = (__k_ArenaBlock*)malloc(__k_ARENA_HEADER_SIZE + size);
+
+    if(block == NULL) {
+      throw std::bad_alloc();
+    }
+
+    block->size = size;
+    block->next = NULL;
+    return block;
+  }
+
+
+  /**
+   * Frees the given block and all blocks following it.
+   */
+
+  void ArenaMemoryManager::freeBlocks(__k_ArenaBlock* block) {
+    while(block != NULL) {
+      __k_ArenaBlock* next = block->next;
+      free(block);
+      block = next;
+    }
+  }
+
+
+  string ArenaMemoryManager::toString(int index) {
+    const ObjectRecord& rec = _table.at(index);
+    const ObjectRecordInfo& info = _table.infoAt(index);
+    string typeName = "(deleted)";
+    if(rec.ptr != NULL) {
+      typeName = System::demangle(typeid(*rec.ptr).name());
+    }
+
+    char buffer[400];
+    sprintf(buffer, "[manager: %d, index: %d, type: %s, key: %d]",
+            info.manager, info.index, typeName.c_str(), rec.key);
+    return string(buffer);
+  }
+
+
+  /**
+   * Makes this arena the innermost arena of the calling thread.
+   *
+   * @throw KFException if the arena is already entered.
+   */
+
+  void ArenaMemoryManager::enter() {
+    if(_isActive) {
+      throw KFException("ArenaMemoryManager " + Int::toString(_id)
+          + " is already entered.");
+    }
+
+    pthread_once(&_keyOnce, &ArenaMemoryManager::createKey);
+    _parent = (ArenaMemoryManager*)pthread_getspecific(_currentKey);
+    pthread_setspecific(_currentKey, this);
+    _isActive = true;
+    __sync_fetch_and_add(&_nActive, 1);
+  }
+
+
+  /**
+   * Leaves this arena, reinstating the enclosing arena, if any.
+   *
+   * @throw KFException if this is not the innermost arena of the calling
+   *                    thread.
+   */
+
+  void ArenaMemoryManager::leave() {
+    if(!_isActive || pthread_getspecific(_currentKey) != this) {
+      throw KFException("ArenaMemoryManager " + Int::toString(_id)
+          + " is not the innermost arena of the calling thread.");
+    }
+
+    pthread_setspecific(_currentKey, _parent);
+    _parent = NULL;
+    _isActive = false;
+    __sync_fetch_and_sub(&_nActive, 1);
+  }
+
+
+  /**
+   * Allocates memory for an object by advancing the cursor of the current
+   * block. Called by ManagedObject's `new` operator; the memory is reclaimed
+   * by reset().
+   *
+   * @param size Number of bytes to allocate.
+   * @return Pointer to the allocated memory, aligned to ALIGNMENT bytes.
+   * @throw std::bad_alloc if the system is out of memory.
+   */
+
+  void* ArenaMemoryManager::allocate(const size_t size) {
+    const size_t n = (size + ALIGNMENT - 1) & ~(size_t)(ALIGNMENT - 1);
+
+    if(n > (size_t)(_limit - _cursor)) {
+      if(n > (size_t)_blockSize / 2) {
+        // Large objects get a block of their own, placed behind the current
+        // one so that the rest of the current block is not wasted.
+        __k_ArenaBlock* block = newBlock(n);
+        if(_blocks == NULL) {
+          _blocks = block;
+        } else {
+          block->next = _blocks->next;
+          _blocks->next = block;
+        }
+        return __k_blockData(block);
+      }
+
+      __k_ArenaBlock* block = newBlock(_blockSize);
+      block->next = _blocks;
+      _blocks = block;
+      _cursor = __k_blockData(block);
+      _limit = _cursor + _blockSize;
+    }
+
+    void* p = _cursor;
+    _cursor += n;
+    return p;
+  }
+
+
+  /**
+   * Checks if the given address belongs to one of the blocks of this arena.
+   */
+
+  bool ArenaMemoryManager::contains(const void* const block) const {
+    const char* p = (const char*)block;
+    for(__k_ArenaBlock* b = _blocks; b != NULL; b = b->next) {
+      const char* data = __k_blockData(b);
+      if(p >= data && p < data + b->size) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+
+  /**
+   * Deconstructs all objects in this arena, in the reverse order of their
+   * creation, and makes their memory available for reuse. Pointers to these
+   * objects become invalid. The first memory block is kept; the rest are
+   * returned to the system.
+   *
+   * @throw KFException if the arena is entered by a thread.
+   */
+
+  void ArenaMemoryManager::reset() {
+    if(_isActive) {
+      throw KFException("Cannot reset ArenaMemoryManager "
+          + Int::toString(_id) + " while it is entered.");
+    }
+
+    for(int i = _count - 1; i >= 0; i--) {
+      ObjectRecord& record = _table.at(i);
+      if(record.ptr != NULL) {
+        ManagedObject* obj = record.ptr;
+        _table.infoAt(i).isBeingDeleted = true;
+        obj->~ManagedObject();
+        if(AllocationProfiler::isEnabled()) {
+          AllocationProfiler::onFree(obj);
+        }
+      }
+    }
+
+    _generation = nextKey(_generation);
+    for(int i = 0; i < _count; i++) {
+      ObjectRecord& record = _table.at(i);
+      ObjectRecordInfo& info = _table.infoAt(i);
+      record.ptr = NULL;
+      record.key = _generation;
+      info.isStatic = false;
+      info.isBeingDeleted = false;
+    }
+
+    if(_trace) {
+      LOG << "ArenaMemoryManager " << _id << " reset " << _count
+          << " records" << EL;
+    }
+
+    _count = 0;
+    _nLive = 0;
+    _nStatics = 0;
+
+    // The first block in the list is the one being filled, unless it is the
+    // only block and it holds a large object.
+    if(_blocks != NULL) {
+      freeBlocks(_blocks->next);
+      _blocks->next = NULL;
+      if(_blocks->size == (size_t)_blockSize) {
+        _cursor = __k_blockData(_blocks);
+        _limit = _cursor + _blockSize;
+      } else {
+        freeBlocks(_blocks);
+        _blocks = NULL;
+        _cursor = NULL;
+        _limit = NULL;
+      }
+    }
+  }
+
+
+  const ObjectRecordInfo&
+  ArenaMemoryManager::registerObject(ManagedObject* obj) {
+    if(_count == _size) {
+      grow();
+    }
+
+    ObjectRecord& record = _table.at(_count);
+    ObjectRecordInfo& info = _table.infoAt(_count);
+    record.ptr = obj;
+    record.retainCount = 1;
+    record.key = _generation;
+    info.manager = _id;
+    info.index = _count;
+    info.serialNumber = _count;
+    info.isStatic = false;
+    info.isBeingDeleted = false;
+    _count++;
+    _nLive++;
+    _nAllocations++;
+    if(_nLive > _peakCount) {
+      _peakCount = _nLive;
+    }
+
+    return info;
+  }
+
+
+  void ArenaMemoryManager::retain(kf_int32_t index, kf_objectkey_t key) {
+    if(_table.at(index).key != key) {
+      throw InvalidPointerException("The pointer being retained is invalid: "
+                                    + Int(_id) + ":" + Int(index));
+    }
+
+    if(_trace) {
+      LOG << "Retained: " << toString(index) << EL;
+    }
+  }
+
+
+  /**
+   * Succeeds as long as the object has not been deconstructed. Objects in an
+   * arena live until reset(), regardless of retains and releases.
+   */
+
+  bool ArenaMemoryManager::tryRetain(kf_int32_t index, kf_objectkey_t key) {
+    const ObjectRecord& record = _table.at(index);
+    if(record.key != key || record.ptr == NULL) {
+      return false;
+    }
+
+    if(_trace) {
+      LOG << "Retained: " << toString(index) << EL;
+    }
+
+    return true;
+  }
+
+
+  void ArenaMemoryManager::release(kf_int32_t index, kf_objectkey_t key) {
+    if(_table.at(index).key != key) {
+      throw InvalidPointerException("The pointer being released is invalid: "
+                                    + Int(_id) + ":" + Int(index));
+    }
+
+    if(_trace) {
+      LOG << "Released: " << toString(index) << EL;
+    }
+  }
+
+
+  /**
+   * Called when an object is deconstructed before reset(), such as an object
+   * on stack or an object whose constructor has thrown. The object will not
+   * be deconstructed again on reset().
+   */
+
+  void ArenaMemoryManager::remove(kf_int32_t index, kf_objectkey_t key) {
+    ObjectRecord& record = _table.at(index);
+    if(record.key == key && record.ptr != NULL) {
+      record.ptr = NULL;
+      _nLive--;
+      if(_table.infoAt(index).isStatic) {
+        _nStatics--;
+      }
+    }
+  }
+
+
+  /**
+   * Marks the object at the given index as static. Static objects in an
+   * arena are still deconstructed on reset().
+   */
+
+  void ArenaMemoryManager::setStatic(kf_int32_t index, kf_objectkey_t key) {
+    if(_table.at(index).key != key) {
+      throw InvalidPointerException("The pointer being made static is "
+          "invalid: " + Int(_id) + ":" + Int(index));
+    }
+
+    ObjectRecordInfo& info = _table.infoAt(index);
+    if(!info.isStatic) {
+      info.isStatic = true;
+      _nStatics++;
+    }
+  }
+
+
+  ObjectRecord** ArenaMemoryManager::getTable() {
+    return _table.getPages();
+  }
+
+
+  kf_int32_t ArenaMemoryManager::getTableSize() const {
+    return _count;
+  }
+
+
+  void ArenaMemoryManager::trace(const pthread_t) {
+    _trace = true;
+  }
+
+
+  void ArenaMemoryManager::untrace() {
+    _trace = false;
+  }
+
+
+  Statistics ArenaMemoryManager::getStats() const {
+    Statistics stats;
+    stats.nObjects = _nLive;
+    stats.nStaticObjects = _nStatics;
+    stats.peakObjects = _peakCount;
+    stats.tableSize = _size;
+    stats.nGrowths = _nGrowths;
+    stats.nAllocations = _nAllocations;
+    stats.nReleases = _nAllocations - _nLive;
+    return stats;
+  }
+
+
+  /**
+   * Serializing method.
+   */
+
+  void ArenaMemoryManager::serialize(PPtr<ObjectSerializer> seralizer) const
+  {
+    seralizer->object("ArenaMemoryManager")
+             ->attribute("id", _id)
+             ->attribute("count", _count);
+
+    for(int i = 0; i < _count; i++) {
+      const ObjectRecord& rec = _table.at(i);
+      if(rec.ptr != NULL) {
+        seralizer->member("[" + Int(i) + "]")->object("ObjectRecord")
+                 ->attribute("type", System::demangle(typeid(*rec.ptr).name()))
+                 ->attribute("index", _table.infoAt(i).index)
+                 ->attribute("key", rec.key)
+                 ->endObject();
+      }
+    }
+
+    seralizer->endObject();
+  }
+
+} // namespace kfoundation
@@ -0,0 +1,179 @@
+/*---[ArenaMemoryManager.h]------------------------------------m(._.)m--------*\
+ |
+ |  Project   : KFoundation
+ |  Declares  : kfoundation::ArenaMemoryManager::*
+ |  Implements: kfoundation::ArenaMemoryManager::getCurrent()
+ |
+ |  Copyright (c) 2013, 2014, 2015, RIKEN (The Institute of Physical and
+ |  Chemial Research) All rights reserved.
+ |
+ |  Author: Hamed KHANDAN (hamed.khandan@port.kobe-u.ac.jp)
+ |
+ |  This file is distributed under the KnoRBA Free Public License. See
+ |  LICENSE.TXT for details.
+ |
+ *//////////////////////////////////////////////////////////////////////////////
+
+#ifndef KFOUNDATION_ARENAMEMORYMANAGER
+#define KFOUNDATION_ARENAMEMORYMANAGER
+
+// Std
+#include <cstddef>
+
+// Posix
+#include <pthread.h>
+
+#include "MemoryManager.h"
+#include "SerializingStreamer.h"
+#include "ManagedObject.h"
+#include "ObjectTable.h"
+
+namespace kfoundation {
+
+  struct __k_ArenaBlock;
+
+
+  /**
+   * Region-based memory manager for objects that live as long as a single
+   * task, such as a request. While an arena is entered by a thread, every
+   * ManagedObject created with `new` by that thread is bump-allocated in the
+   * arena's memory blocks and registered to the arena. Retains and releases
+   * on these objects only check the validity of the pointer; no retain count
+   * is kept and no object is deleted individually. Instead, reset()
+   * deconstructs all objects at once, and makes all their memory available
+   * for the next task. Usage:
+   *
+   *     ArenaMemoryManager arena;
+   *     while(...) {
+   *       {
+   *         ArenaMemoryManager::Scope scope(arena);
+   *         // Handle request
+   *       }
+   *       arena.reset();
+   *     }
+   *
+   * Each reset() advances the key of every record used so far, so a pointer
+   * kept past a reset fails validation instead of accessing a dead object.
+   * Objects that need to outlive the task should be created outside the
+   * scope.
+   *
+   * An arena is not thread-safe, and should be entered by at most one thread
+   * at a time. Arenas entered on the same thread nest; the innermost one
+   * receives the new objects. Objects with a custom operator new, such as
+   * PoolObjects, are not allocated in the arena.
+   *
+   * @ingroup memory
+   * @headerfile ArenaMemoryManager.h <kfoundation/ArenaMemoryManager.h>
+   */
+
+  class ArenaMemoryManager
+  : public MemoryManager, public SerializingStreamer {
+
+  // --- NESTED TYPES --- //
+
+    /**
+     * Enters an arena on construction and leaves it on deconstruction.
+     */
+
+    public: class Scope {
+      private: ArenaMemoryManager& _arena;
+      public: Scope(ArenaMemoryManager& arena);
+      public: ~Scope();
+    };
+
+
+  // --- STATIC FIELDS --- //
+
+    public: static const kf_int32_t DEFAULT_BLOCK_SIZE = 64 * 1024;
+    public: static const kf_int32_t ALIGNMENT = 16;
+    private: const static int INITIAL_SIZE;
+    private: static pthread_key_t _currentKey;
+    private: static pthread_once_t _keyOnce;
+    private: static volatile kf_int32_t _nActive;
+
+
+  // --- FIELDS --- //
+
+    private: int _size;
+    private: int _count;
+    private: int _nLive;
+    private: int _nStatics;
+    private: int _peakCount;
+    private: int _nGrowths;
+    private: kf_int64_t _nAllocations;
+    private: int _id;
+    private: kf_objectkey_t _generation;
+    private: kf_int32_t _blockSize;
+    private: __k_ArenaBlock* _blocks;
+    private: char* _cursor;
+    private: char* _limit;
+    private: ArenaMemoryManager* _parent;
+    private: ObjectTable _table;
+    private: MasterMemoryManager* _master;
+    private: bool _isActive;
+    private: bool _trace;
+
+
+  // --- (DE)CONSTRUCTORS --- //
+
+    public: ArenaMemoryManager(const kf_int32_t blockSize = DEFAULT_BLOCK_SIZE);
+    public: ~ArenaMemoryManager();
+
+
+  // --- STATIC METHODS --- //
+
+    private: static void createKey();
+    public: static inline ArenaMemoryManager* getCurrent();
+
+
+  // --- METHODS --- //
+
+    private: ArenaMemoryManager(const ArenaMemoryManager&);
+    private: ArenaMemoryManager& operator=(const ArenaMemoryManager&);
+    private: void grow();
+    private: __k_ArenaBlock* newBlock(const size_t size);
+    private: void freeBlocks(__k_ArenaBlock* block);
+    private: string toString(int index);
+    public: void enter();
+    public: void leave();
+    public: void* allocate(const size_t size);
+    public: bool contains(const void* const block) const;
+    public: void reset();
+
+    // Inherited from MemoryManager
+    public: const ObjectRecordInfo& registerObject(ManagedObject* obj);
+    public: void retain(kf_int32_t index, kf_objectkey_t key);
+    public: bool tryRetain(kf_int32_t index, kf_objectkey_t key);
+    public: void release(kf_int32_t index, kf_objectkey_t key);
+    public: void remove(kf_int32_t index, kf_objectkey_t key);
+    public: void setStatic(kf_int32_t index, kf_objectkey_t key);
+    public: ObjectRecord** getTable();
+    public: kf_int32_t getTableSize() const;
+    public: void trace(const pthread_t threadId);
+    public: void untrace();
+    public: Statistics getStats() const;
+
+    // Inherited from Serializing Streamer
+    public: void serialize(PPtr<ObjectSerializer> seralizer) const;
+
+  };
+
+
+// --- INLINE METHODS --- //
+
+  /**
+   * Returns the innermost arena entered by the calling thread, or NULL if
+   * there is none. While no arena is entered in the process, this costs a
+   * single comparison.
+   */
+
+  inline ArenaMemoryManager* ArenaMemoryManager::getCurrent() {
+    if(_nActive == 0) {
+      return NULL;
+    }
+    return (ArenaMemoryManager*)pthread_getspecific(_currentKey);
+  }
+
+} // namespace kfoundation
+
+#endif /* defined(KFOUNDATION_ARENAMEMORYMANAGER) */
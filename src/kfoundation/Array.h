@@ -3,6 +3,7 @@
  |  Project   : KFoundation
  |  Declares  : -
  |  Implements: kfoundation::Array::*
+ |              kfoundation::SmallArray::*
  |
  |  Copyright (c) 2013, 2014, 2015, RIKEN (The Institute of Physical and
  |  Chemial Research) All rights reserved.
@@ -19,11 +20,18 @@
 
 #include <vector>
 #include <cstring>
+#include <cstdlib>
+#include <new>
+
+#ifdef KF_RVALUE_REFERENCES
+#  include <utility>
+#endif
 
 #include "ManagedObject.h"
 #include "PtrDecl.h"
 #include "SerializingStreamer.h"
 #include "IndexOutOfBoundException.h"
+#include "OutOfMemoryException.h"
 #include "System.h"
 #include "MemoryManager.h"
 #include "Int.h"
@@ -38,7 +46,29 @@
 namespace kfoundation {
   
   using namespace std;
-    
+  
+//\/ Internal /\///////////////////////////////////////////////////////////////
+  
+  /**
+   * Returns the given element as an rvalue with C++11, so that it is moved
+   * rather than copied.
+   */
+  
+#ifdef KF_RVALUE_REFERENCES
+  template<typename T>
+  inline T&& __k_moveValue(T& value) {
+    return std::move(value);
+  }
+#else
+  template<typename T>
+  inline const T& __k_moveValue(T& value) {
+    return value;
+  }
+#endif
+  
+  
+//\/ Array /\//////////////////////////////////////////////////////////////////
+  
 // --- STATIC FIELDS --- //
   
   /**
@@ -58,9 +88,12 @@ namespace kfoundation {
   template<typename T>
   Array<T>::Array()
   {
-    _capacity = KF_ARRAY_INITIAL_CAPACITY;
+    _capacity = 0;
     _size = 0;
-    _data = new T[_capacity];
+    _data = NULL;
+    _inlineData = NULL;
+    _inlineCapacity = 0;
+    reallocate(KF_ARRAY_INITIAL_CAPACITY);
   }
   
   
@@ -74,10 +107,40 @@ namespace kfoundation {
   
   template<typename T>
   Array<T>::Array(T* values, kf_int32_t size) {
-    _capacity = size;
+    _capacity = 0;
+    _size = 0;
+    _data = NULL;
+    _inlineData = NULL;
+    _inlineCapacity = 0;
+    reallocate(size);
+    
+    if(ArrayTraits<T>::IS_TRIVIALLY_COPYABLE) {
+      memcpy((void*)_data, values, sizeof(T) * size);
+    } else {
+      for(kf_int32_t i = 0; i < size; i++) {
+        new(_data + i) T(values[i]);
+      }
+    }
+    
     _size = size;
-    _data = new T[_capacity];
-    memcpy(_data, values, sizeof(T) * size);
+  }
+  
+  
+  /**
+   * Constructs an empty array that keeps its elements in the given memory
+   * until they exceed the given capacity. Used by SmallArray.
+   *
+   * @param inlineCapacity The number of elements that fit in the memory.
+   * @param inlineData Uninitialized memory for the elements.
+   */
+  
+  template<typename T>
+  Array<T>::Array(const kf_int32_t inlineCapacity, T* const inlineData) {
+    _capacity = inlineCapacity;
+    _size = 0;
+    _data = inlineData;
+    _inlineData = inlineData;
+    _inlineCapacity = inlineCapacity;
   }
   
   
@@ -87,19 +150,91 @@ namespace kfoundation {
   
   template<typename T>
   Array<T>::~Array() {
-    delete[] _data;
+    clear();
+    if(_data != _inlineData) {
+      free(_data);
+    }
   }
   
 
 // --- METHODS --- //
   
+  /**
+   * Moves the elements to the given uninitialized memory. The memory
+   * previously holding them is left uninitialized.
+   */
+  
+  template<typename T>
+  void Array<T>::relocate(T* const target) {
+    if(ArrayTraits<T>::IS_TRIVIALLY_COPYABLE) {
+      if(_size > 0) {
+        memcpy((void*)target, _data, sizeof(T) * _size);
+      }
+    } else {
+      for(kf_int32_t i = 0; i < _size; i++) {
+        new(target + i) T(__k_moveValue(_data[i]));
+        _data[i].~T();
+      }
+    }
+  }
+  
+  
+  /**
+   * Changes the capacity to the given value, which should not be less than
+   * the size. If the new capacity fits in the inline memory given by
+   * SmallArray, the elements are moved there and the heap block is freed.
+   * Otherwise, if T is trivially copyable, the heap block is resized with
+   * realloc(). In other cases, the elements are move-constructed, or with
+   * C++98, copy-constructed, in a new block, and the old ones are
+   * deconstructed.
+   */
+  
   template<typename T>
-  void Array<T>::grow(kf_int32_t newCapacity) {
+  void Array<T>::reallocate(const kf_int32_t newCapacity) {
+    if(newCapacity <= _inlineCapacity) {
+      if(_data != _inlineData) {
+        relocate(_inlineData);
+        free(_data);
+        _data = _inlineData;
+      }
+      _capacity = _inlineCapacity;
+      return;
+    }
+    
+    bool isInline = _data == _inlineData;
+    T* newData;
+    
+    if(ArrayTraits<T>::IS_TRIVIALLY_COPYABLE && !isInline) {
+      newData = (T*)realloc((void*)_data, sizeof(T) * newCapacity);
+    } else {
+      newData = (T*)malloc(sizeof(T) * newCapacity);
+    }
+    
+    if(newData == NULL) {
+      throw OutOfMemoryException("Array cannot allocate "
+          + Int::toString(newCapacity) + " elements of "
+          + Int::toString((kf_int32_t)sizeof(T)) + " bytes");
+    }
+    
+    if(!ArrayTraits<T>::IS_TRIVIALLY_COPYABLE || isInline) {
+      relocate(newData);
+      if(!isInline) {
+        free(_data);
+      }
+    }
+    
+    _data = newData;
     _capacity = newCapacity;
-    T* newStorage = new T[_capacity];
-    memcpy(newStorage, _data, sizeof(T) * _size);
-    delete[] _data;
-    _data = newStorage;
+  }
+  
+  
+  template<typename T>
+  void Array<T>::grow() {
+    if(_capacity == 0) {
+      reallocate(KF_ARRAY_INITIAL_CAPACITY);
+    } else {
+      reallocate(_capacity * KF_ARRAY_GROWTH_RATE);
+    }
   }
 
   
@@ -110,10 +245,14 @@ namespace kfoundation {
 
   template<typename T>
   void Array<T>::remove(const kf_int32_t index) {
-    if(index < _size - 1) {
-      for(int i = index; i < _size - 1; i++) {
-        _data[i] = _data[i + 1];
+    if(ArrayTraits<T>::IS_TRIVIALLY_COPYABLE) {
+      memmove((void*)(_data + index), _data + index + 1,
+          sizeof(T) * (_size - index - 1));
+    } else {
+      for(kf_int32_t i = index; i < _size - 1; i++) {
+        _data[i] = __k_moveValue(_data[i + 1]);
       }
+      _data[_size - 1].~T();
     }
     _size--;
   }
@@ -121,7 +260,7 @@ namespace kfoundation {
   
   /**
    * Expands the array by one and returns the reference to the newly added
-   * element. Usage:
+   * element, which is value-initialized. Usage:
    *
    *      array->push() = value;
    *
@@ -130,9 +269,10 @@ namespace kfoundation {
   template<typename T>
   T& Array<T>::push() {
     if(_size == _capacity) {
-      grow(_capacity * KF_ARRAY_GROWTH_RATE);
+      grow();
     }
     
+    new(_data + _size) T();
     _size++;
     
     return _data[_size - 1];
@@ -141,15 +281,51 @@ namespace kfoundation {
   
   /**
    * Expands the array by one and sets the newly added item to the given value.
+   * The new item is copy-constructed from the given value.
    *
    * @param value Value to be pushed.
    */
   
   template<typename T>
   void Array<T>::push(const T& value) {
-    push() = value;
+    if(_size == _capacity) {
+      // The value may be an element of this array.
+      T copy(value);
+      grow();
+      new(_data + _size) T(__k_moveValue(copy));
+    } else {
+      new(_data + _size) T(value);
+    }
+    
+    _size++;
+  }
+  
+  
+#ifdef KF_RVALUE_REFERENCES
+  
+  /**
+   * Expands the array by one and move-constructs the newly added item from
+   * the given value. Only available with C++11.
+   *
+   * @param value Value to be pushed.
+   */
+  
+  template<typename T>
+  void Array<T>::push(T&& value) {
+    if(_size == _capacity) {
+      // The value may be an element of this array.
+      T copy(std::move(value));
+      grow();
+      new(_data + _size) T(std::move(copy));
+    } else {
+      new(_data + _size) T(std::move(value));
+    }
+    
+    _size++;
   }
   
+#endif
+  
   
   /**
    * Returns the value of the last element in the array, and decreases its size
@@ -163,13 +339,19 @@ namespace kfoundation {
     if(_size == 0) {
       throw IndexOutOfBoundException("Can't pop because array is empty");
     }
-    return _data[--_size];
+    
+    _size--;
+    T value(__k_moveValue(_data[_size]));
+    _data[_size].~T();
+    
+    return value;
   }
   
   
   /**
    * Used to insert a new element. All elements at the given index and above
-   * will be shifted one index higher. Usage:
+   * will be shifted one index higher. The new element is value-initialized.
+   * Usage:
    * 
    *      array->insert(index) = value;
    *
@@ -179,11 +361,21 @@ namespace kfoundation {
   template<typename T>
   T& Array<T>::insert(const kf_int32_t index) {
     if(_size == _capacity) {
-      grow(_capacity * KF_ARRAY_GROWTH_RATE);
+      grow();
     }
     
-    for(int i = _size - 1; i >= index; i--) {
-      _data[i + 1] = _data[i];
+    if(ArrayTraits<T>::IS_TRIVIALLY_COPYABLE) {
+      memmove((void*)(_data + index + 1), _data + index,
+          sizeof(T) * (_size - index));
+      new(_data + index) T();
+    } else if(index == _size) {
+      new(_data + index) T();
+    } else {
+      new(_data + _size) T(__k_moveValue(_data[_size - 1]));
+      for(kf_int32_t i = _size - 2; i >= index; i--) {
+        _data[i + 1] = __k_moveValue(_data[i]);
+      }
+      _data[index] = T();
     }
     
     _size++;
@@ -202,16 +394,24 @@ namespace kfoundation {
   
   template<typename T>
   void Array<T>::insert(const kf_int32_t index, const T& value) {
-    insert(index) = value;
+    // The value may be an element of this array.
+    T copy(value);
+    insert(index) = __k_moveValue(copy);
   }
   
   
   /**
-   * Resets the size of this array to zero.
+   * Deconstructs all elements and resets the size of this array to zero. The
+   * capacity is not changed.
    */
   
   template<typename T>
   void Array<T>::clear() {
+    if(!ArrayTraits<T>::IS_TRIVIALLY_COPYABLE) {
+      for(kf_int32_t i = 0; i < _size; i++) {
+        _data[i].~T();
+      }
+    }
     _size = 0;
   }
   
@@ -227,14 +427,26 @@ namespace kfoundation {
   
   
   /**
-   * Adjusts the size of array to the given value.
+   * Adjusts the size of array to the given value. Added elements are
+   * value-initialized, and removed ones are deconstructed.
    */
   
   template<typename T>
   void Array<T>::setSize(kf_int32_t size) {
     if(_capacity < size) {
-      grow(size);
-    }    
+      reallocate(size);
+    }
+    
+    for(kf_int32_t i = _size; i < size; i++) {
+      new(_data + i) T();
+    }
+    
+    if(!ArrayTraits<T>::IS_TRIVIALLY_COPYABLE) {
+      for(kf_int32_t i = size; i < _size; i++) {
+        _data[i].~T();
+      }
+    }
+    
     _size = size;
   }
   
@@ -249,6 +461,44 @@ namespace kfoundation {
   }
   
   
+  /**
+   * Makes sure the array can hold the given number of elements without
+   * reallocating its memory.
+   *
+   * @param capacity The desired capacity.
+   */
+  
+  template<typename T>
+  void Array<T>::reserve(const kf_int32_t capacity) {
+    if(capacity > _capacity) {
+      reallocate(capacity);
+    }
+  }
+  
+  
+  /**
+   * Reduces the capacity to the current size, releasing the unused memory.
+   */
+  
+  template<typename T>
+  void Array<T>::shrinkToFit() {
+    if(_capacity > _size) {
+      reallocate(_size);
+    }
+  }
+  
+  
+  /**
+   * Returns the number of elements this array can hold before its memory is
+   * reallocated.
+   */
+  
+  template<typename T>
+  inline kf_int32_t Array<T>::getCapacity() const {
+    return _capacity;
+  }
+  
+  
   /**
    * Returns a reference to the value at the given index.
    *
@@ -287,6 +537,30 @@ namespace kfoundation {
   }
   
   
+  /**
+   * Returns the memory holding the elements of this array, which is valid
+   * until the capacity changes. Only the first getSize() elements are
+   * initialized.
+   */
+  
+  template<typename T>
+  inline T* Array<T>::getData() {
+    return _data;
+  }
+  
+  
+  /**
+   * Returns the memory holding the elements of this array, which is valid
+   * until the capacity changes. Only the first getSize() elements are
+   * initialized.
+   */
+  
+  template<typename T>
+  inline const T* Array<T>::getData() const {
+    return _data;
+  }
+  
+  
   /**
    * Checks if this array contains the given value.
    *
@@ -339,6 +613,20 @@ namespace kfoundation {
     return NOT_FOUND;
   }
   
+  
+//\/ SmallArray /\/////////////////////////////////////////////////////////////
+  
+  /**
+   * Constructs an empty array with room for `N` elements inside the object.
+   */
+  
+  template<typename T, kf_int32_t N>
+  SmallArray<T, N>::SmallArray()
+  : Array<T>(N, (T*)_buffer)
+  {
+    // Nothing;
+  }
+  
 } // namespace kfoundation
 
 #endif /* KFOUNDATION_ARRAY */
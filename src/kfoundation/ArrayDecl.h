@@ -1,7 +1,9 @@
 /*---[ArrayDecl.h]---------------------------------------------m(._.)m--------*\
  |
  |  Project   : KFoundation
- |  Declares  : kfoundation::Array::*
+ |  Declares  : kfoundation::ArrayTraits
+ |              kfoundation::Array::*
+ |              kfoundation::SmallArray::*
  |  Implements: -
  |
  |  Copyright (c) 2013, 2014, 2015, RIKEN (The Institute of Physical and
@@ -27,13 +29,49 @@ namespace kfoundation {
   using namespace std;
   
   
+//\/ ArrayTraits /\////////////////////////////////////////////////////////////
+  
+  /**
+   * Describes how Array can move elements of the given type in memory.
+   * If `IS_TRIVIALLY_COPYABLE` is `true`, elements are moved with realloc()
+   * and memmove(), without invoking any constructor or deconstructor. By
+   * default, it is `true` for types with trivial copy constructor and
+   * deconstructor, such as primitive types, pointers and plain structs. It
+   * can be specialized for other types that can be safely moved as bytes:
+   *
+   *     template<>
+   *     struct ArrayTraits<MyType> {
+   *       static const bool IS_TRIVIALLY_COPYABLE = true;
+   *     };
+   *
+   * @ingroup containers
+   * @headerfile Array.h <kfoundation/Array.h>
+   */
+  
+  template<typename T>
+  struct ArrayTraits {
+    static const bool IS_TRIVIALLY_COPYABLE
+        = __has_trivial_copy(T) && __has_trivial_destructor(T);
+  };
+  
+  
+//\/ Array /\//////////////////////////////////////////////////////////////////
+  
   /**
    * A resizable, one-dimensional indexed container. This class is not designed
    * to contain
    * managed objects. For managed objects, use ManagedArray.
    *
+   * Elements are kept in a block of raw memory, and only the first
+   * getSize() of them are constructed. When the capacity is exceeded, the
+   * block is reallocated; see ArrayTraits. The capacity can be set ahead of
+   * time with reserve(), and released with shrinkToFit(). For arrays that
+   * usually hold only a few elements, SmallArray avoids the heap allocation
+   * altogether.
+   *
    * @ingroup containers
    * @see ManagedArray
+   * @see SmallArray
    * @headerfile Array.h <kfoundation/Array.h>
    */
   
@@ -56,20 +94,30 @@ namespace kfoundation {
     private: T*         _data;
     private: kf_int32_t _size;
     private: kf_int32_t _capacity;
+    private: T*         _inlineData;
+    private: kf_int32_t _inlineCapacity;
     
     
   // --- (DE)CONSTRUCTORS --- //
     
     public: Array();
     public: Array(T*, kf_int32_t size);
+    protected: Array(const kf_int32_t inlineCapacity, T* const inlineData);
     public: ~Array();
     
     
   // --- METHODS --- //
     
-    private: void grow(kf_int32_t newCapacity);
+    private: void relocate(T* const target);
+    private: void reallocate(const kf_int32_t newCapacity);
+    private: void grow();
     public:  void remove(const kf_int32_t index);
     public:  void push(const T& value);
+    
+    #ifdef KF_RVALUE_REFERENCES
+    public:  void push(T&& value);
+    #endif
+    
     public:  T& push();
     public:  T pop();
     public:  T& insert(const kf_int32_t index);
@@ -78,14 +126,57 @@ namespace kfoundation {
     public:  bool isEmpty() const;
     public:  void setSize(kf_int32_t size);
     public:  inline kf_int32_t getSize() const;
+    public:  void reserve(const kf_int32_t capacity);
+    public:  void shrinkToFit();
+    public:  inline kf_int32_t getCapacity() const;
     public:  inline T& at(const kf_int32_t index);
     public:  inline const T& at(const kf_int32_t index) const;
+    public:  inline T* getData();
+    public:  inline const T* getData() const;
     public:  bool contains(const T& value) const;
     public:  kf_int32_t indexOf(const T& value) const;
     public:  kf_int32_t indexOf(const kf_int32_t offset, const T& value) const;
     
   }; // class Array
   
+  
+//\/ SmallArray /\/////////////////////////////////////////////////////////////
+  
+  /**
+   * An Array that keeps up to `N` elements inside the object itself, and
+   * moves them to the heap only when more are pushed. It shares the whole
+   * interface of Array, and can be used wherever an Array is expected:
+   *
+   *     Ptr< Array<int> > array = new SmallArray<int, 8>();
+   *
+   * Calling shrinkToFit() moves the elements back inside the object once
+   * there are `N` or fewer of them.
+   *
+   * @ingroup containers
+   * @headerfile Array.h <kfoundation/Array.h>
+   */
+  
+  template<typename T, kf_int32_t N>
+  class SmallArray : public Array<T> {
+    
+  // --- NESTED TYPES --- //
+    
+    public: typedef Ptr< SmallArray<T, N> > Ptr_t;
+    public: typedef PPtr< SmallArray<T, N> > PPtr_t;
+    
+    
+  // --- FIELDS --- //
+    
+    private: char _buffer[sizeof(T) * N]
+        __attribute__((aligned(__alignof__(T))));
+    
+    
+  // --- (DE)CONSTRUCTORS --- //
+    
+    public: SmallArray();
+    
+  }; // class SmallArray
+  
 } // namespace kfoundation
 
 #endif /* KFOUNDATION_ARRAY_DECL */
@@ -0,0 +1,101 @@
+/*---[CycleCollector.cpp]--------------------------------------m(._.)m--------*\
+ |
+ |  Project   : KFoundation
+ |  Declares  : -
+ |  Implements: kfoundation::CycleCollector::*
+ |
+ |  Copyright (c) 2013, 2014, 2015, RIKEN (The Institute of Physical and
+ |  Chemial Research) All rights reserved.
+ |
+ |  Author: Hamed KHANDAN (hamed.khandan@port.kobe-u.ac.jp)
+ |
+ |  This file is distributed under the KnoRBA Free Public License. See
+ |  LICENSE.TXT for details.
+ |
+ *//////////////////////////////////////////////////////////////////////////////
+
+// Internal
+#include "System.h"
+#include "Logger.h"
+#include "MasterMemoryManager.h"
+#include "RefCountMemoryManager.h"
+
+// Self
+#include "CycleCollector.h"
+
+namespace kfoundation {
+  
+// --- (DE)CONSTRUCTORS --- //
+  
+  /**
+   * Constructor.
+   *
+   * @param interval Time to wait between steps in milliseconds.
+   * @param maxObjectsPerStep Maximum number of objects to examine in each
+   *                          manager at each step.
+   */
+  
+  CycleCollector::CycleCollector(const kf_int32_t interval,
+      const kf_int32_t maxObjectsPerStep)
+  : Thread("CycleCollector")
+  {
+    _interval = interval;
+    _maxObjectsPerStep = maxObjectsPerStep;
+    _isStopRequested = false;
+    _nCollected = 0;
+  }
+  
+  
+// --- METHODS --- //
+  
+  /**
+   * Requests the thread to stop after the current step. Cycle collection is
+   * disabled when it stops.
+   */
+  
+  void CycleCollector::stop() {
+    _isStopRequested = true;
+  }
+  
+  
+  /**
+   * Returns the total number of objects deleted by this collector so far.
+   */
+  
+  kf_int64_t CycleCollector::getNumberOfCollectedObjects() const {
+    return _nCollected;
+  }
+  
+  
+  /**
+   * Collects cycles until stop() is called. Returns immediately, logging an
+   * error, if the default memory manager is in lock-free mode, as cycle
+   * collection cannot be enabled on it. The first step is taken one
+   * interval after enabling cycle collection, so that Ptr moves started
+   * before are finished.
+   */
+  
+  void CycleCollector::run() {
+    MasterMemoryManager& master = System::getMasterMemoryManager();
+    master.setCollectCycles(true);
+    
+    RefCountMemoryManager* manager = dynamic_cast<RefCountMemoryManager*>(
+        master.getManagerAtIndex(0));
+    
+    if(manager == NULL || !manager->isCollectingCycles()) {
+      LOG_ERR << "CycleCollector cannot run, as the default memory manager "
+          << "does not support cycle collection (e.g. it is lock-free)"
+          << EL;
+      master.setCollectCycles(false);
+      return;
+    }
+    
+    while(!_isStopRequested) {
+      System::sleep(_interval);
+      _nCollected += master.collectCycles(_maxObjectsPerStep);
+    }
+    
+    master.setCollectCycles(false);
+  }
+  
+} // namespace kfoundation
@@ -0,0 +1,84 @@
+/*---[CycleCollector.h]----------------------------------------m(._.)m--------*\
+ |
+ |  Project   : KFoundation
+ |  Declares  : kfoundation::CycleCollector::*
+ |  Implements: -
+ |
+ |  Copyright (c) 2013, 2014, 2015, RIKEN (The Institute of Physical and
+ |  Chemial Research) All rights reserved.
+ |
+ |  Author: Hamed KHANDAN (hamed.khandan@port.kobe-u.ac.jp)
+ |
+ |  This file is distributed under the KnoRBA Free Public License. See
+ |  LICENSE.TXT for details.
+ |
+ *//////////////////////////////////////////////////////////////////////////////
+
+#ifndef KFOUNDATION_CYCLECOLLECTOR
+#define KFOUNDATION_CYCLECOLLECTOR
+
+// Super
+#include "Thread.h"
+
+namespace kfoundation {
+  
+  /**
+   * Background thread that periodically collects garbage cycles. While
+   * running, cycle collection is enabled on the master memory manager, and
+   * every `interval` milliseconds, up to `maxObjectsPerStep` buffered
+   * objects of each RefCountMemoryManager are examined. Garbage cycles are
+   * deleted on this thread. Usage:
+   *
+   *     Ptr<CycleCollector> collector(new CycleCollector());
+   *     collector->start();
+   *     // ...
+   *     collector->stop();
+   *
+   * Only objects overriding ManagedObject::traverse() can be found as part
+   * of a cycle.
+   *
+   * Other threads may keep assigning and moving the pointer fields of
+   * managed objects while the collector runs. See
+   * RefCountMemoryManager::collectCycles(). The collector does not run if
+   * the default memory manager is lock-free (KF_LOCK_FREE_RETAIN); an error
+   * is logged instead.
+   *
+   * @ingroup memory
+   * @headerfile CycleCollector.h <kfoundation/CycleCollector.h>
+   */
+  
+  class CycleCollector : public Thread {
+    
+  // --- STATIC FIELDS --- //
+    
+    public: static const kf_int32_t DEFAULT_INTERVAL = 100;
+    public: static const kf_int32_t DEFAULT_MAX_OBJECTS_PER_STEP = 4096;
+    
+    
+  // --- FIELDS --- //
+    
+    private: kf_int32_t _interval;
+    private: kf_int32_t _maxObjectsPerStep;
+    private: volatile bool _isStopRequested;
+    private: volatile kf_int64_t _nCollected;
+    
+    
+  // --- (DE)CONSTRUCTORS --- //
+    
+    public: CycleCollector(const kf_int32_t interval = DEFAULT_INTERVAL,
+        const kf_int32_t maxObjectsPerStep = DEFAULT_MAX_OBJECTS_PER_STEP);
+    
+    
+  // --- METHODS --- //
+    
+    public: void stop();
+    public: kf_int64_t getNumberOfCollectedObjects() const;
+    
+    // Inherited from Thread
+    public: void run();
+    
+  };
+  
+} // namespace kfoundation
+
+#endif /* defined(KFOUNDATION_CYCLECOLLECTOR) */
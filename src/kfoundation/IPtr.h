@@ -0,0 +1,427 @@
+/*---[IPtr.h]--------------------------------------------------m(._.)m--------*\
+ |
+ |  Project   : KFoundation
+ |  Declares  : kfoundation::IPtr<T>::*
+ |  Implements: kfoundation::IPtr<T>::*
+ |
+ |  Copyright (c) 2013, 2014, 2015, RIKEN (The Institute of Physical and
+ |  Chemial Research) All rights reserved.
+ |
+ |  Author: Hamed KHANDAN (hamed.khandan@port.kobe-u.ac.jp)
+ |
+ |  This file is distributed under the KnoRBA Free Public License. See
+ |  LICENSE.TXT for details.
+ |
+ *//////////////////////////////////////////////////////////////////////////////
+
+#ifndef KFOUNDATION_IPTR
+#define KFOUNDATION_IPTR
+
+// Std
+#include <typeinfo>
+
+#ifdef KF_RVALUE_REFERENCES
+#  include <utility>
+#endif
+
+// Internal
+#include "KFException.h"
+#include "NullPointerException.h"
+#include "System.h"
+#include "IntrusiveObject.h"
+
+namespace kfoundation {
+  
+//\/ IPtr /\///////////////////////////////////////////////////////////////////
+  
+  /**
+   * Pointer to a subclass of IntrusiveObject. An IPtr is the size of an
+   * ordinary pointer, and dereferencing it costs a NULL check. Assigning it
+   * atomically increments the retain count of the new object and decrements
+   * the one of the previous object. Usage:
+   *
+   *     IPtr<MyClass> myObject = new MyClass();
+   *     IPtr<MyClass> other = myObject;
+   *     other->myMethod();
+   *
+   * Unlike Ptr, copying an IPtr always retains the object, so it can be
+   * passed and returned by value without KF_MOVE() or passive pointers.
+   * It can also be stored in a ManagedArray, declared as
+   * `ManagedArray< MyClass, IPtr<MyClass> >`.
+   *
+   * The validity of the object is not checked; see IntrusiveObject.
+   *
+   * @ingroup memory
+   * @headerfile IPtr.h <kfoundation/IPtr.h>
+   */
+  
+  template<typename T>
+  class IPtr {
+    
+  // --- FIELDS --- //
+    
+    private: T* _obj;
+    
+    
+  // --- (DE)CONSTRUCTORS --- //
+    
+    public: inline IPtr();
+    public: inline IPtr(T* const obj);
+    public: inline IPtr(const IPtr<T>& other);
+    
+    public: template<typename K>
+    inline IPtr(const IPtr<K>& other);
+    
+    #ifdef KF_RVALUE_REFERENCES
+    public: inline IPtr(IPtr<T>&& other);
+    #endif
+    
+    public: inline ~IPtr();
+    
+    
+  // --- METHODS --- //
+    
+    public: inline IPtr<T>& operator=(const IPtr<T>& other);
+    
+    #ifdef KF_RVALUE_REFERENCES
+    public: inline IPtr<T>& operator=(IPtr<T>&& other);
+    #endif
+    
+    public: inline IPtr<T>& operator=(T* const obj);
+    public: inline bool isNull() const;
+    public: inline bool isValid() const;
+    public: inline kf_int32_t getRetainCount() const;
+    public: inline T& operator*() const;
+    public: inline T* operator->() const;
+    public: inline T* toPurePtr() const;
+    public: inline bool operator==(const IPtr<T>& other) const;
+    public: inline bool operator==(const T* obj) const;
+    public: inline bool operator!=(const IPtr<T>& other) const;
+    public: inline bool operator!=(const T* obj) const;
+    
+    public: template<typename K>
+    inline bool isa() const;
+    
+    public: template<typename K>
+    IPtr<K> cast() const;
+    
+  };
+  
+  
+// --- (DE)CONSTRUCTORS --- //
+  
+  /**
+   * Constructs a NULL pointer.
+   */
+  
+  template<typename T>
+  inline IPtr<T>::IPtr() {
+    _obj = NULL;
+  }
+  
+  
+  /**
+   * Constructs a pointer to the given object, and retains it.
+   *
+   * @param obj Should be an instance of IntrusiveObject or one of its
+   *            subclasses, or NULL.
+   */
+  
+  template<typename T>
+  inline IPtr<T>::IPtr(T* const obj) {
+    _obj = obj;
+    if(_obj != NULL) {
+      _obj->retain();
+    }
+  }
+  
+  
+  /**
+   * Copy constructor. Retains the pointed object.
+   *
+   * @param other The pointer to be copied.
+   */
+  
+  template<typename T>
+  inline IPtr<T>::IPtr(const IPtr<T>& other) {
+    _obj = other._obj;
+    if(_obj != NULL) {
+      _obj->retain();
+    }
+  }
+  
+  
+  /**
+   * Constructs a pointer from a pointer to a subclass. Retains the pointed
+   * object.
+   *
+   * @param other The pointer to be copied.
+   */
+  
+  template<typename T>
+  template<typename K>
+  inline IPtr<T>::IPtr(const IPtr<K>& other) {
+    _obj = other.toPurePtr();
+    if(_obj != NULL) {
+      _obj->retain();
+    }
+  }
+  
+  
+#ifdef KF_RVALUE_REFERENCES
+  
+  /**
+   * Move constructor. Takes over the reference held by the other pointer, and
+   * leaves it NULL. Only available with C++11.
+   *
+   * @param other The pointer to be moved.
+   */
+  
+  template<typename T>
+  inline IPtr<T>::IPtr(IPtr<T>&& other) {
+    _obj = other._obj;
+    other._obj = NULL;
+  }
+  
+#endif
+  
+  
+  /**
+   * Deconstructor. Releases the pointed object.
+   */
+  
+  template<typename T>
+  inline IPtr<T>::~IPtr() {
+    if(_obj != NULL) {
+      _obj->release();
+    }
+  }
+  
+  
+// --- METHODS --- //
+  
+  /**
+   * Assignment operator. Retains the new object and releases the previous
+   * one.
+   */
+  
+  template<typename T>
+  inline IPtr<T>& IPtr<T>::operator=(const IPtr<T>& other) {
+    return *this = other._obj;
+  }
+  
+  
+#ifdef KF_RVALUE_REFERENCES
+  
+  /**
+   * Move assignment operator. Takes over the reference held by the other
+   * pointer, and releases the previous object. Only available with C++11.
+   */
+  
+  template<typename T>
+  inline IPtr<T>& IPtr<T>::operator=(IPtr<T>&& other) {
+    T* const previous = _obj;
+    _obj = other._obj;
+    other._obj = NULL;
+    
+    if(previous != NULL) {
+      previous->release();
+    }
+    
+    return *this;
+  }
+  
+#endif
+  
+  
+  /**
+   * Makes this pointer point to the given object. Retains the new object and
+   * releases the previous one.
+   *
+   * @param obj The object to point to, or NULL.
+   */
+  
+  template<typename T>
+  inline IPtr<T>& IPtr<T>::operator=(T* const obj) {
+    if(obj != NULL) {
+      obj->retain();
+    }
+    
+    T* const previous = _obj;
+    _obj = obj;
+    
+    if(previous != NULL) {
+      previous->release();
+    }
+    
+    return *this;
+  }
+  
+  
+  /**
+   * Checks if this is a NULL pointer.
+   */
+  
+  template<typename T>
+  inline bool IPtr<T>::isNull() const {
+    return _obj == NULL;
+  }
+  
+  
+  /**
+   * Checks if this pointer is not NULL. Provided for compatibility with Ptr;
+   * the pointed object is not validated.
+   */
+  
+  template<typename T>
+  inline bool IPtr<T>::isValid() const {
+    return _obj != NULL;
+  }
+  
+  
+  /**
+   * Returns the retain count of the pointed object, or zero if this is a NULL
+   * pointer.
+   */
+  
+  template<typename T>
+  inline kf_int32_t IPtr<T>::getRetainCount() const {
+    if(_obj == NULL) {
+      return 0;
+    }
+    return _obj->getRetainCount();
+  }
+  
+  
+  /**
+   * Dereference operator.
+   *
+   * @throw NullPointerException if this is a NULL pointer.
+   */
+  
+  template<typename T>
+  inline T& IPtr<T>::operator*() const {
+    if(_obj == NULL) {
+      throw NullPointerException("Attempt to dereference a null pointer to "
+          + System::demangle(typeid(T).name()));
+    }
+    return *_obj;
+  }
+  
+  
+  /**
+   * Member access operator.
+   *
+   * @throw NullPointerException if this is a NULL pointer.
+   */
+  
+  template<typename T>
+  inline T* IPtr<T>::operator->() const {
+    if(_obj == NULL) {
+      throw NullPointerException("Attempt to dereference a null pointer to "
+          + System::demangle(typeid(T).name()));
+    }
+    return _obj;
+  }
+  
+  
+  /**
+   * Returns the memory location of the pointed object.
+   */
+  
+  template<typename T>
+  inline T* IPtr<T>::toPurePtr() const {
+    return _obj;
+  }
+  
+  
+  /**
+   * Equality operator.
+   */
+  
+  template<typename T>
+  inline bool IPtr<T>::operator==(const IPtr<T>& other) const {
+    return _obj == other._obj;
+  }
+  
+  
+  /**
+   * Equality operator between an IPtr and a classic pointer.
+   */
+  
+  template<typename T>
+  inline bool IPtr<T>::operator==(const T* obj) const {
+    return _obj == obj;
+  }
+  
+  
+  /**
+   * Inequality operator.
+   */
+  
+  template<typename T>
+  inline bool IPtr<T>::operator!=(const IPtr<T>& other) const {
+    return _obj != other._obj;
+  }
+  
+  
+  /**
+   * Inequality operator between an IPtr and a classic pointer.
+   */
+  
+  template<typename T>
+  inline bool IPtr<T>::operator!=(const T* obj) const {
+    return _obj != obj;
+  }
+  
+  
+  /**
+   * Checks if the pointed object is an instance of the given type. Use via
+   * the ISA() macro.
+   */
+  
+  template<typename T>
+  template<typename K>
+  inline bool IPtr<T>::isa() const {
+    return dynamic_cast<K*>(_obj) != NULL;
+  }
+  
+  
+  /**
+   * Casts this pointer to the given type. Use via the AS() macro.
+   *
+   * @throw KFException if the pointed object is not an instance of the given
+   *        type.
+   */
+  
+  template<typename T>
+  template<typename K>
+  IPtr<K> IPtr<T>::cast() const {
+    if(_obj == NULL) {
+      return IPtr<K>();
+    }
+    
+    K* const obj = dynamic_cast<K*>(_obj);
+    if(obj == NULL) {
+      throw KFException("Invalid cast from "
+          + System::demangle(typeid(T).name()) + " to "
+          + System::demangle(typeid(K).name()));
+    }
+    
+    return IPtr<K>(obj);
+  }
+  
+  
+  /**
+   * Used by ManagedArray to hand over the reference held by one of its
+   * elements. Copying an IPtr retains the object by itself.
+   */
+  
+  template<typename T>
+  inline IPtr<T>& __k_handOver(IPtr<T>& ptr) {
+    return ptr;
+  }
+  
+} // namespace kfoundation
+
+#endif /* defined(KFOUNDATION_IPTR) */
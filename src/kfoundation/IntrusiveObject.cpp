@@ -0,0 +1,63 @@
+/*---[IntrusiveObject.cpp]-------------------------------------m(._.)m--------*\
+ |
+ |  Project   : KFoundation
+ |  Declares  : -
+ |  Implements: kfoundation::IntrusiveObject::*
+ |
+ |  Copyright (c) 2013, 2014, 2015, RIKEN (The Institute of Physical and
+ |  Chemial Research) All rights reserved.
+ |
+ |  Author: Hamed KHANDAN (hamed.khandan@port.kobe-u.ac.jp)
+ |
+ |  This file is distributed under the KnoRBA Free Public License. See
+ |  LICENSE.TXT for details.
+ |
+ *//////////////////////////////////////////////////////////////////////////////
+
+// Self
+#include "IntrusiveObject.h"
+
+namespace kfoundation {
+  
+// --- (DE)CONSTRUCTORS --- //
+  
+  /**
+   * Constructor. The new object has a retain count of zero.
+   */
+  
+  IntrusiveObject::IntrusiveObject() {
+    _retainCount = 0;
+  }
+  
+  
+  /**
+   * Copy constructor. The retain count is not copied; the new object starts
+   * with zero.
+   */
+  
+  IntrusiveObject::IntrusiveObject(const IntrusiveObject&) {
+    _retainCount = 0;
+  }
+  
+  
+  /**
+   * Deconstructor.
+   */
+  
+  IntrusiveObject::~IntrusiveObject() {
+    // Nothing;
+  }
+  
+  
+// --- METHODS --- //
+  
+  /**
+   * Assignment operator. Keeps the retain count of this object, which
+   * depends on the pointers to it, not on its content.
+   */
+  
+  IntrusiveObject& IntrusiveObject::operator=(const IntrusiveObject&) {
+    return *this;
+  }
+  
+} // namespace kfoundation
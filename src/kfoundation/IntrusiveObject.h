@@ -0,0 +1,115 @@
+/*---[IntrusiveObject.h]---------------------------------------m(._.)m--------*\
+ |
+ |  Project   : KFoundation
+ |  Declares  : kfoundation::IntrusiveObject::*
+ |  Implements: kfoundation::IntrusiveObject::retain()
+ |              kfoundation::IntrusiveObject::release()
+ |              kfoundation::IntrusiveObject::getRetainCount()
+ |
+ |  Copyright (c) 2013, 2014, 2015, RIKEN (The Institute of Physical and
+ |  Chemial Research) All rights reserved.
+ |
+ |  Author: Hamed KHANDAN (hamed.khandan@port.kobe-u.ac.jp)
+ |
+ |  This file is distributed under the KnoRBA Free Public License. See
+ |  LICENSE.TXT for details.
+ |
+ *//////////////////////////////////////////////////////////////////////////////
+
+#ifndef KFOUNDATION_INTRUSIVEOBJECT
+#define KFOUNDATION_INTRUSIVEOBJECT
+
+#include "definitions.h"
+
+#ifdef DEBUG
+#  include "InvalidPointerException.h"
+#endif
+
+namespace kfoundation {
+  
+  /**
+   * Alternative root class for objects accessed via IPtr. The retain count
+   * is kept inside the object and updated with atomic instructions, and the
+   * object is deleted when it drops to zero. Unlike ManagedObject, such
+   * objects are not registered to any memory manager, so creating them and
+   * dereferencing pointers to them involve no table lookup.
+   *
+   * In return, a pointer to a deleted object is not detected. This class is
+   * meant for frequently accessed types whose lifetime is simple enough not
+   * to need the safety checks of Ptr. Such objects are also invisible to
+   * the cycle collector and the memory statistics.
+   *
+   * A new object has a retain count of zero, and is retained by the first
+   * IPtr it is assigned to. An object that is never assigned to an IPtr,
+   * such as one on the stack, is never deleted by it.
+   *
+   * @ingroup memory
+   * @headerfile IntrusiveObject.h <kfoundation/IntrusiveObject.h>
+   */
+  
+  class IntrusiveObject {
+    
+  // --- FIELDS --- //
+    
+    private: volatile kf_int32_t _retainCount;
+    
+    
+  // --- (DE)CONSTRUCTORS --- //
+    
+    public: IntrusiveObject();
+    public: IntrusiveObject(const IntrusiveObject& other);
+    public: virtual ~IntrusiveObject();
+    
+    
+  // --- METHODS --- //
+    
+    public: IntrusiveObject& operator=(const IntrusiveObject& other);
+    public: inline void retain();
+    public: inline void release();
+    public: inline kf_int32_t getRetainCount() const;
+    
+  };
+  
+  
+// --- INLINE METHODS --- //
+  
+  /**
+   * Increases the retain count by one.
+   */
+  
+  inline void IntrusiveObject::retain() {
+    __sync_fetch_and_add(&_retainCount, 1);
+  }
+  
+  
+  /**
+   * Decreases the retain count by one, and deletes this object if it reaches
+   * zero.
+   */
+  
+  inline void IntrusiveObject::release() {
+    const kf_int32_t count = __sync_sub_and_fetch(&_retainCount, 1);
+    
+    #ifdef DEBUG
+    if(count < 0) {
+      throw InvalidPointerException("Object is released too many times");
+    }
+    #endif
+    
+    if(count == 0) {
+      delete this;
+    }
+  }
+  
+  
+  /**
+   * Returns the current retain count.
+   */
+  
+  inline kf_int32_t IntrusiveObject::getRetainCount() const {
+    return _retainCount;
+  }
+  
+} // namespace kfoundation
+
+#endif /* defined(KFOUNDATION_INTRUSIVEOBJECT) */
@@ -3,6 +3,7 @@
  |  Project   : KFoundation
  |  Declares  : -
  |  Implements: kfoundation::ManagedArray::*
+ |              kfoundation::SmallManagedArray::*
  |
  |  Copyright (c) 2013, 2014, 2015, RIKEN (The Institute of Physical and
  |  Chemial Research) All rights reserved.
@@ -38,13 +39,28 @@
 namespace kfoundation {
   
   using namespace std;
+  
+//\/ Internal /\///////////////////////////////////////////////////////////////
+  
+  /**
+   * Hands over the reference held by an element of a ManagedArray of Ptrs to
+   * the pointer copy-constructed from the returned value. See KF_MOVE().
+   */
+  
+  template<typename T>
+  inline Ptr<T>& __k_handOver(Ptr<T>& ptr) {
+    return ptr.retain();
+  }
+  
+  
+//\/ ManagedArray /\///////////////////////////////////////////////////////////
 
   /**
    * Flag returned by search methods when the desired item is not found.
    */
   
-  template<typename T>
-  const kf_int32_t ManagedArray<T>::NOT_FOUND = -1;
+  template<typename T, typename P>
+  const kf_int32_t ManagedArray<T, P>::NOT_FOUND = -1;
   
   
 // --- (DE)CONSTRUCTORS --- //
@@ -56,11 +72,12 @@ namespace kfoundation {
    * @param initialCapacity Initial capacity.
    */
   
-  template<typename T>
-  ManagedArray<T>::ManagedArray(kf_int32_t initialCapacity) {
+  template<typename T, typename P>
+  ManagedArray<T, P>::ManagedArray(kf_int32_t initialCapacity) {
     _size = 0;
     _capacity = initialCapacity;
-    _data = new Ptr<T>[_capacity];
+    _data = new P[_capacity];
+    _inlineData = NULL;
   }
   
   
@@ -69,11 +86,32 @@ namespace kfoundation {
    * capacity.
    */
   
-  template<typename T>
-  ManagedArray<T>::ManagedArray() {
+  template<typename T, typename P>
+  ManagedArray<T, P>::ManagedArray() {
     _size = 0;
     _capacity = KF_MAAGEDARRAY_INITIAL_CAPACITY;
-    _data = new Ptr<T>[_capacity];
+    _data = new P[_capacity];
+    _inlineData = NULL;
+  }
+  
+  
+  /**
+   * Creates an empty array that keeps its elements in the given pointers
+   * until they exceed the given capacity. Used by SmallManagedArray, which
+   * owns the pointers.
+   *
+   * @param inlineCapacity The number of given pointers.
+   * @param inlineData The pointers to keep the elements in.
+   */
+  
+  template<typename T, typename P>
+  ManagedArray<T, P>::ManagedArray(const kf_int32_t inlineCapacity,
+      P* const inlineData)
+  {
+    _size = 0;
+    _capacity = inlineCapacity;
+    _data = inlineData;
+    _inlineData = inlineData;
   }
   
   
@@ -81,23 +119,35 @@ namespace kfoundation {
    * Deconstructor. All elements will be released upon deconstruction.
    */
   
-  template<typename T>
-  ManagedArray<T>::~ManagedArray() {
-    delete[] _data;
+  template<typename T, typename P>
+  ManagedArray<T, P>::~ManagedArray() {
+    if(_data != _inlineData) {
+      delete[] _data;
+    }
   }
   
 
 // --- METHODS --- //
   
-  template<typename T>
-  void ManagedArray<T>::grow(kf_int32_t newCapacity) {
+  template<typename T, typename P>
+  void ManagedArray<T, P>::grow(kf_int32_t newCapacity) {
     _capacity = newCapacity;
-    Ptr<T>* newData = new Ptr<T>[_capacity];
+    P* newData = new P[_capacity];
     for(int i = 0; i < _size; i++) {
+      #ifdef KF_RVALUE_REFERENCES
+      newData[i] = std::move(_data[i]);
+      #else
       newData[i] = _data[i];
+      #endif
     }
     LOG << "ManagedArray resized to " << _capacity << EL;
-    delete[] _data;
+    if(_data == _inlineData) {
+      for(int i = 0; i < _size; i++) {
+        _data[i] = NULL;
+      }
+    } else {
+      delete[] _data;
+    }
     _data = newData;
   }
 
@@ -108,11 +158,15 @@ namespace kfoundation {
    * @param index The index of the element to be removed.
    */
   
-  template<typename T>
-  void ManagedArray<T>::remove(kf_int32_t index) {
+  template<typename T, typename P>
+  void ManagedArray<T, P>::remove(kf_int32_t index) {
     if(index < _size - 1) {
       for(int i = index; i < _size - 1; i++) {
+        #ifdef KF_RVALUE_REFERENCES
+        _data[i] = std::move(_data[i + 1]);
+        #else
         _data[i] = _data[i + 1];
+        #endif
       }
     }
     _size--;
@@ -126,8 +180,8 @@ namespace kfoundation {
    * @param value The pointer to be pushed.
    */
   
-  template<typename T>
-  void ManagedArray<T>::push(PPtr<T> value) {
+  template<typename T, typename P>
+  void ManagedArray<T, P>::push(const P& value) {
     if(_size == _capacity) {
       grow(_capacity * KF_MANAGEDARRAY_GROWTH_RATE);
     }
@@ -136,21 +190,62 @@ namespace kfoundation {
   }
   
   
+#ifdef KF_RVALUE_REFERENCES
+  
+  /**
+   * Adds the given pointer to the end of the array. The reference held by the
+   * given pointer is taken over by the array instead of retaining the object
+   * once more. Only available with C++11.
+   *
+   * @param value The pointer to be pushed.
+   */
+  
+  template<typename T, typename P>
+  void ManagedArray<T, P>::push(P&& value) {
+    if(_size == _capacity) {
+      grow(_capacity * KF_MANAGEDARRAY_GROWTH_RATE);
+    }
+    
+    _data[_size++] = std::move(value);
+  }
+  
+  
+  /**
+   * Adds the given newly created object to the end of the array, which takes
+   * over its initial reference. Only available with C++11, where it resolves
+   * the ambiguity between the other two variants.
+   *
+   * @param value The object to be pushed.
+   */
+  
+  template<typename T, typename P>
+  void ManagedArray<T, P>::push(T* const value) {
+    push(P(value));
+  }
+  
+#endif
+  
+  
   /**
    * Returns the pointer at highest index of the array, and decreases its size
-   * by one. The pointer will not be released internally, it will be released
-   * by the Ptr object returned.
+   * by one. The reference held by the array is handed over to the returned
+   * pointer.
    *
    * @return The popped pointer.
    * @throw Throws IndexOutOfBoundException if the array is empty.
    */
   
-  template<typename T>
-  Ptr<T> ManagedArray<T>::pop() {
+  template<typename T, typename P>
+  P ManagedArray<T, P>::pop() {
     if(_size == 0) {
       throw IndexOutOfBoundException("Can't pop because array is empty");
     }
-    return _data[--_size] /* will be released by receiver */;
+    
+    #ifdef KF_RVALUE_REFERENCES
+    return std::move(_data[--_size]);
+    #else
+    return __k_handOver(_data[--_size]);
+    #endif
   }
   
   
@@ -162,14 +257,18 @@ namespace kfoundation {
    * @param value The pointer to be inserted.
    */
   
-  template<typename T>
-  void ManagedArray<T>::insert(kf_int32_t index, Ptr<T> value) {
+  template<typename T, typename P>
+  void ManagedArray<T, P>::insert(kf_int32_t index, const P& value) {
     if(_size == _capacity) {
       grow(_capacity * KF_MANAGEDARRAY_GROWTH_RATE);
     }
     
     for(int i = _size - 1; i >= index; i--) {
+      #ifdef KF_RVALUE_REFERENCES
+      _data[i + 1] = std::move(_data[i]);
+      #else
       _data[i + 1] = _data[i];
+      #endif
     }
     
     _data[index] = value;
@@ -182,8 +281,8 @@ namespace kfoundation {
    * Resets the size of the array to zero and releases all existing elements.
    */
   
-  template<typename T>
-  void ManagedArray<T>::clear() {
+  template<typename T, typename P>
+  void ManagedArray<T, P>::clear() {
     for(int i = 0; i < _size; i++) {
       _data[i] = NULL;
     }
@@ -195,8 +294,8 @@ namespace kfoundation {
    * Checks if the array is empty.
    */
   
-  template<typename T>
-  bool ManagedArray<T>::isEmpty() const {
+  template<typename T, typename P>
+  bool ManagedArray<T, P>::isEmpty() const {
     return _size == 0;
   }
   
@@ -210,8 +309,8 @@ namespace kfoundation {
    * @param size The array's new size.
    */
   
-  template<typename T>
-  void ManagedArray<T>::setSize(kf_int32_t size) {
+  template<typename T, typename P>
+  void ManagedArray<T, P>::setSize(kf_int32_t size) {
     if(size > _capacity) {
       grow(size);
     }
@@ -232,8 +331,8 @@ namespace kfoundation {
    * Returns the size of the array.
    */
   
-  template<typename T>
-  inline kf_int32_t ManagedArray<T>::getSize() const {
+  template<typename T, typename P>
+  inline kf_int32_t ManagedArray<T, P>::getSize() const {
     return _size;
   }
   
@@ -246,8 +345,8 @@ namespace kfoundation {
    *        equal the size of the array.
    */
   
-  template<typename T>
-  inline Ptr<T>& ManagedArray<T>::at(const kf_int32_t index) {
+  template<typename T, typename P>
+  inline P& ManagedArray<T, P>::at(const kf_int32_t index) {
     if(index >= _size || index < 0) {
       throw IndexOutOfBoundException("Attempt to access element "
           + Int::toString(index) + " of an array of size "
@@ -265,8 +364,8 @@ namespace kfoundation {
    * @return The index of the first occurance of the given pointer, or NOT_FOUND.
    */
   
-  template<typename T>
-  kf_int32_t ManagedArray<T>::indexOf(PPtr<T> value) const {
+  template<typename T, typename P>
+  kf_int32_t ManagedArray<T, P>::indexOf(const P& value) const {
     return indexOf(0, value);
   }
   
@@ -280,9 +379,9 @@ namespace kfoundation {
    * @return The index of the desired element, or NOT_FOUND.
    */
   
-  template<typename T>
-  kf_int32_t ManagedArray<T>::indexOf(const kf_int32_t offset, PPtr<T> value)
-  const
+  template<typename T, typename P>
+  kf_int32_t ManagedArray<T, P>::indexOf(const kf_int32_t offset,
+      const P& value) const
   {
     for(kf_int32_t i = offset; i < _size; i++) {
       if(_data[i] == value) {
@@ -294,12 +393,12 @@ namespace kfoundation {
   }
   
   
-  template<typename T>
-  void ManagedArray<T>::serialize(PPtr<ObjectSerializer> builder) const {
+  template<typename T, typename P>
+  void ManagedArray<T, P>::serialize(PPtr<ObjectSerializer> builder) const {
     builder->collection();
     size_t s = _size;
     for(int i = 0; i < s; i++) {
-      ManagedObject* obj = _data[i].toPurePtr();
+      T* obj = _data[i].toPurePtr();
       if(INSTANCEOF(obj, SerializingStreamer)) {
         dynamic_cast<SerializingStreamer*>(obj)->serialize(builder);
       } else if(INSTANCEOF(obj, Streamer)) {
@@ -315,6 +414,20 @@ namespace kfoundation {
     builder->endCollection();
   }
   
+  
+//\/ SmallManagedArray /\//////////////////////////////////////////////////////
+  
+  /**
+   * Creates an empty array with room for `N` pointers inside the object.
+   */
+  
+  template<typename T, kf_int32_t N, typename P>
+  SmallManagedArray<T, N, P>::SmallManagedArray()
+  : ManagedArray<T, P>(N, _buffer)
+  {
+    // Nothing;
+  }
+  
 } // namespace kfoundation
 
 #endif /* defined(KFOUNDATION_MANAGED_ARRAY) */
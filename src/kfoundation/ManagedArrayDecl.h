@@ -2,6 +2,7 @@
  |
  |  Project   : KFoundation
  |  Declares  : kfoundation::ManagedArray::*
+ |              kfoundation::SmallManagedArray::*
  |  Implements: -
  |
  |  Copyright (c) 2013, 2014, 2015, RIKEN (The Institute of Physical and
@@ -24,6 +25,9 @@ namespace kfoundation {
   
   using namespace std;
   
+  
+//\/ ManagedArray /\///////////////////////////////////////////////////////////
+  
   /**
    * One-dimentional indexed collection of `ManagedObject`s. This class only
    * maintains pointers to the given objects. In contrast the Array class
@@ -31,19 +35,26 @@ namespace kfoundation {
    * once removed. All objects will be released open deconstruction of this
    * class.
    *
+   * By default, elements are held by Ptr. Elements of a subclass of
+   * IntrusiveObject can be held by IPtr instead, by passing it as the second
+   * template argument:
+   *
+   *     ManagedArray< MyClass, IPtr<MyClass> > array;
+   *
    * @ingroup containers
    * @ingroup memory
    * @headerfile ManagedArray.h <kfoundation/ManagedArray.h>
    * @see Array
+   * @see SmallManagedArray
    */
   
-  template<typename T>
+  template<typename T, typename P = Ptr<T> >
   class ManagedArray : public ManagedObject, public SerializingStreamer {
     
   // --- NESTED TYPES --- //
     
-    public: typedef Ptr< ManagedArray<T> > Ptr_t;
-    public: typedef Ptr< ManagedArray<T> > PPtr_t;
+    public: typedef Ptr< ManagedArray<T, P> > Ptr_t;
+    public: typedef Ptr< ManagedArray<T, P> > PPtr_t;
     
     
   // --- STATIC FIELDS --- //
@@ -53,15 +64,18 @@ namespace kfoundation {
   
   // --- FIELDS --- //
     
-    private: Ptr<T>* _data;
+    private: P* _data;
     private: kf_int32_t _size;
     private: kf_int32_t _capacity;
+    private: P* _inlineData;
 
     
   // --- (DE)CONSTRUCTORS --- //
     
     public: ManagedArray(kf_int32_t initialCapacity);
     public: ManagedArray();
+    protected: ManagedArray(const kf_int32_t inlineCapacity,
+        P* const inlineData);
     public: ~ManagedArray();
     
   
@@ -69,21 +83,61 @@ namespace kfoundation {
     
     private: void grow(kf_int32_t newCapacity);
     public: void remove(const kf_int32_t index);
-    public: void push(PPtr<T> value);
-    public: Ptr<T> pop();
-    public: void insert(const kf_int32_t index, Ptr<T> value);
+    public: void push(const P& value);
+    
+    #ifdef KF_RVALUE_REFERENCES
+    public: void push(P&& value);
+    public: void push(T* const value);
+    #endif
+    
+    public: P pop();
+    public: void insert(const kf_int32_t index, const P& value);
     public: void clear();
     public: bool isEmpty() const;
     public: void setSize(kf_int32_t size);
     public: inline kf_int32_t getSize() const;
-    public: inline Ptr<T>& at(const kf_int32_t index);
-    public: kf_int32_t indexOf(PPtr<T> value) const;
-    public: kf_int32_t indexOf(kf_int32_t offset, PPtr<T> value) const;
+    public: inline P& at(const kf_int32_t index);
+    public: kf_int32_t indexOf(const P& value) const;
+    public: kf_int32_t indexOf(kf_int32_t offset, const P& value) const;
         
     // From Srializing Streamer
     public: virtual void serialize(PPtr<ObjectSerializer> builder) const;
     
   }; // class Array
+  
+  
+//\/ SmallManagedArray /\//////////////////////////////////////////////////////
+  
+  /**
+   * A ManagedArray that keeps up to `N` pointers inside the object itself,
+   * and moves them to the heap only when more are pushed. It shares the
+   * whole interface of ManagedArray, and can be used wherever one is
+   * expected.
+   *
+   * @ingroup containers
+   * @ingroup memory
+   * @headerfile ManagedArray.h <kfoundation/ManagedArray.h>
+   */
+  
+  template<typename T, kf_int32_t N, typename P = Ptr<T> >
+  class SmallManagedArray : public ManagedArray<T, P> {
+    
+  // --- NESTED TYPES --- //
+    
+    public: typedef Ptr< SmallManagedArray<T, N, P> > Ptr_t;
+    public: typedef PPtr< SmallManagedArray<T, N, P> > PPtr_t;
+    
+    
+  // --- FIELDS --- //
+    
+    private: P _buffer[N];
+    
+    
+  // --- (DE)CONSTRUCTORS --- //
+    
+    public: SmallManagedArray();
+    
+  }; // class SmallManagedArray
     
 } // namespace kfoundation
 
@@ -19,6 +19,12 @@
 #include "Ptr.h"
 #include "MasterMemoryManager.h"
 #include "System.h"
+#include "ArenaMemoryManager.h"
+#include "AllocationProfiler.h"
+
+#ifdef KF_SLAB_ALLOCATOR
+#  include "SlabAllocator.h"
+#endif
 
 // Self
 #include "ManagedObject.h"
@@ -56,7 +62,7 @@ namespace kfoundation {
   
   
   Ptr<ManagedObject> ManagedObject::registerPtr() {
-    const ObjectRecord& rec =
+    const ObjectRecordInfo& rec =
         System::getMasterMemoryManager().registerObject(this);
     return Ptr<ManagedObject>(rec.manager, rec.index);
   }
@@ -71,6 +77,88 @@ namespace kfoundation {
   }
   
   
+  /**
+   * Passes each Ptr field of this object to the given visitor. Used by
+   * RefCountMemoryManager to find reference cycles; see
+   * RefCountMemoryManager::collectCycles(). The default implementation
+   * reports nothing, so the object is never found to be part of a cycle.
+   * Subclasses holding Ptr fields that may form cycles should override it:
+   *
+   *     void MyClass::traverse(PtrVisitor& visitor) {
+   *       visitor.visit(_next);
+   *       visitor.visit(_parent);
+   *     }
+   *
+   * Implementations should only pass fields to the visitor, without copying,
+   * assigning or dereferencing any Ptr, since they are called while the
+   * memory manager is locked. Only pointers that hold a reference, i.e. not
+   * PPtr, should be reported. The visitor may set the reported pointers to
+   * NULL when the object is about to be deleted as part of a garbage cycle.
+   * It may be called from another thread, e.g. a CycleCollector, while the
+   * fields are being modified, so only Ptr fields held directly by the
+   * object should be reported, and not the contents of containers that may
+   * be reallocated meanwhile.
+   */
+  
+  void ManagedObject::traverse(PtrVisitor&) {
+    // Nothing;
+  }
+  
+  
+  /**
+   * Allocates memory for a new instance. If the calling thread has entered an
+   * ArenaMemoryManager, the memory is taken from the arena. Otherwise, it is
+   * allocated by SlabAllocator if KF_SLAB_ALLOCATOR is defined, or by the
+   * global `new` operator. The allocation is reported to AllocationProfiler
+   * while it is enabled.
+   */
+  
+  void* ManagedObject::operator new(size_t size) {
+    void* obj;
+    ArenaMemoryManager* arena = ArenaMemoryManager::getCurrent();
+    if(arena != NULL) {
+      obj = arena->allocate(size);
+    } else {
+      #ifdef KF_SLAB_ALLOCATOR
+      obj = SlabAllocator::allocate(size);
+      #else
+      obj = ::operator new(size);
+      #endif
+    }
+    
+    if(AllocationProfiler::isEnabled()) {
+      AllocationProfiler::onAllocate(obj, size);
+    }
+    
+    return obj;
+  }
+  
+  
+  /**
+   * Frees the memory of a deleted instance. Memory taken from an arena is only
+   * freed by ArenaMemoryManager::reset(); it reaches here only when a
+   * constructor throws.
+   */
+  
+  void ManagedObject::operator delete(void* obj, size_t size) {
+    if(AllocationProfiler::isEnabled()) {
+      AllocationProfiler::onFree(obj);
+    }
+    
+    ArenaMemoryManager* arena = ArenaMemoryManager::getCurrent();
+    if(arena != NULL && arena->contains(obj)) {
+      return;
+    }
+    
+    #ifdef KF_SLAB_ALLOCATOR
+    SlabAllocator::deallocate(obj, size);
+    #else
+    (void)size;
+    ::operator delete(obj);
+    #endif
+  }
+  
+  
 //\/ PoolObject /\/////////////////////////////////////////////////////////////
   
   PoolObject::PoolObject(kf_octet_t manager, kf_int32_t index)
@@ -79,6 +167,40 @@ namespace kfoundation {
     // Nothing;
   }
   
+  /**
+   * Allocates memory for a new instance, bypassing any arena entered by the
+   * calling thread, since pool objects are deleted by their pool.
+   */
+  
+  void* PoolObject::operator new(size_t size) {
+    #ifdef KF_SLAB_ALLOCATOR
+    void* obj = SlabAllocator::allocate(size);
+    #else
+    void* obj = ::operator new(size);
+    #endif
+    
+    if(AllocationProfiler::isEnabled()) {
+      AllocationProfiler::onAllocate(obj, size);
+    }
+    
+    return obj;
+  }
+  
+  
+  void PoolObject::operator delete(void* obj, size_t size) {
+    if(AllocationProfiler::isEnabled()) {
+      AllocationProfiler::onFree(obj);
+    }
+    
+    #ifdef KF_SLAB_ALLOCATOR
+    SlabAllocator::deallocate(obj, size);
+    #else
+    (void)size;
+    ::operator delete(obj);
+    #endif
+  }
+  
+  
   /**
    * @fn kfoundation::PoolObject::finalize()
    * Cleansup this object after each use. This method should be implemented by
@@ -18,6 +18,8 @@
 #ifndef ORG_KNORBA_COMMON_MANAGEDOBJECT_H
 #define ORG_KNORBA_COMMON_MANAGEDOBJECT_H
 
+#include <cstddef>
+
 #include "definitions.h"
 #include "PtrDecl.h"
 
@@ -50,6 +52,9 @@ namespace kfoundation {
     
     private: Ptr<ManagedObject> registerPtr();
     public: PPtr<ManagedObject> getPtr() const;
+    public: virtual void traverse(PtrVisitor& visitor);
+    public: static void* operator new(size_t size);
+    public: static void operator delete(void* obj, size_t size);
     
   };
   
@@ -68,6 +73,8 @@ namespace kfoundation {
   class PoolObject : public ManagedObject {
     public: PoolObject(kf_octet_t manager, kf_int32_t index);
     public: virtual void finalize() = 0;
+    public: static void* operator new(size_t size);
+    public: static void operator delete(void* obj, size_t size);
   };
 
 } // namespace kfoundation
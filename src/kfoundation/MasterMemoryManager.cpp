@@ -16,21 +16,46 @@
 
 // Std
 #include <cassert>
+#include <sstream>
+#include <typeinfo>
 
 // Internal
 #include "Logger.h"
 #include "RefCountMemoryManager.h"
+#include "ArenaMemoryManager.h"
+#include "ObjectTable.h"
 #include "KFException.h"
-#include "MemoryException.h"
 #include "Int.h"
+#include "System.h"
+#include "ObjectSerializer.h"
+#include "Ptr.h"
 
 // Self
 #include "MasterMemoryManager.h"
 
 #define N_MAX_MANAGERS 128
+#define N_INITIAL_STATICS 256
+
+#ifdef KF_LOCK_FREE_RETAIN
+#  define KF_DEFAULT_LOCK_FREE true
+#else
+#  define KF_DEFAULT_LOCK_FREE false
+#endif
 
 namespace kfoundation {
   
+// --- STATIC METHODS --- //
+  
+  /**
+   * Called by pthread when a thread holding a shard ends.
+   */
+  
+  void MasterMemoryManager::onThreadExit(void* shard) {
+    if(PtrBase::master != NULL) {
+      PtrBase::master->releaseShard((MemoryManager*)shard);
+    }
+  }
+  
   
 // --- (DE)CONSTRUCTORS --- //
   
@@ -39,18 +64,35 @@ namespace kfoundation {
    */
   
   MasterMemoryManager::MasterMemoryManager() {
-    _recordTable = new ObjectRecord*[N_MAX_MANAGERS];
-    memset(_recordTable, 0, sizeof(ObjectRecord*)*N_MAX_MANAGERS);
+    _recordTable = new ObjectRecord**[N_MAX_MANAGERS];
+    memset(_recordTable, 0, sizeof(ObjectRecord**)*N_MAX_MANAGERS);
     
     _managers = new MemoryManager*[N_MAX_MANAGERS];
     memset(_managers, 0, sizeof(MemoryManager*)*N_MAX_MANAGERS);
     
+    _idleShards = new int[N_MAX_MANAGERS];
+    _nIdleShards = 0;
+    _isThreadAffine = false;
+    _collectCycles = false;
+    
+    _lastStats = new Statistics[N_MAX_MANAGERS];
+    memset(_lastStats, 0, sizeof(Statistics)*N_MAX_MANAGERS);
+    _lastStatsTime = System::getCurrentTimeInMiliseconds();
+    
+    pthread_mutex_init(&_mutex, NULL);
+    pthread_key_create(&_shardKey, &MasterMemoryManager::onThreadExit);
+    
     _nManagers = 0;
-    MemoryManager* first = new RefCountMemoryManager(this);
+    MemoryManager* first = new RefCountMemoryManager(this,
+        KF_DEFAULT_LOCK_FREE);
     _nStatics = 0;
+    _staticsCapacity = N_INITIAL_STATICS;
+    _statics = new PtrBase*[_staticsCapacity];
     
     assert(first == getManagerAtIndex(0));
     
+    pthread_setspecific(_shardKey, first);
+    
     PtrBase::master = this;
     PtrBase::objectTable = _recordTable;
   }
@@ -67,20 +109,186 @@ namespace kfoundation {
       }
     }
     delete[] _recordTable;
+    delete[] _idleShards;
+    delete[] _statics;
+    delete[] _lastStats;
+    
+    pthread_key_delete(_shardKey);
+    pthread_mutex_destroy(&_mutex);
   }
   
   
 // --- METHODS --- //
   
   /**
-   * Registeres a new object to the default manager.
+   * Returns the shard assigned to the calling thread. On the first call from
+   * a thread, an idle shard is reused, or a new one is created. If the 
+   * master's table is full, the default manager is used.
+   */
+  
+  MemoryManager* MasterMemoryManager::getShardOfCurrentThread() {
+    MemoryManager* shard = (MemoryManager*)pthread_getspecific(_shardKey);
+    if(shard != NULL) {
+      return shard;
+    }
+    
+    pthread_mutex_lock(&_mutex);
+    if(_nIdleShards > 0) {
+      shard = _managers[_idleShards[--_nIdleShards]];
+    }
+    pthread_mutex_unlock(&_mutex);
+    
+    if(shard == NULL) {
+      try {
+        RefCountMemoryManager* manager
+            = new RefCountMemoryManager(this, KF_DEFAULT_LOCK_FREE);
+        manager->setCollectCycles(_collectCycles);
+        shard = manager;
+      } catch(KFException& e) {
+        shard = _managers[0];
+      }
+    }
+    
+    pthread_setspecific(_shardKey, shard);
+    return shard;
+  }
+  
+  
+  /**
+   * Puts the given shard back to the idle list to be reused by another thread.
+   */
+  
+  void MasterMemoryManager::releaseShard(MemoryManager* shard) {
+    pthread_mutex_lock(&_mutex);
+    for(int i = 1; i < N_MAX_MANAGERS; i++) {
+      if(_managers[i] == shard) {
+        _idleShards[_nIdleShards++] = i;
+        break;
+      }
+    }
+    pthread_mutex_unlock(&_mutex);
+  }
+  
+  
+  /**
+   * Registeres a new object to the default manager, or in thread-affine mode,
+   * to the shard of the calling thread. If the calling thread has entered an
+   * ArenaMemoryManager, the object is registered to the arena instead.
    */
   
-  const ObjectRecord& MasterMemoryManager::registerObject(ManagedObject* ptr) {
+  const ObjectRecordInfo& MasterMemoryManager::registerObject(
+      ManagedObject* ptr)
+  {
+    ArenaMemoryManager* arena = ArenaMemoryManager::getCurrent();
+    if(arena != NULL) {
+      return arena->registerObject(ptr);
+    }
+    
+    if(_isThreadAffine) {
+      return getShardOfCurrentThread()->registerObject(ptr);
+    }
     return _managers[0]->registerObject(ptr);
   }
   
   
+  /**
+   * Enables or disables thread-affine mode.
+   *
+   * @param value If `true`, objects created by each thread will be registered
+   *              to a RefCountMemoryManager dedicated to that thread.
+   */
+  
+  void MasterMemoryManager::setThreadAffine(bool value) {
+    _isThreadAffine = value;
+  }
+  
+  
+  /**
+   * Checks if thread-affine mode is enabled.
+   */
+  
+  bool MasterMemoryManager::isThreadAffine() const {
+    return _isThreadAffine;
+  }
+  
+  
+  /**
+   * Enables or disables cycle collection for all RefCountMemoryManagers,
+   * including the shards created afterwards. Has no effect on managers in
+   * lock-free mode.
+   *
+   * While enabled, Ptr moves are performed as a retain and a release, so
+   * that collectCycles() can run alongside other threads. A move already
+   * in progress when collection is enabled is not covered, so the first
+   * collection should follow after a pause, as CycleCollector does.
+   *
+   * @param value If `true`, objects that may be part of a garbage cycle will
+   *              be buffered to be examined by collectCycles().
+   */
+  
+  void MasterMemoryManager::setCollectCycles(bool value) {
+    pthread_mutex_lock(&_mutex);
+    
+    // Moves become synchronized before any manager starts collecting, and
+    // stay so until every manager has finished its last collection.
+    if(value) {
+      _collectCycles = true;
+      __sync_synchronize();
+    }
+    
+    for(int i = 0; i < N_MAX_MANAGERS; i++) {
+      RefCountMemoryManager* manager
+          = dynamic_cast<RefCountMemoryManager*>(_managers[i]);
+      
+      if(manager != NULL) {
+        manager->setCollectCycles(value);
+      }
+    }
+    
+    if(!value) {
+      _collectCycles = false;
+    }
+    
+    pthread_mutex_unlock(&_mutex);
+  }
+  
+  
+  /**
+   * Performs one step of cycle collection on each RefCountMemoryManager.
+   * Cycles spanning more than one manager are not collected.
+   *
+   * @param maxObjectsPerManager Maximum number of objects to examine in each
+   *                             manager.
+   * @return The total number of objects deleted.
+   * @see RefCountMemoryManager::collectCycles()
+   */
+  
+  kf_int32_t MasterMemoryManager::collectCycles(
+      const kf_int32_t maxObjectsPerManager)
+  {
+    RefCountMemoryManager* managers[N_MAX_MANAGERS];
+    int n = 0;
+    
+    pthread_mutex_lock(&_mutex);
+    for(int i = 0; i < N_MAX_MANAGERS; i++) {
+      RefCountMemoryManager* manager
+          = dynamic_cast<RefCountMemoryManager*>(_managers[i]);
+      
+      if(manager != NULL) {
+        managers[n++] = manager;
+      }
+    }
+    pthread_mutex_unlock(&_mutex);
+    
+    kf_int32_t nCollected = 0;
+    for(int i = 0; i < n; i++) {
+      nCollected += managers[i]->collectCycles(maxObjectsPerManager);
+    }
+    
+    return nCollected;
+  }
+  
+  
   /**
    * Registers a new memory manager and assignes it with a unique ID.
    *
@@ -89,6 +297,8 @@ namespace kfoundation {
    */
   
   int MasterMemoryManager::registerManager(MemoryManager *manager) {
+    pthread_mutex_lock(&_mutex);
+    
     int index = -1;
     for(int i = 0; i < N_MAX_MANAGERS; i++) {
       if(_managers[i] == NULL) {
@@ -98,6 +308,7 @@ namespace kfoundation {
     }
     
     if(index == -1) {
+      pthread_mutex_unlock(&_mutex);
       throw KFException("Could not register new memory manager. "
                         "Master's table is full.");
     }
@@ -105,6 +316,11 @@ namespace kfoundation {
     _recordTable[index] = manager->getTable();
     _managers[index] = manager;
     _nManagers++;
+    
+    // The slot may have been used by a manager that is now unregistered.
+    memset(&_lastStats[index], 0, sizeof(Statistics));
+    
+    pthread_mutex_unlock(&_mutex);
     return index;
   }
   
@@ -116,9 +332,11 @@ namespace kfoundation {
    */
   
   void MasterMemoryManager::unregisterManager(int index) {
+    pthread_mutex_lock(&_mutex);
     _recordTable[index] = NULL;
     _managers[index] = NULL;
     _nManagers--;
+    pthread_mutex_unlock(&_mutex);
   }
   
   
@@ -157,32 +375,63 @@ namespace kfoundation {
   
   
   void MasterMemoryManager::migrate(MasterMemoryManager& other) {
-    int newId = dynamic_cast<RefCountMemoryManager*>(_managers[0])->migrate(other);
+    int newIds[N_MAX_MANAGERS];
+    
+    for(int i = 0; i < N_MAX_MANAGERS; i++) {
+      RefCountMemoryManager* manager
+          = dynamic_cast<RefCountMemoryManager*>(_managers[i]);
+      
+      if(manager == NULL) {
+        newIds[i] = -1;
+        continue;
+      }
+      
+      newIds[i] = manager->migrate(other);
+      _managers[i] = NULL;
+    }
     
     for(int i = 0; i < _nStatics; i++) {
-      _statics[i]->_locator.managerIndex = newId;
+      int oldId = _statics[i]->_locator.managerIndex;
+      _statics[i]->_locator.managerIndex = newIds[oldId];
     }
     
     PtrBase::master = &other;
     PtrBase::objectTable = other._recordTable;
-    _managers[0] = NULL;
   }
   
   
+  /**
+   * Registers a static pointer, so that it is updated if the objects are
+   * migrated to another master. Called by SPtr. The registry grows as
+   * needed, taking amortized constant time per pointer.
+   */
+  
   void MasterMemoryManager::registerSPtr(PtrBase *p) {
-    if(_nStatics == 100) {
-      throw MemoryException("Too many static pointers registered.");
+    pthread_mutex_lock(&_mutex);
+    
+    if(_nStatics == _staticsCapacity) {
+      PtrBase** statics = new PtrBase*[_staticsCapacity * 2];
+      memcpy(statics, _statics, sizeof(PtrBase*) * _nStatics);
+      delete[] _statics;
+      _statics = statics;
+      _staticsCapacity *= 2;
     }
     
     _statics[_nStatics] = p;
     _nStatics++;
+    
+    pthread_mutex_unlock(&_mutex);
   }
   
   
-  int MasterMemoryManager::update(kf_int16_t index, kf_int16_t key) {
-    for(int i = 0; i < _nManagers; i++) {
-      if(index < _managers[i]->getTableSize()) {
-        if(_recordTable[i][index].key == key) {
+  int MasterMemoryManager::update(kf_int32_t index, kf_objectkey_t key) {
+    for(int i = 0; i < N_MAX_MANAGERS; i++) {
+      if(_managers[i] != NULL && index < _managers[i]->getTableSize()) {
+        ObjectRecord& record
+            = _recordTable[i][index >> KF_OBJECT_TABLE_PAGE_BITS]
+                             [index & KF_OBJECT_TABLE_PAGE_MASK];
+        
+        if(record.key == key) {
           return i;
         }
       }
@@ -211,7 +460,7 @@ namespace kfoundation {
    */
   
   void MasterMemoryManager::printStats() const {
-    for(int i = 0; i < _nManagers; i++) {
+    for(int i = 0; i < N_MAX_MANAGERS; i++) {
       if(_managers[i] == NULL) {
         continue;
       }
@@ -219,13 +468,127 @@ namespace kfoundation {
       Statistics stats = _managers[i]->getStats();
       LOG << "Manager[" << i << "]:  Alive objects: "
           << stats.nObjects - stats.nStaticObjects << " automatic + "
-          << stats.nStaticObjects << " static" << EL;
+          << stats.nStaticObjects << " static, peak: " << stats.peakObjects
+          << ", allocated: " << stats.nAllocations << ", released: "
+          << stats.nReleases << ", table: " << stats.tableSize
+          << " records, grown " << stats.nGrowths << " times" << EL;
+    }
+  }
+  
+  
+  /**
+   * Serializes the counters of all registered managers, along with their
+   * allocations and releases per second since the previous call to this
+   * method. The counters are read in constant time per manager, and no
+   * manager is locked. In JSON, the output looks like this:
+   *
+   *     { "time" : 1420070400000, "interval" : 1000, "managers" : [
+   *       { "id" : 0, "type" : "kfoundation::RefCountMemoryManager",
+   *         "nObjects" : 120, "nStaticObjects" : 2, "peakObjects" : 300,
+   *         "tableSize" : 1024, "nGrowths" : 2, "nAllocations" : 1302,
+   *         "nReleases" : 1182, "allocationsPerSecond" : 650,
+   *         "releasesPerSecond" : 640 }, ... ] }
+   *
+   * `time` is in miliseconds since epoch, and `interval` is the number of
+   * miliseconds since the previous call, or since this master was created.
+   * See Statistics for the meaning of each counter.
+   *
+   * @param serializer The serializer to output to.
+   */
+  
+  void MasterMemoryManager::serializeStats(PPtr<ObjectSerializer> serializer)
+  {
+    Statistics stats[N_MAX_MANAGERS];
+    Statistics last[N_MAX_MANAGERS];
+    string types[N_MAX_MANAGERS];
+    bool isUsed[N_MAX_MANAGERS];
+    
+    // The counters are copied under the mutex, and serialized after it is
+    // released, since serializing registers new objects.
+    pthread_mutex_lock(&_mutex);
+    
+    kf_int64_t now = System::getCurrentTimeInMiliseconds();
+    kf_int64_t interval = now - _lastStatsTime;
+    _lastStatsTime = now;
+    
+    for(int i = 0; i < N_MAX_MANAGERS; i++) {
+      isUsed[i] = _managers[i] != NULL;
+      if(!isUsed[i]) {
+        continue;
+      }
+      stats[i] = _managers[i]->getStats();
+      last[i] = _lastStats[i];
+      _lastStats[i] = stats[i];
+      types[i] = System::demangle(typeid(*_managers[i]).name());
     }
+    
+    pthread_mutex_unlock(&_mutex);
+    
+    serializer->object("MemoryStatistics")
+      ->attribute("time", now)
+      ->attribute("interval", interval)
+      ->member("managers")->collection();
+    
+    double seconds = interval / 1000.0;
+    
+    for(int i = 0; i < N_MAX_MANAGERS; i++) {
+      if(!isUsed[i]) {
+        continue;
+      }
+      
+      kf_int64_t nAllocations = stats[i].nAllocations - last[i].nAllocations;
+      kf_int64_t nReleases = stats[i].nReleases - last[i].nReleases;
+      
+      // The manager has been replaced since the previous call.
+      if(nAllocations < 0 || nReleases < 0) {
+        nAllocations = stats[i].nAllocations;
+        nReleases = stats[i].nReleases;
+      }
+      
+      serializer->object("MemoryManager")
+        ->attribute("id", i)
+        ->attribute("type", types[i])
+        ->attribute("nObjects", stats[i].nObjects)
+        ->attribute("nStaticObjects", stats[i].nStaticObjects)
+        ->attribute("peakObjects", stats[i].peakObjects)
+        ->attribute("tableSize", stats[i].tableSize)
+        ->attribute("nGrowths", stats[i].nGrowths)
+        ->attribute("nAllocations", stats[i].nAllocations)
+        ->attribute("nReleases", stats[i].nReleases)
+        ->attribute("allocationsPerSecond",
+            seconds > 0 ? nAllocations / seconds : 0.0)
+        ->attribute("releasesPerSecond",
+            seconds > 0 ? nReleases / seconds : 0.0)
+        ->endObject();
+    }
+    
+    serializer->endCollection();
+    serializer->endObject();
+  }
+  
+  
+  /**
+   * Returns the output of serializeStats() in JSON format.
+   */
+  
+  string MasterMemoryManager::getStatsAsJson() {
+    stringstream stream;
+    Ptr<ObjectSerializer> serializer(
+        new ObjectSerializer(stream, ObjectSerializer::JSON, 4));
+    serializeStats(serializer);
+    return stream.str();
   }
   
   
   void MasterMemoryManager::finalize() {
-    dynamic_cast<RefCountMemoryManager*>(_managers[0])->finalize();
+    for(int i = 0; i < N_MAX_MANAGERS; i++) {
+      RefCountMemoryManager* manager
+          = dynamic_cast<RefCountMemoryManager*>(_managers[i]);
+      
+      if(manager != NULL) {
+        manager->finalize();
+      }
+    }
   }
   
 } // namespace kfoundation
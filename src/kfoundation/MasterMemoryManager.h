@@ -33,6 +33,24 @@ namespace kfoundation {
    * This object always owns an instance of RefCountMemoryManager as its 
    * default manager. To access use `getManagerAtIndex(0)`.
    *
+   * In thread-affine mode (see setThreadAffine()), each thread registers its
+   * objects to its own RefCountMemoryManager shard instead, so that threads
+   * creating objects concurrently do not contend on the same table. The thread
+   * that created the master uses the default manager. Since every pointer
+   * carries the index of the manager that owns its object, releases from any
+   * thread are routed to the owning shard. When a thread ends, its shard is
+   * kept alive along with its objects and is handed over to the next new
+   * thread.
+   *
+   * Cycle collection can be enabled for all RefCountMemoryManagers with
+   * setCollectCycles(), and performed with collectCycles(), e.g. by a
+   * CycleCollector thread, while other threads keep modifying the objects;
+   * see RefCountMemoryManager::collectCycles().
+   *
+   * The counters of all managers can be polled in JSON format with
+   * getStatsAsJson(), for example by a monitoring thread, without pausing
+   * the rest of the process.
+   *
    * @ingroup memory
    * @headerfile MasterMemoryManager.h <kfoundation/MasterMemoryManager.h>
    */
@@ -41,14 +59,30 @@ namespace kfoundation {
     
   // --- FIELDS --- //
     
-    private: ObjectRecord** _recordTable;
+    private: ObjectRecord*** _recordTable;
     private: MemoryManager** _managers;
     private: int _nManagers;
     
-    private: PtrBase* _statics[100];
+    private: PtrBase** _statics;
     private: int _nStatics;
+    private: int _staticsCapacity;
+    
+    private: pthread_mutex_t _mutex;
+    private: pthread_key_t _shardKey;
+    private: int* _idleShards;
+    private: int _nIdleShards;
+    private: bool _isThreadAffine;
+    private: volatile bool _collectCycles;
+    
+    private: Statistics* _lastStats;
+    private: kf_int64_t _lastStatsTime;
     
   
+  // --- STATIC METHODS --- //
+    
+    private: static void onThreadExit(void* shard);
+    
+    
   // --- (DE)CONSTRUCTORS --- //
     
     public: MasterMemoryManager();
@@ -57,21 +91,42 @@ namespace kfoundation {
     
   // --- METHODS --- //
     
-    public: const ObjectRecord& registerObject(ManagedObject* ptr);
+    private: MemoryManager* getShardOfCurrentThread();
+    private: void releaseShard(MemoryManager* shard);
+    public: const ObjectRecordInfo& registerObject(ManagedObject* ptr);
+    public: void setThreadAffine(bool value);
+    public: bool isThreadAffine() const;
+    public: void setCollectCycles(bool value);
+    public: inline bool isCollectingCycles() const;
+    public: kf_int32_t collectCycles(const kf_int32_t maxObjectsPerManager);
     public: int registerManager(MemoryManager* manager);
     public: void unregisterManager(int index);
     public: kf_octet_t getNManagers();
     public: MemoryManager* getManagerAtIndex(int index);
-    public: ObjectRecord** getTable();
+    public: ObjectRecord*** getTable();
     public: void updataTable(int index);
     public: void migrate(MasterMemoryManager& other);
     public: void registerSPtr(PtrBase* p);
-    public: int update(kf_int16_t index, kf_int16_t key);
+    public: int update(kf_int32_t index, kf_objectkey_t key);
     public: void dump() const;
     public: void printStats() const;
+    public: void serializeStats(PPtr<ObjectSerializer> serializer);
+    public: string getStatsAsJson();
     public: void finalize();
   };
   
+  
+// --- INLINE METHODS --- //
+  
+  /**
+   * Checks if cycle collection is enabled. Read by Ptr on every move, so it
+   * takes no lock.
+   */
+  
+  inline bool MasterMemoryManager::isCollectingCycles() const {
+    return _collectCycles;
+  }
+  
 }
 
 #endif /* defined(KFOUNDATION_MASTERMEMORYMANAGER) */
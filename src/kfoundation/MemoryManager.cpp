@@ -3,6 +3,7 @@
  |  Project   : KFoundation
  |  Declares  : -
  |  Implements: kfoundation::MemoryManager::~MemoryManager()
+ |              kfoundation::MemoryManager::releaseBatch()
  |
  |  Copyright (c) 2013, 2014, 2015, RIKEN (The Institute of Physical and
  |  Chemial Research) All rights reserved.
@@ -16,6 +17,8 @@
 
 #include "System.h"
 #include "ObjectSerializer.h"
+#include "KFException.h"
+#include "InvalidPointerException.h"
 
 #include "MemoryManager.h"
 
@@ -29,6 +32,54 @@ namespace kfoundation {
     // Nothing;
   }
   
+  
+  /**
+   * Releases a number of objects at once. The default implementation calls
+   * release() for each of them. Managers can override it to synchronize once
+   * for the whole batch. Used by ReleasePool. If releasing any of the objects
+   * throws, the rest of the batch is still released, and the first exception
+   * is rethrown afterwards.
+   *
+   * @param indexes Indexes of the records to be released.
+   * @param keys Keys of the records to be released, in the same order.
+   * @param n Number of records to be released.
+   */
+  
+  void MemoryManager::releaseBatch(const kf_int32_t* indexes,
+      const kf_objectkey_t* keys, const kf_int32_t n)
+  {
+    // Copies of the first failure. Invalid pointers are kept apart so that
+    // they are rethrown with their own type.
+    InvalidPointerException* invalid = NULL;
+    KFException* error = NULL;
+    
+    for(kf_int32_t i = 0; i < n; i++) {
+      try {
+        release(indexes[i], keys[i]);
+      } catch(InvalidPointerException& e) {
+        if(invalid == NULL && error == NULL) {
+          invalid = new InvalidPointerException(e);
+        }
+      } catch(KFException& e) {
+        if(invalid == NULL && error == NULL) {
+          error = new KFException(e);
+        }
+      }
+    }
+    
+    if(invalid != NULL) {
+      InvalidPointerException e(*invalid);
+      delete invalid;
+      throw e;
+    }
+    
+    if(error != NULL) {
+      KFException e(*error);
+      delete error;
+      throw e;
+    }
+  }
+  
 }
 
 /**
@@ -38,14 +89,23 @@ namespace kfoundation {
  */
 
 /**
- * @fn kfoundation::MemoryManager::retain(kf_int32_t, kf_int16_t)
+ * @fn kfoundation::MemoryManager::retain(kf_int32_t, kf_objectkey_t)
  *
  * Retains the object associated with the given index if key maches,
  * otherwise throws InvalidPointerException.
  */
 
 /**
- * @fn kfoundation::MemoryManager::release(kf_int32_t, kf_int16_t)
+ * @fn kfoundation::MemoryManager::tryRetain(kf_int32_t, kf_objectkey_t)
+ *
+ * Retains the object associated with the given index if the key matches and
+ * the object is not being deleted, and returns `true`. Otherwise, returns
+ * `false` without throwing. The check and the retain are performed
+ * atomically with respect to release(). Called by WPtr.
+ */
+
+/**
+ * @fn kfoundation::MemoryManager::release(kf_int32_t, kf_objectkey_t)
  *
  * Releases the object associated with the given index if the key
  * matches, otherwise throws InvalidPointerException. If the retain 
@@ -53,18 +113,28 @@ namespace kfoundation {
  */
 
 /**
- * @fn kfoundation::MemoryManager::remove(kf_int32_t, kf_int16_t)
+ * @fn kfoundation::MemoryManager::remove(kf_int32_t, kf_objectkey_t)
  * 
  * Unmanages the object at the given index if the key matches, 
  * otherwise, throws InvalidPointerException. The index will be
  * reused in the future.
  */
 
+/**
+ * @fn kfoundation::MemoryManager::setStatic(kf_int32_t, kf_objectkey_t)
+ *
+ * Marks the object at the given index as static if the key matches,
+ * otherwise throws InvalidPointerException. Static objects are not retain
+ * counted, and live until the manager is finalized. Called by SPtr.
+ */
+
 /**
  * @fn kfoundation::MemoryManager::getTable()
  * 
- * Returns the memory locatoin of the begining of this manager's object table.
- * The object table is a one dimentional array of ObjectRecord.
+ * Returns the page directory of this manager's object table. The record at
+ * index `i` is found at page `i >> KF_OBJECT_TABLE_PAGE_BITS`, offset
+ * `i & KF_OBJECT_TABLE_PAGE_MASK`. The directory never moves, so the returned
+ * pointer stays valid as the table grows. See ObjectTable.
  *
  * @see getTableSize()
  */
@@ -77,4 +147,11 @@ namespace kfoundation {
  * managed by this manager.
  *
  * @see getTable()
- */
\ No newline at end of file
+ */
+
+/**
+ * @fn kfoundation::MemoryManager::getStats()
+ *
+ * Returns the current counters of this manager in constant time, without
+ * blocking retain(), release() or the registration of new objects.
+ */
@@ -2,6 +2,7 @@
  |
  |  Project   : KFoundation
  |  Declares  : struct kfoundation::ObjectRecord
+ |              struct kfoundation::ObjectRecordInfo
  |              struct kfoundation::Statistics
  |              class kfoundation::MemoryManager
  |  Implements: -
@@ -19,6 +20,7 @@
 #ifndef KFOUNDATION_MEMORYMANAGER
 #define KFOUNDATION_MEMORYMANAGER
 
+#include <cstddef>
 #include <pthread.h>
 
 #include "definitions.h"
@@ -28,27 +30,102 @@
 namespace kfoundation {
   
   /**
-   * Structure of memory manager's table records.
+   * Structure of memory manager's table records. Only holds the fields needed
+   * to validate and dereference a pointer, and to retain and release it, so
+   * that four records fit in a cache line. The rest of the information about
+   * each record is kept in a parallel ObjectRecordInfo.
    * @headerfile MemoryManager.h <kfoundation/MemoryManager.h>
    */
   
   struct ObjectRecord  {
     ManagedObject* ptr;        ///< Memory location of the target object
-    kf_int16_t retainCount;    ///< Retain count
-    kf_int16_t key;            ///< Key
-    kf_int8_t  manager;        ///< The ID of the manager owning this table
-    kf_int16_t index;          ///< Index of this record
-    kf_int32_t serialNumber;   ///< Unique serial number for this object
+    kf_retaincount_t retainCount; ///< Retain count
+    kf_objectkey_t   key;         ///< Key
+  };
+  
+  
+  /**
+   * Less frequently accessed fields of a table record. Stored apart from the
+   * ObjectRecord with the same index. See ObjectTable.
+   * @headerfile MemoryManager.h <kfoundation/MemoryManager.h>
+   */
+  
+  struct ObjectRecordInfo {
+    kf_int8_t        manager;     ///< The ID of the manager owning this table
+    kf_objectindex_t index;       ///< Index of this record
+    union {
+      kf_int32_t serialNumber; ///< Unique serial number for this object
+      kf_int32_t nextFree;     ///< Next unused record, while this is unused
+    };
     bool       isStatic;       ///< `true' if the object is static
     bool       isBeingDeleted; ///< Flag for internal use
+    bool       isBuffered;     ///< `true' if buffered as a possible cycle
   };
   
   
+  /**
+   * Counters reported by MemoryManager::getStats(). Managers maintain them
+   * as objects come and go, so reading them takes constant time and no lock.
+   * The counters of a manager in use may be a few operations apart from each
+   * other. Rates can be obtained by sampling nAllocations and nReleases
+   * periodically; see MasterMemoryManager::serializeStats().
+   * @headerfile MemoryManager.h <kfoundation/MemoryManager.h>
+   */
+  
   struct Statistics {
-    kf_int32_t nObjects;
-    kf_int32_t nStaticObjects;
+    kf_int32_t nObjects;       ///< Live objects, including static ones
+    kf_int32_t nStaticObjects; ///< Live static objects
+    kf_int32_t peakObjects;    ///< Largest value nObjects has reached
+    kf_int32_t tableSize;      ///< Number of records in the table
+    kf_int32_t nGrowths;       ///< Number of times the table has grown
+    kf_int64_t nAllocations;   ///< Number of objects registered so far
+    kf_int64_t nReleases;      ///< Number of objects discarded so far
   };
-
+  
+  
+  #ifdef KF_WIDE_OBJECT_RECORD
+  typedef kf_int64_t __attribute__((__may_alias__)) __k_recordword_t;
+  #else
+  typedef kf_int32_t __attribute__((__may_alias__)) __k_recordword_t;
+  #endif
+  
+  
+  /**
+   * Overlays ObjectRecord::retainCount and ObjectRecord::key so that both can
+   * be read and compare-and-swapped as a single word by managers that update
+   * records without locking.
+   */
+  
+  union __k_RecordState {
+    __k_recordword_t word;
+    struct {
+      kf_retaincount_t retainCount;
+      kf_objectkey_t key;
+    } fields;
+  };
+  
+  typedef char __k_recordStateLayoutCheck[
+      offsetof(ObjectRecord, key) == offsetof(ObjectRecord, retainCount)
+      + sizeof(kf_retaincount_t)
+      && sizeof(__k_RecordState) == sizeof(__k_recordword_t)
+      ? 1 : -1];
+  
+  
+  inline __k_RecordState __k_loadState(ObjectRecord& record) {
+    __k_RecordState state;
+    state.word = *(volatile __k_recordword_t*)&record.retainCount;
+    return state;
+  }
+  
+  
+  inline bool __k_swapState(ObjectRecord& record,
+      const __k_RecordState& expected, const __k_RecordState& replacement)
+  {
+    return __sync_bool_compare_and_swap(
+        (__k_recordword_t*)&record.retainCount, expected.word,
+        replacement.word);
+  }
+  
   
   /**
    * Abstract interface to be implemented by all memory managers.
@@ -58,18 +135,36 @@ namespace kfoundation {
    */
   
   class MemoryManager {
+    protected: static inline kf_objectkey_t nextKey(const kf_objectkey_t key);
     public: virtual ~MemoryManager();
-    public: virtual const ObjectRecord& registerObject(ManagedObject* obj) = 0;
-    public: virtual void retain(kf_int32_t index, kf_int16_t key) = 0;
-    public: virtual void release(kf_int32_t index, kf_int16_t key) = 0;
-    public: virtual void remove(kf_int32_t index, kf_int16_t key) = 0;
-    public: virtual ObjectRecord* getTable() = 0;
+    public: virtual const ObjectRecordInfo& registerObject(
+        ManagedObject* obj) = 0;
+    public: virtual void retain(kf_int32_t index, kf_objectkey_t key) = 0;
+    public: virtual bool tryRetain(kf_int32_t index, kf_objectkey_t key) = 0;
+    public: virtual void release(kf_int32_t index, kf_objectkey_t key) = 0;
+    public: virtual void releaseBatch(const kf_int32_t* indexes,
+        const kf_objectkey_t* keys, const kf_int32_t n);
+    public: virtual void remove(kf_int32_t index, kf_objectkey_t key) = 0;
+    public: virtual void setStatic(kf_int32_t index, kf_objectkey_t key) = 0;
+    public: virtual ObjectRecord** getTable() = 0;
     public: virtual kf_int32_t getTableSize() const = 0;
     public: virtual void trace(const pthread_t theadId) = 0;
     public: virtual void untrace() = 0;
     public: virtual Statistics getStats() const = 0;
   };
   
+  
+  /**
+   * Returns the generation that follows the given key. Managers advance the
+   * key of a record every time its object is discarded, so a pointer to a
+   * previous occupant of the record fails validation until the key wraps
+   * around.
+   */
+  
+  inline kf_objectkey_t MemoryManager::nextKey(const kf_objectkey_t key) {
+    return (kf_objectkey_t)((unsigned int)key + 1);
+  }
+  
 } // namespace kfoundation
 
 #endif
@@ -18,6 +18,8 @@
 #define KFOUNDATION_NUMERICVECTOR
 
 #include "KFException.h"
+#include "Ptr.h"
+#include "VectorKernels.h"
 #include "NumericVectorDecl.h"
 #include "StringInputStream.h"
 #include "PredictiveParserBase.h"
@@ -52,8 +54,59 @@ namespace kfoundation {
   {
     // Nothing;
   }
+  
+  
+  /**
+   * Constructor, creates a new NumericVector holding the result of the given
+   * expression, computed in a single pass.
+   *
+   * @param expression The expression to evaluate.
+   */
+  
+  template<typename T>
+  template<typename E>
+  NumericVector<T>::NumericVector(const VectorExpression<T, E>& expression)
+  : Array<T>()
+  {
+    assign(expression);
+  }
 
   
+  template<typename T>
+  void NumericVector<T>::checkSize(const Ptr< NumericVector<T> >& other) const
+  {
+    __k_checkVectorSizes(Array<T>::getSize(), other->getSize());
+  }
+  
+  
+  /**
+   * Returns an expression referring to the elements of this vector, to be
+   * combined with others and evaluated by assign(). See VectorExpression.
+   */
+  
+  template<typename T>
+  VectorExpression< T, __k_VectorRef<T> > NumericVector<T>::expr() const {
+    return VectorExpression< T, __k_VectorRef<T> >(
+        __k_VectorRef<T>(Array<T>::getData(), Array<T>::getSize()));
+  }
+  
+  
+  /**
+   * Resizes this vector to the size of the given expression, and sets its
+   * elements to the result of the expression, computed in a single pass. The
+   * expression may refer to this vector.
+   *
+   * @param expression The expression to evaluate.
+   */
+  
+  template<typename T>
+  template<typename E>
+  void NumericVector<T>::assign(const VectorExpression<T, E>& expression) {
+    Array<T>::setSize(expression.getSize());
+    expression.evaluate(Array<T>::getData());
+  }
+  
+  
   /**
    * Returns the pointer to a new NumericVector whos elements are the negative
    * of their corresponding elements in this object.
@@ -61,11 +114,11 @@ namespace kfoundation {
   
   template<typename T>
   Ptr< NumericVector<T> > NumericVector<T>::negate() const {
-    AutoPtr< NumericVector<T> > result(new NumericVector<T>());
-    for(kf_int32_t i = Array<T>::getSize() - 1; i >= 0; i--) {
-      result->set(- Array<T>::get(i));
-    }
-    return result.retain();
+    kf_int32_t n = Array<T>::getSize();
+    Ptr< NumericVector<T> > result(new NumericVector<T>());
+    result->setSize(n);
+    VectorKernels::negate(Array<T>::getData(), result->getData(), n);
+    return KF_MOVE(result);
   }
 
   
@@ -79,11 +132,13 @@ namespace kfoundation {
   template<typename T>
   Ptr< NumericVector<T> >
   NumericVector<T>::add(const Ptr< NumericVector<T> >& other) const {
+    checkSize(other);
+    kf_int32_t n = Array<T>::getSize();
     Ptr< NumericVector<T> > result(new NumericVector<T>());
-    for(kf_int32_t i = Array<T>::getSize() - 1; i >= 0; i--) {
-      result->set(Array<T>::get(i) + other->get(i));
-    }
-    return result.retain();
+    result->setSize(n);
+    VectorKernels::add(Array<T>::getData(), other->getData(),
+        result->getData(), n);
+    return KF_MOVE(result);
   }
   
 
@@ -97,11 +152,13 @@ namespace kfoundation {
   template<typename T>
   Ptr< NumericVector<T> >
   NumericVector<T>::sub(const Ptr< NumericVector<T> >& other) const {
-    AutoPtr< NumericVector<T> > result(new NumericVector<T>());
-    for(kf_int32_t i = Array<T>::getSize() - 1; i >= 0; i--) {
-      result->set(Array<T>::get(i) - other->get(i));
-    }
-    return result.retain();
+    checkSize(other);
+    kf_int32_t n = Array<T>::getSize();
+    Ptr< NumericVector<T> > result(new NumericVector<T>());
+    result->setSize(n);
+    VectorKernels::sub(Array<T>::getData(), other->getData(),
+        result->getData(), n);
+    return KF_MOVE(result);
   }
 
   
@@ -114,11 +171,129 @@ namespace kfoundation {
   
   template<typename T>
   Ptr< NumericVector<T> > NumericVector<T>::mul(const T& coef) const {
-    AutoPtr< NumericVector<T> > result(new NumericVector<T>());
-    for(kf_int32_t i = Array<T>::getSize() - 1; i >= 0; i--) {
-      result->set(Array<T>::get(i) * coef);
-    }
-    return result.retain();
+    kf_int32_t n = Array<T>::getSize();
+    Ptr< NumericVector<T> > result(new NumericVector<T>());
+    result->setSize(n);
+    VectorKernels::mul(Array<T>::getData(), coef, result->getData(), n);
+    return KF_MOVE(result);
+  }
+  
+  
+  /**
+   * Negates every element of this vector.
+   */
+  
+  template<typename T>
+  void NumericVector<T>::negateInPlace() {
+    VectorKernels::negate(Array<T>::getData(), Array<T>::getData(),
+        Array<T>::getSize());
+  }
+  
+  
+  /**
+   * Adds the given vector to this one.
+   *
+   * @param other The vector to add to this one.
+   */
+  
+  template<typename T>
+  void NumericVector<T>::addInPlace(const Ptr< NumericVector<T> >& other) {
+    checkSize(other);
+    VectorKernels::add(Array<T>::getData(), other->getData(),
+        Array<T>::getData(), Array<T>::getSize());
+  }
+  
+  
+  /**
+   * Substracts the given vector from this one.
+   *
+   * @param other The vector to substract from this one.
+   */
+  
+  template<typename T>
+  void NumericVector<T>::subInPlace(const Ptr< NumericVector<T> >& other) {
+    checkSize(other);
+    VectorKernels::sub(Array<T>::getData(), other->getData(),
+        Array<T>::getData(), Array<T>::getSize());
+  }
+  
+  
+  /**
+   * Multiplies every element of this vector to the given scalar value.
+   *
+   * @param coef The scalar value to multiply this vector to.
+   */
+  
+  template<typename T>
+  void NumericVector<T>::mulInPlace(const T& coef) {
+    VectorKernels::mul(Array<T>::getData(), coef, Array<T>::getData(),
+        Array<T>::getSize());
+  }
+  
+  
+  /**
+   * Adds the given vector multiplied by the given scalar value to this one,
+   * that is `this = this + coef * other`.
+   *
+   * @param coef The scalar value to multiply the other vector to.
+   * @param other The vector to add to this one.
+   */
+  
+  template<typename T>
+  void NumericVector<T>::fma(const T& coef,
+      const Ptr< NumericVector<T> >& other)
+  {
+    checkSize(other);
+    VectorKernels::fma(other->getData(), coef, Array<T>::getData(),
+        Array<T>::getData(), Array<T>::getSize());
+  }
+  
+  
+  /**
+   * Returns the dot product of this vector and the given one.
+   *
+   * @param other The vector to multiply this one to.
+   */
+  
+  template<typename T>
+  T NumericVector<T>::dot(const Ptr< NumericVector<T> >& other) const {
+    checkSize(other);
+    return VectorKernels::dot(Array<T>::getData(), other->getData(),
+        Array<T>::getSize());
+  }
+  
+  
+  /**
+   * Returns the sum of the elements of this vector.
+   */
+  
+  template<typename T>
+  T NumericVector<T>::sum() const {
+    return VectorKernels::sum(Array<T>::getData(), Array<T>::getSize());
+  }
+  
+  
+  /**
+   * Returns the smallest element of this vector.
+   *
+   * @throw IndexOutOfBoundException if this vector is empty.
+   */
+  
+  template<typename T>
+  T NumericVector<T>::min() const {
+    return VectorKernels::min(Array<T>::getData(), Array<T>::getSize());
+  }
+  
+  
+  /**
+   * Returns the largest element of this vector.
+   *
+   * @throw IndexOutOfBoundException if this vector is empty.
+   */
+  
+  template<typename T>
+  T NumericVector<T>::max() const {
+    return VectorKernels::max(Array<T>::getData(), Array<T>::getSize());
   }
   
   
@@ -133,8 +308,9 @@ namespace kfoundation {
   Ptr< NumericVector<T> > NumericVector<T>::parseInt(const string& str) {
     Ptr< NumericVector<T> > v(new NumericVector<T>());
     
-    AutoPtr<StringInputStream> input(new StringInputStream(str));
-    AutoPtr<PredictiveParserBase> parser(new PredictiveParserBase(input.AS(InputStream)));
+    Ptr<StringInputStream> input(new StringInputStream(str));
+    Ptr<PredictiveParserBase> parser(
+        new PredictiveParserBase(input.AS(InputStream)));
     parser->skipSpacesAndNewLines();
     parser->readChar('{');
     while(true) {
@@ -145,11 +321,11 @@ namespace kfoundation {
       parser->readChar(',');
       parser->skipSpacesAndNewLines();
       if(parser->readChar('}') || parser->testEndOfStream()) {
-        return v;
+        return KF_MOVE(v);
       }
     }
     
-    return v;
+    return KF_MOVE(v);
   }
   
   
@@ -163,7 +339,7 @@ namespace kfoundation {
         os << ", ";
       }
       
-      os << Array<T>::get(i);
+      os << Array<T>::at(i);
     }
     os << "}";
   }
@@ -19,6 +19,7 @@
 
 #include "Array.h"
 #include "Streamer.h"
+#include "VectorExpression.h"
 
 namespace kfoundation {
   
@@ -26,20 +27,51 @@ namespace kfoundation {
    * A subclass of Array, adds numeric operations. Can also convert the contents
    * to and from string.
    *
+   * Operations are carried out by VectorKernels, which uses SIMD instructions
+   * for `kf_int32_t`, `float` and `double` elements. negate(), add(), sub()
+   * and mul() return a new vector; their in-place variants, as well as fma()
+   * and the reductions, allocate nothing. Operations on two vectors require
+   * them to have the same size.
+   *
+   * Chains of element-wise operations can be fused into a single pass with
+   * expr(), which avoids the intermediate vectors; see VectorExpression:
+   *
+   *     r->assign((a->expr() + b->expr() - c->expr()) * k);
+   *
    * @ingroup containers
    * @headerfile NumericVector.h <kfounadtion/NumericVector.h>
    */
   
   template<typename T>
   class NumericVector : public Array<T>, public Streamer {
+  private:
+    void checkSize(const Ptr< NumericVector<T> >& other) const;
+    
   public:
     NumericVector();
     NumericVector(T* values, kf_int32_t size);
     
+    template<typename E>
+    NumericVector(const VectorExpression<T, E>& expression);
+    
+    VectorExpression< T, __k_VectorRef<T> > expr() const;
+    
+    template<typename E>
+    void assign(const VectorExpression<T, E>& expression);
+    
     Ptr< NumericVector<T> > negate() const;
     Ptr< NumericVector<T> > add(const Ptr< NumericVector<T> >& other) const;
     Ptr< NumericVector<T> > sub(const Ptr< NumericVector<T> >& other) const;
     Ptr< NumericVector<T> > mul(const T& coef) const;
+    void negateInPlace();
+    void addInPlace(const Ptr< NumericVector<T> >& other);
+    void subInPlace(const Ptr< NumericVector<T> >& other);
+    void mulInPlace(const T& coef);
+    void fma(const T& coef, const Ptr< NumericVector<T> >& other);
+    T dot(const Ptr< NumericVector<T> >& other) const;
+    T sum() const;
+    T min() const;
+    T max() const;
 
     static Ptr< NumericVector<T> > parseInt(const string& str);
     
@@ -20,8 +20,12 @@
 // Std
 #include <cstdlib>
 
+// Posix
+#include <sched.h>
+
 // Internal
 #include "InvalidPointerException.h"
+#include "OutOfMemoryException.h"
 #include "MasterMemoryManager.h"
 #include "Logger.h"
 #include "ObjectSerializer.h"
@@ -40,43 +44,74 @@ namespace kfoundation {
    * @param initialCapacity Initial capacity.
    * @param growthRate The capacity will be multiplied by this value every time
    *                   more objects than capacity is needed.
+   * @param maxCapacity The maximum number of objects in the pool, or 0 to
+   *                    only limit it by KF_OBJECT_TABLE_MAX_SIZE. A bounded
+   *                    pool caches fewer records per thread; see
+   *                    ObjectPoolMemoryManager.
+   * @param blockWhenFull If `true`, get() waits for an object to be released
+   *                      when the pool is at maximum capacity. Otherwise, it
+   *                      throws OutOfMemoryException.
    */
   
   template<typename T>
   ObjectPoolMemoryManager<T>::ObjectPoolMemoryManager(const int initialCapacity,
-      const int growthRate)
+      const int growthRate, const int maxCapacity, const bool blockWhenFull)
   {
     pthread_mutexattr_init(&_mutexAttrib);
     pthread_mutexattr_setpshared(&_mutexAttrib, PTHREAD_PROCESS_SHARED);
     pthread_mutex_init(&_mutex, &_mutexAttrib);
-    _size  = initialCapacity;
+    pthread_cond_init(&_released, NULL);
+    pthread_key_create(&_magazineKey,
+        &ObjectPoolMemoryManager<T>::returnMagazine);
+    
+    _maxSize = KF_OBJECT_TABLE_MAX_SIZE;
+    _isBounded = false;
+    _magazineCapacity = MAGAZINE_SIZE;
+    if(maxCapacity > 0 && maxCapacity < _maxSize) {
+      _maxSize = maxCapacity;
+      _isBounded = true;
+      if(_maxSize < _magazineCapacity) {
+        _magazineCapacity = _maxSize;
+      }
+    }
+    
+    _size  = initialCapacity < _maxSize ? initialCapacity : _maxSize;
     _growthRate = growthRate;
+    _blockWhenFull = blockWhenFull;
+    _nInstances = 0;
+    _nWaiting = 0;
     _count = 0;
+    _nStatics = 0;
+    _peakCount = 0;
+    _nGrowths = 0;
     _serialCounter = 0;
-    _next  = 0;
-    _table = new ObjectRecord[_size];
+    _freeHead = makeHead(0, -1);
+    _magazines = NULL;
+    _table.reserve(_size);
     _master = &System::getMasterMemoryManager();
     _id    = _master->registerManager(this);
     _trace = false;
     
-    for(int i = 0; i < _size; i++) {
-      ObjectRecord& record = _table[i];
-      record.retainCount = -1;
-      record.manager = _id;
-      record.index = i;
-      record.serialNumber = -1;
-      record.isStatic = false;
-      record.ptr = new T(_id, i);
-    }
+    initRecords(0, _size);
   }
   
   
   /**
-   * Deconstructor. Deconstructs all objects in the pool internally.
+   * Deconstructor. Deconstructs all objects in the pool internally. The
+   * magazines of all threads are deleted; none of them should use the pool
+   * anymore.
    */
   
   template<typename T>
   ObjectPoolMemoryManager<T>::~ObjectPoolMemoryManager() {
+    pthread_key_delete(_magazineKey);
+    while(_magazines != NULL) {
+      Magazine* m = _magazines;
+      _magazines = m->next;
+      delete m;
+    }
+    
+    pthread_cond_destroy(&_released);
     pthread_mutex_destroy(&_mutex);
     
     Statistics stats = getStats();
@@ -85,52 +120,329 @@ namespace kfoundation {
         << " are static." << EL;
     
     for(int i = 0; i < _size; i++) {
-      ((PoolObject*)_table[i].ptr)->finalize();
-      delete _table[i].ptr;
+      ManagedObject* obj = _table.at(i).ptr;
+      if(obj != NULL) {
+        ((PoolObject*)obj)->finalize();
+        delete obj;
+      }
     }
     _master->unregisterManager(_id);
-    delete[] _table;
+  }
+  
+  
+// --- STATIC METHODS --- //
+  
+  /**
+   * Builds a new head for the free stack pointing to the given index, with a
+   * tag one more than the tag of `oldHead`.
+   */
+  
+  template<typename T>
+  inline kf_int64_t ObjectPoolMemoryManager<T>::makeHead(
+      const kf_int64_t oldHead, const kf_int32_t index)
+  {
+    return (kf_int64_t)(((((unsigned long int)oldHead >> 32) + 1) << 32)
+        | (unsigned int)index);
+  }
+  
+  
+  /**
+   * Returns the index of the top of the free stack, or -1 if it is empty.
+   */
+  
+  template<typename T>
+  inline kf_int32_t ObjectPoolMemoryManager<T>::headIndex(const kf_int64_t head)
+  {
+    return (kf_int32_t)(unsigned int)head;
+  }
+  
+  
+  /**
+   * Acquires the spin lock of the given magazine. It is held by the owner
+   * thread while using the magazine, and by reclaimMagazines().
+   */
+  
+  template<typename T>
+  inline void ObjectPoolMemoryManager<T>::lockMagazine(Magazine* m) {
+    while(__sync_lock_test_and_set(&m->isLocked, 1)) {
+      sched_yield();
+    }
+  }
+  
+  
+  /**
+   * Releases the spin lock of the given magazine.
+   */
+  
+  template<typename T>
+  inline void ObjectPoolMemoryManager<T>::unlockMagazine(Magazine* m) {
+    __sync_lock_release(&m->isLocked);
+  }
+  
+  
+  /**
+   * Called by pthread when a thread holding a magazine ends.
+   */
+  
+  template<typename T>
+  void ObjectPoolMemoryManager<T>::returnMagazine(void* arg) {
+    Magazine* m = (Magazine*)arg;
+    m->pool->removeMagazine(m);
+    delete m;
   }
   
   
 // --- METHODS --- //
   
+  /**
+   * Initializes records `begin` to `end - 1`, and pushes them to the free
+   * stack. Their objects are constructed later by get().
+   */
+  
+  template<typename T>
+  void ObjectPoolMemoryManager<T>::initRecords(const int begin, const int end)
+  {
+    for(int i = begin; i < end; i++) {
+      ObjectRecord& record = _table.at(i);
+      ObjectRecordInfo& info = _table.infoAt(i);
+      record.retainCount = -1;
+      record.ptr = NULL;
+      info.manager = _id;
+      info.index = i;
+      info.nextFree = i + 1;
+      info.isStatic = false;
+    }
+    
+    if(end > begin) {
+      pushFree(begin, end - 1);
+    }
+  }
+  
+  
+  /**
+   * Pushes a chain of unused records, linked from `first` to `last` through
+   * ObjectRecordInfo::nextFree, to the free stack.
+   */
+  
+  template<typename T>
+  void ObjectPoolMemoryManager<T>::pushFree(const kf_int32_t first,
+      const kf_int32_t last)
+  {
+    ObjectRecordInfo& lastInfo = _table.infoAt(last);
+    while(true) {
+      kf_int64_t head = _freeHead;
+      lastInfo.nextFree = headIndex(head);
+      if(__sync_bool_compare_and_swap(&_freeHead, head, makeHead(head, first)))
+      {
+        break;
+      }
+    }
+  }
+  
+  
+  /**
+   * Pops an unused record from the free stack.
+   *
+   * @return The index of the record, or -1 if the stack is empty.
+   */
+  
+  template<typename T>
+  kf_int32_t ObjectPoolMemoryManager<T>::popFree() {
+    while(true) {
+      kf_int64_t head = _freeHead;
+      kf_int32_t index = headIndex(head);
+      if(index == -1) {
+        return -1;
+      }
+      
+      // The record may be taken by another thread after head is read, in
+      // which case nextFree is garbage. The tag makes the swap fail then.
+      kf_int32_t next = *(volatile kf_int32_t*)&_table.infoAt(index).nextFree;
+      if(__sync_bool_compare_and_swap(&_freeHead, head, makeHead(head, next)))
+      {
+        return index;
+      }
+    }
+  }
+  
+  
+  /**
+   * Grows the pool until an unused record can be popped from the free stack.
+   * If the pool is at maximum capacity, the magazines of all threads are
+   * reclaimed first, and if still no record is unused, waits for one to be
+   * released when `blockWhenFull` is set, or throws otherwise.
+   */
+  
+  template<typename T>
+  kf_int32_t ObjectPoolMemoryManager<T>::growAndPop() {
+    pthread_mutex_lock(&_mutex);
+    
+    kf_int32_t index = popFree();
+    while(index == -1) {
+      if(_size == _maxSize) {
+        // _nWaiting is raised before reclaiming. A release() that puts its
+        // record in a magazine after that sees it raised, and spills the
+        // magazine and signals under the mutex, which is only unlocked by
+        // waiting. So no release can be missed.
+        __sync_fetch_and_add(&_nWaiting, 1);
+        reclaimMagazines();
+        if(headIndex(_freeHead) == -1 && _blockWhenFull) {
+          pthread_cond_wait(&_released, &_mutex);
+        }
+        __sync_fetch_and_sub(&_nWaiting, 1);
+        
+        index = popFree();
+        if(index != -1 || _blockWhenFull) {
+          continue;
+        }
+      }
+      
+      try {
+        grow();
+      } catch(KFException& e) {
+        pthread_mutex_unlock(&_mutex);
+        throw;
+      }
+      index = popFree();
+    }
+    
+    pthread_mutex_unlock(&_mutex);
+    return index;
+  }
+  
+  
+  /**
+   * Returns the magazine of the calling thread, creating it if necessary.
+   */
+  
+  template<typename T>
+  typename ObjectPoolMemoryManager<T>::Magazine*
+  ObjectPoolMemoryManager<T>::getMagazine() {
+    Magazine* m = (Magazine*)pthread_getspecific(_magazineKey);
+    if(m == NULL) {
+      m = new Magazine();
+      m->pool = this;
+      m->prev = NULL;
+      m->isLocked = 0;
+      m->size = 0;
+      pthread_setspecific(_magazineKey, m);
+      
+      pthread_mutex_lock(&_mutex);
+      m->next = _magazines;
+      if(_magazines != NULL) {
+        _magazines->prev = m;
+      }
+      _magazines = m;
+      pthread_mutex_unlock(&_mutex);
+    }
+    return m;
+  }
+  
+  
+  /**
+   * Unlinks the given magazine from the list of magazines, and moves its
+   * records to the free stack.
+   */
+  
+  template<typename T>
+  void ObjectPoolMemoryManager<T>::removeMagazine(Magazine* m) {
+    pthread_mutex_lock(&_mutex);
+    
+    if(m->prev == NULL) {
+      _magazines = m->next;
+    } else {
+      m->prev->next = m->next;
+    }
+    if(m->next != NULL) {
+      m->next->prev = m->prev;
+    }
+    
+    lockMagazine(m);
+    spill(m, 0);
+    unlockMagazine(m);
+    
+    pthread_mutex_unlock(&_mutex);
+  }
+  
+  
+  /**
+   * Moves the records in the given magazine, except for the first `keep`
+   * ones, to the free stack. Should be called while holding the lock of the
+   * magazine.
+   */
+  
+  template<typename T>
+  void ObjectPoolMemoryManager<T>::spill(Magazine* m, const kf_int32_t keep) {
+    if(m->size <= keep) {
+      return;
+    }
+    
+    for(kf_int32_t i = keep; i < m->size - 1; i++) {
+      _table.infoAt(m->indexes[i]).nextFree = m->indexes[i + 1];
+    }
+    pushFree(m->indexes[keep], m->indexes[m->size - 1]);
+    m->size = keep;
+  }
+  
+  
+  /**
+   * Moves the records in the magazines of all threads to the free stack.
+   * Should be called while holding the mutex.
+   */
+  
+  template<typename T>
+  void ObjectPoolMemoryManager<T>::reclaimMagazines() {
+    for(Magazine* m = _magazines; m != NULL; m = m->next) {
+      lockMagazine(m);
+      spill(m, 0);
+      unlockMagazine(m);
+    }
+  }
+  
+  
+  /**
+   * Extends the pool. Existing records stay in place; new pages are appended
+   * to the table and filled with new objects. Should be called while holding
+   * the mutex.
+   */
+  
   template<typename T>
   void ObjectPoolMemoryManager<T>::grow() {
     int newSize = _size * _growthRate;
-    ObjectRecord* newTable = new ObjectRecord[newSize];
-    memcpy((void*)newTable, (void*)_table, sizeof(ObjectRecord) * _size);
+    if(newSize > _maxSize) {
+      newSize = _maxSize;
+    }
+    
+    if(newSize == _size) {
+      // Int::toString() is used since constructing an Int would register a
+      // new object while the mutex is held.
+      throw OutOfMemoryException("ObjectPool "
+          + Int::toString(_id) + " cannot hold more than "
+          + Int::toString(_size) + " objects.");
+    }
     
-    delete[] _table;
-    _table = newTable;
+    _table.reserve(newSize);
     
     LOG << "ObjectPool " << _id << " resized from " << _size
         << " to " << newSize << EL;
     
-    for(int i = _size; i < newSize; i++) {
-      ObjectRecord& record = newTable[i];
-      record.retainCount = -1;
-      record.manager = _id;
-      record.index = i;
-      record.serialNumber = -1;
-      record.isStatic = false;
-      record.ptr = new T(_id, i);
-    }
-    
+    int oldSize = _size;
     _size = newSize;
-    _master->updataTable(_id);
+    _nGrowths++;
+    initRecords(oldSize, newSize);
   }
   
   
   template<typename T>
   string ObjectPoolMemoryManager<T>::toString(int index) {
-    const ObjectRecord& rec = _table[index];
+    const ObjectRecord& rec = _table.at(index);
+    const ObjectRecordInfo& info = _table.infoAt(index);
     char buffer[400];
     sprintf(buffer, "[serial: %d, index: %d, type: %s, retainCount: %d, "
             "isStatic: %d, key: %d]",
-            rec.serialNumber, rec.index,
+            info.serialNumber, info.index,
             System::demangle(typeid(T).name()).c_str(),
-            rec.retainCount, rec.isStatic, rec.key);
+            rec.retainCount, info.isStatic, rec.key);
     return string(buffer);
   }
   
@@ -141,32 +453,70 @@ namespace kfoundation {
   
   template<typename T>
   Ptr<T> ObjectPoolMemoryManager<T>::get() {
-    pthread_mutex_lock(&_mutex);
-    int index = _next;
-    ObjectRecord& rec = _table[index];
-    rec.retainCount = 1;
-    rec.serialNumber = _serialCounter++;
-    rec.key = rand() % 65530 - 32760;
-    rec.manager = _id;
-    rec.isStatic = false;
+    Magazine* m = getMagazine();
+    kf_int32_t index = -1;
     
-    _count++;
+    lockMagazine(m);
+    if(m->size > 0) {
+      index = m->indexes[--m->size];
+    }
+    unlockMagazine(m);
     
-    if(_count == _size) {
-      grow();
+    if(index == -1) {
+      index = popFree();
+      if(index == -1) {
+        index = growAndPop();
+      }
+      
+      // Records cached by a bounded pool are not available to other threads
+      // without reclaiming, so the magazine is only filled by release().
+      if(!_isBounded) {
+        lockMagazine(m);
+        while(m->size < MAGAZINE_SIZE / 2) {
+          kf_int32_t i = popFree();
+          if(i == -1) {
+            break;
+          }
+          m->indexes[m->size++] = i;
+        }
+        unlockMagazine(m);
+      }
     }
     
-    while(_table[_next].retainCount != -1) {
-      _next++;
-      if(_next == _size) {
-        _next = 0;
+    ObjectRecord& rec = _table.at(index);
+    ObjectRecordInfo& info = _table.infoAt(index);
+    info.serialNumber = (kf_int32_t)__sync_fetch_and_add(&_serialCounter, 1);
+    info.isStatic = false;
+    
+    if(rec.ptr == NULL) {
+      try {
+        rec.ptr = new T(_id, index);
+      } catch(...) {
+        info.nextFree = -1;
+        pushFree(index, index);
+        throw;
       }
+      __sync_fetch_and_add(&_nInstances, 1);
     }
-    pthread_mutex_unlock(&_mutex);
     
+    __k_RecordState state;
+    __k_RecordState newState;
+    do {
+      state = __k_loadState(rec);
+      newState = state;
+      newState.fields.retainCount = 1;
+    } while(!__k_swapState(rec, state, newState));
+    
+    int count = __sync_add_and_fetch(&_count, 1);
+    int peak = _peakCount;
+    while(count > peak
+        && !__sync_bool_compare_and_swap(&_peakCount, peak, count))
+    {
+      peak = _peakCount;
+    }
     
     if(_trace) {
-      LOG << "Get: (" << index << ") "<< toString(index) << " Next: " << _next << EL;
+      LOG << "Get: (" << index << ") "<< toString(index) << EL;
     }
     
     Ptr<T> ptr(_id, index);
@@ -176,37 +526,84 @@ namespace kfoundation {
   
   
   template<typename T>
-  const ObjectRecord&
+  const ObjectRecordInfo&
   ObjectPoolMemoryManager<T>::registerObject(ManagedObject* obj) {
     throw KFException("Operation not supported");
   }
   
   
   template<typename T>
-  void ObjectPoolMemoryManager<T>::retain(kf_int32_t index, kf_int16_t key) {
-    pthread_mutex_lock(&_mutex);
+  void ObjectPoolMemoryManager<T>::retain(kf_int32_t index, kf_objectkey_t key) {
+    ObjectRecord& record = _table.at(index);
     
-    ObjectRecord& record = _table[index];
-    if(record.key != key) {
-      pthread_mutex_unlock(&_mutex);
-      throw InvalidPointerException("The pointer being retained is invalid: "
-                                    + Int(_id) + ":" + Int(index));
+    while(true) {
+      __k_RecordState state = __k_loadState(record);
+      
+      if(state.fields.key != key) {
+        throw InvalidPointerException("The pointer being retained is invalid: "
+                                      + Int(_id) + ":" + Int(index));
+      }
+      
+      if(_table.isStatic(index)) {
+        break;
+      }
+      
+      if(state.fields.retainCount <= 0) {
+        throw InvalidPointerException("The pointer being retained is being "
+            "finalized: " + Int(_id) + ":" + Int(index));
+      }
+      
+      __k_RecordState newState = state;
+      newState.fields.retainCount++;
+      if(__k_swapState(record, state, newState)) {
+        break;
+      }
     }
     
-    if(!record.isStatic) {
-      record.retainCount++;
+    if(_trace) {
+      LOG << "Retained: " << toString(index) << EL;
     }
+  }
+  
+  
+  template<typename T>
+  bool ObjectPoolMemoryManager<T>::tryRetain(kf_int32_t index,
+      kf_objectkey_t key)
+  {
+    ObjectRecord& record = _table.at(index);
     
-    pthread_mutex_unlock(&_mutex);
+    while(true) {
+      __k_RecordState state = __k_loadState(record);
+      
+      if(state.fields.key != key) {
+        return false;
+      }
+      
+      if(_table.isStatic(index)) {
+        break;
+      }
+      
+      if(state.fields.retainCount <= 0) {
+        return false;
+      }
+      
+      __k_RecordState newState = state;
+      newState.fields.retainCount++;
+      if(__k_swapState(record, state, newState)) {
+        break;
+      }
+    }
     
     if(_trace) {
-      LOG << "Retained: " << toString(record.index) << EL;
+      LOG << "Retained: " << toString(index) << EL;
     }
+    
+    return true;
   }
   
   
   template<typename T>
-  void ObjectPoolMemoryManager<T>::release(kf_int32_t index, kf_int16_t key) {    
+  void ObjectPoolMemoryManager<T>::release(kf_int32_t index, kf_objectkey_t key) {    
 #ifdef DEBUG
     string recStr;
     if(_trace) {
@@ -214,60 +611,208 @@ namespace kfoundation {
     }
 #endif
     
-    // synchronized {
-    pthread_mutex_lock(&_mutex);
-    ObjectRecord& record = _table[index];
-    if(record.key != key) {
-      pthread_mutex_unlock(&_mutex);
-      throw InvalidPointerException("The pointer being released is invalid: "
-                                    + Int(_id) + ":" + Int(index));
-    }
-    if(!record.isStatic) {
-      record.retainCount--;
-      if(record.retainCount == 0) {
-        record.retainCount = -1;
-        record.key = rand() % 65530 - 32760;
-        _count--;
-      } else if(record.retainCount < 0) {
-        pthread_mutex_unlock(&_mutex);
+    ObjectRecord& record = _table.at(index);
+    bool isFreed = false;
+    
+    while(true) {
+      __k_RecordState state = __k_loadState(record);
+      
+      if(state.fields.key != key) {
+        throw InvalidPointerException("The pointer being released is invalid: "
+                                      + Int(_id) + ":" + Int(index));
+      }
+      
+      if(_table.isStatic(index)) {
+        break;
+      }
+      
+      if(state.fields.retainCount <= 0) {
         throw InvalidPointerException("Object is released too many times: "
                                       + Int(_id) + ":" + Int(index));
       }
-    }
-    pthread_mutex_unlock(&_mutex);
-    // } synchronized
-    
-    if(record.retainCount == -1) {
-      dynamic_cast<PoolObject*>(record.ptr)->finalize();
+      
+      __k_RecordState newState = state;
+      newState.fields.retainCount--;
+      if(newState.fields.retainCount == 0) {
+        newState.fields.retainCount = -1;
+        newState.fields.key = nextKey(state.fields.key);
+      }
+      
+      if(__k_swapState(record, state, newState)) {
+        isFreed = newState.fields.retainCount == -1;
+        break;
+      }
     }
     
 #ifdef DEBUG
     if(_trace) {
       string x;
-      if(record.retainCount == -1) {
+      if(isFreed) {
         x = " X ";
       }
       LOG << "Released: " << recStr << " --> " << record.retainCount << x << EL;
     }
 #endif
+    
+    if(!isFreed) {
+      return;
+    }
+    
+    // The record is put back for reuse only after it is finalized.
+    dynamic_cast<PoolObject*>(record.ptr)->finalize();
+    __sync_fetch_and_sub(&_count, 1);
+    
+    // At maximum capacity, the record is made available to all threads.
+    Magazine* m = NULL;
+    if(_size == _maxSize) {
+      _table.infoAt(index).nextFree = -1;
+      pushFree(index, index);
+    } else {
+      m = getMagazine();
+      lockMagazine(m);
+      if(m->size == _magazineCapacity) {
+        spill(m, _magazineCapacity / 2);
+      }
+      m->indexes[m->size++] = index;
+      unlockMagazine(m);
+    }
+    
+    // Both the push and the magazine lock are full barriers, so either this
+    // sees _nWaiting raised, or growAndPop() sees the record.
+    if(_nWaiting > 0) {
+      if(m != NULL) {
+        lockMagazine(m);
+        spill(m, 0);
+        unlockMagazine(m);
+      }
+      pthread_mutex_lock(&_mutex);
+      pthread_cond_broadcast(&_released);
+      pthread_mutex_unlock(&_mutex);
+    }
   }
   
   
+  /**
+   * Deletes idle objects until at most `lowWatermark` objects are left in
+   * the pool. The magazines of all threads are reclaimed first, so all idle
+   * objects are considered. The slots of deleted objects remain in the pool,
+   * and get() constructs new objects for them when needed.
+   *
+   * @param lowWatermark The number of objects to keep.
+   * @return The number of objects deleted.
+   */
+  
   template<typename T>
-  void ObjectPoolMemoryManager<T>::remove(kf_int32_t index, kf_int16_t key) {
-    ObjectRecord& record = _table[index];
-    if(key == record.key) {
-      record.retainCount = -1;
-      record.key = rand() % 65530 - 32760;
+  kf_int32_t ObjectPoolMemoryManager<T>::trim(const int lowWatermark) {
+    pthread_mutex_lock(&_mutex);
+    reclaimMagazines();
+    
+    kf_int32_t first = -1;
+    kf_int32_t last = -1;
+    kf_int32_t nDeleted = 0;
+    
+    while(_nInstances > lowWatermark) {
+      kf_int32_t index = popFree();
+      if(index == -1) {
+        break;
+      }
+      
+      ObjectRecord& rec = _table.at(index);
+      ManagedObject* obj = rec.ptr;
+      if(obj != NULL) {
+        rec.ptr = NULL;
+        delete obj;
+        __sync_fetch_and_sub(&_nInstances, 1);
+        nDeleted++;
+      }
+      
+      _table.infoAt(index).nextFree = first;
+      first = index;
+      if(last == -1) {
+        last = index;
+      }
+    }
+    
+    if(first != -1) {
+      pushFree(first, last);
     }
+    
+    pthread_mutex_unlock(&_mutex);
+    
+    if(_trace) {
+      LOG << "ObjectPool " << _id << " trimmed " << nDeleted << " objects"
+          << EL;
+    }
+    
+    return nDeleted;
+  }
+  
+  
+  /**
+   * Returns the number of objects currently constructed in the pool, whether
+   * in use or idle.
+   */
+  
+  template<typename T>
+  kf_int32_t ObjectPoolMemoryManager<T>::getNumberOfInstances() const {
+    return _nInstances;
+  }
+  
+  
+  template<typename T>
+  void ObjectPoolMemoryManager<T>::remove(kf_int32_t index, kf_objectkey_t key) {
+    ObjectRecord& record = _table.at(index);
+    
+    __k_RecordState state;
+    __k_RecordState newState;
+    do {
+      state = __k_loadState(record);
+      if(state.fields.key != key) {
+        break;
+      }
+      newState.fields.retainCount = -1;
+      newState.fields.key = nextKey(state.fields.key);
+    } while(!__k_swapState(record, state, newState));
+    
     if(_trace) {
-      LOG << "Removed: " << toString(record.index) << EL;
+      LOG << "Removed: " << toString(index) << EL;
     }
   }
 
   template<typename T>
-  ObjectRecord* ObjectPoolMemoryManager<T>::getTable() {
-    return _table;
+  void ObjectPoolMemoryManager<T>::setStatic(kf_int32_t index,
+      kf_objectkey_t key)
+  {
+    ObjectRecord& record = _table.at(index);
+    ObjectRecordInfo& info = _table.infoAt(index);
+    
+    pthread_mutex_lock(&_mutex);
+    
+    __k_RecordState state;
+    __k_RecordState newState;
+    do {
+      state = __k_loadState(record);
+      if(state.fields.key != key) {
+        pthread_mutex_unlock(&_mutex);
+        throw InvalidPointerException("The pointer being made static is "
+            "invalid: " + Int(_id) + ":" + Int(index));
+      }
+      newState = state;
+      newState.fields.retainCount = -10;
+    } while(!__k_swapState(record, state, newState));
+    
+    if(!info.isStatic) {
+      info.isStatic = true;
+      __sync_fetch_and_add(&_nStatics, 1);
+    }
+    
+    pthread_mutex_unlock(&_mutex);
+  }
+  
+  
+  template<typename T>
+  ObjectRecord** ObjectPoolMemoryManager<T>::getTable() {
+    return _table.getPages();
   }
   
   
@@ -280,17 +825,13 @@ namespace kfoundation {
   template<typename T>
   Statistics ObjectPoolMemoryManager<T>::getStats() const {
     Statistics stats;
-    stats.nObjects = 0;
-    stats.nStaticObjects = 0;
-    for(int i = 0; i < _size; i++) {
-      if(_table[i].retainCount != -1) {
-        if(_table[i].isStatic) {
-          stats.nStaticObjects++;
-        } else {
-          stats.nObjects++;
-        }
-      }
-    }
+    stats.nObjects = _count;
+    stats.nStaticObjects = _nStatics;
+    stats.peakObjects = _peakCount;
+    stats.tableSize = _size;
+    stats.nGrowths = _nGrowths;
+    stats.nAllocations = _serialCounter;
+    stats.nReleases = stats.nAllocations - stats.nObjects;
     return stats;
   }
   
@@ -322,15 +863,16 @@ namespace kfoundation {
     int c = _size;
     
     for(int i = 0; i < c; i++) {
-      const ObjectRecord& rec = _table[i];
+      const ObjectRecord& rec = _table.at(i);
+      const ObjectRecordInfo& info = _table.infoAt(i);
       if(rec.retainCount != -1) {
         seralizer->member("[" + Int(i) + "]")->object("ObjectRecord")
           ->attribute("type", System::demangle(typeid(*rec.ptr).name()))
           ->attribute("retainCount", rec.retainCount)
-          ->attribute("isStatic", rec.isStatic)
-          ->attribute("index", rec.index)
+          ->attribute("isStatic", info.isStatic)
+          ->attribute("index", info.index)
           ->attribute("key", rec.key)
-          ->attribute("serialNumber", rec.serialNumber)
+          ->attribute("serialNumber", info.serialNumber)
           ->endObject();
       }
     }
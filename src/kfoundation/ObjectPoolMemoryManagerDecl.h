@@ -23,6 +23,7 @@
 // Internal
 #include "SerializingStreamer.h"
 #include "ManagedObject.h"
+#include "ObjectTable.h"
 
 // Super
 #include "MemoryManager.h"
@@ -33,14 +34,40 @@ namespace kfoundation {
   class PPtr;
   
   /**
-   * Reuses the objects in a preallocated pool whenever a new instance is
-   * needed. When an object is no longer needed, it will not be deleted, 
-   * instead, it's PoolObject::finalize() method will be called to clean it
-   * up for next use. When pool is full and a new instance is needed, 
-   * the pool size will be automatically increased.
+   * Reuses the objects in a pool whenever a new instance is needed. When an
+   * object is no longer needed, it will not be deleted, instead, it's
+   * PoolObject::finalize() method will be called to clean it up for next use.
+   * When pool is full and a new instance is needed, the pool size will be
+   * automatically increased, up to the maximum capacity given to the
+   * constructor. Beyond that, get() either blocks until an object is
+   * released, or throws OutOfMemoryException.
+   *
+   * Objects are constructed lazily, the first time their slot is handed out
+   * by get(). Call trim() to delete idle objects, for example after a peak
+   * in load; their slots are kept, and new objects are constructed for them
+   * when needed again.
    *
    * Call get() method to obtain a clean instance to use.
    *
+   * get(), retain() and release() take no lock. Unused records are chained
+   * through ObjectRecordInfo::nextFree into a lock-free stack, whose head is
+   * tagged with a counter that changes on every update to avoid the ABA
+   * problem. On top of that, each thread keeps a magazine of up to
+   * MAGAZINE_SIZE unused records for each pool. get() takes a record from the
+   * magazine of the calling thread, refilling it from the shared stack when
+   * empty, and release() puts the record back in the magazine, moving half
+   * of it to the shared stack when full. Each magazine has a spin lock, which
+   * is only contended when another thread reclaims its records. The pool
+   * mutex is only held while the pool grows, or while it waits at maximum
+   * capacity. Magazines are returned to the shared stack when their threads
+   * end.
+   *
+   * A pool given a maximum capacity does not refill magazines, and holds at
+   * most that many records in each. Once it reaches its maximum capacity,
+   * release() puts records directly in the shared stack, and before get()
+   * blocks or throws, the records cached in the magazines of all threads are
+   * reclaimed. Thus, get() only fails when all objects are in use.
+   *
    * @ingroup memory
    * @headerfile ObjectPoolMemoryManager.h <kfoundation/ObjectPoolMemoryManager.h>
    */
@@ -49,17 +76,46 @@ namespace kfoundation {
   class ObjectPoolMemoryManager
   : public MemoryManager, public SerializingStreamer {
     
+  // --- STATIC FIELDS --- //
+    
+    public: static const kf_int32_t MAGAZINE_SIZE = 32;
+    
+    
+  // --- NESTED TYPES --- //
+    
+    private: struct Magazine {
+      ObjectPoolMemoryManager<T>* pool;
+      Magazine* next;
+      Magazine* prev;
+      volatile int isLocked;
+      kf_int32_t size;
+      kf_int32_t indexes[MAGAZINE_SIZE];
+    };
+    
+    
   // --- FIELDS --- //
     
-    private: int _size;
+    private: volatile int _size;
+    private: int _maxSize;
+    private: bool _isBounded;
+    private: kf_int32_t _magazineCapacity;
     private: int _growthRate;
-    private: int _count;
-    private: int _serialCounter;
+    private: bool _blockWhenFull;
+    private: volatile int _nInstances;
+    private: volatile int _nWaiting;
+    private: volatile int _count;
+    private: volatile int _nStatics;
+    private: volatile int _peakCount;
+    private: int _nGrowths;
+    private: volatile kf_int64_t _serialCounter;
     private: int _id;
-    private: int _next;
+    private: volatile kf_int64_t _freeHead;
+    private: pthread_key_t _magazineKey;
+    private: Magazine* _magazines;
     private: pthread_mutexattr_t _mutexAttrib;
     private: pthread_mutex_t _mutex;
-    private: ObjectRecord* _table;
+    private: pthread_cond_t _released;
+    private: ObjectTable _table;
     private: MasterMemoryManager* _master;
     private: bool _trace;
     
@@ -67,23 +123,47 @@ namespace kfoundation {
   // --- (DE)CONSTRUCTORS --- //
     
     public: ObjectPoolMemoryManager(const int initialCapacity,
-        const int growthRate);
+        const int growthRate, const int maxCapacity = 0,
+        const bool blockWhenFull = false);
     
     public: ~ObjectPoolMemoryManager();
     
     
+  // --- STATIC METHODS --- //
+    
+    private: static inline kf_int64_t makeHead(const kf_int64_t oldHead,
+        const kf_int32_t index);
+    
+    private: static inline kf_int32_t headIndex(const kf_int64_t head);
+    private: static inline void lockMagazine(Magazine* m);
+    private: static inline void unlockMagazine(Magazine* m);
+    private: static void returnMagazine(void* arg);
+    
+    
   // --- METHODS --- //
     
+    private: void initRecords(const int begin, const int end);
+    private: void pushFree(const kf_int32_t first, const kf_int32_t last);
+    private: kf_int32_t popFree();
+    private: kf_int32_t growAndPop();
+    private: Magazine* getMagazine();
+    private: void removeMagazine(Magazine* m);
+    private: void spill(Magazine* m, const kf_int32_t keep);
+    private: void reclaimMagazines();
     private: void grow();
     private: string toString(int index);
     public: Ptr<T> get();
+    public: kf_int32_t trim(const int lowWatermark);
+    public: kf_int32_t getNumberOfInstances() const;
     
     // Inherited from MemoryManager
-    public: const ObjectRecord& registerObject(ManagedObject* obj);
-    public: void retain(kf_int32_t index, kf_int16_t key);
-    public: void release(kf_int32_t index, kf_int16_t key);
-    public: void remove(kf_int32_t index, kf_int16_t key);
-    public: ObjectRecord* getTable();
+    public: const ObjectRecordInfo& registerObject(ManagedObject* obj);
+    public: void retain(kf_int32_t index, kf_objectkey_t key);
+    public: bool tryRetain(kf_int32_t index, kf_objectkey_t key);
+    public: void release(kf_int32_t index, kf_objectkey_t key);
+    public: void remove(kf_int32_t index, kf_objectkey_t key);
+    public: void setStatic(kf_int32_t index, kf_objectkey_t key);
+    public: ObjectRecord** getTable();
     public: kf_int32_t getTableSize() const;
     public: Statistics getStats() const;
     public: void trace(const pthread_t threadId);
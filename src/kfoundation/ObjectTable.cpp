@@ -0,0 +1,107 @@
+/*---[ObjectTable.cpp]-----------------------------------------m(._.)m--------*\
+ |
+ |  Project   : KFoundation
+ |  Declares  : -
+ |  Implements: kfoundation::ObjectTable::*
+ |
+ |  Copyright (c) 2013, 2014, 2015, RIKEN (The Institute of Physical and
+ |  Chemial Research) All rights reserved.
+ |
+ |  Author: Hamed KHANDAN (hamed.khandan@port.kobe-u.ac.jp)
+ |
+ |  This file is distributed under the KnoRBA Free Public License. See
+ |  LICENSE.TXT for details.
+ |
+ *//////////////////////////////////////////////////////////////////////////////
+
+// Std
+#include <cstring>
+
+// Internal
+#include "Int.h"
+#include "OutOfMemoryException.h"
+
+// Self
+#include "ObjectTable.h"
+
+namespace kfoundation {
+
+// --- (DE)CONSTRUCTORS --- //
+
+  /**
+   * Constructor, creates an empty table.
+   */
+
+  ObjectTable::ObjectTable() {
+    _pages = new ObjectRecord*[KF_OBJECT_TABLE_MAX_PAGES];
+    memset(_pages, 0, sizeof(ObjectRecord*) * KF_OBJECT_TABLE_MAX_PAGES);
+    _nPages = 0;
+  }
+
+
+  /**
+   * Deconstructor.
+   */
+
+  ObjectTable::~ObjectTable() {
+    for(int i = 0; i < _nPages; i++) {
+      delete (__k_ObjectTablePage*)_pages[i];
+    }
+    delete[] _pages;
+  }
+
+
+// --- METHODS --- //
+
+  /**
+   * Appends as many pages as needed to hold at least the given number of
+   * records. Existing records are not moved. New records are zero-filled.
+   * Concurrent calls should be synchronized by the caller.
+   *
+   * @param capacity The desired number of records.
+   * @throw OutOfMemoryException if the capacity exceeds the maximum number of
+   *        pages.
+   */
+
+  void ObjectTable::reserve(kf_int32_t capacity) {
+    kf_int32_t nPages = (capacity + KF_OBJECT_TABLE_PAGE_SIZE - 1)
+        >> KF_OBJECT_TABLE_PAGE_BITS;
+
+    if(nPages > KF_OBJECT_TABLE_MAX_PAGES) {
+      throw OutOfMemoryException("Object table cannot hold "
+          + Int::toString(capacity) + " records.");
+    }
+
+    while(_nPages < nPages) {
+      __k_ObjectTablePage* page = new __k_ObjectTablePage;
+      memset(page, 0, sizeof(__k_ObjectTablePage));
+
+      // The page should be fully initialized before it can be seen by readers.
+      __sync_synchronize();
+
+      _pages[_nPages] = page->records;
+      _nPages++;
+    }
+  }
+
+
+  /**
+   * Returns the number of records that can be accessed without reserving more
+   * pages.
+   */
+
+  kf_int32_t ObjectTable::getCapacity() const {
+    return _nPages * KF_OBJECT_TABLE_PAGE_SIZE;
+  }
+
+
+  /**
+   * Returns the page directory. Its address never changes during the lifetime
+   * of the table.
+   */
+
+  ObjectRecord** ObjectTable::getPages() {
+    return _pages;
+  }
+
+} // namespace kfoundation
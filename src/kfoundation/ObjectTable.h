@@ -0,0 +1,210 @@
+/*---[ObjectTable.h]-------------------------------------------m(._.)m--------*\
+ |
+ |  Project   : KFoundation
+ |  Declares  : struct kfoundation::__k_ObjectTablePage
+ |              kfoundation::ObjectTable::*
+ |  Implements: kfoundation::ObjectTable::at()
+ |              kfoundation::ObjectTable::infoAt()
+ |              kfoundation::ObjectTable::infoOf()
+ |              kfoundation::ObjectTable::isStatic()
+ |
+ |  Copyright (c) 2013, 2014, 2015, RIKEN (The Institute of Physical and
+ |  Chemial Research) All rights reserved.
+ |
+ |  Author: Hamed KHANDAN (hamed.khandan@port.kobe-u.ac.jp)
+ |
+ |  This file is distributed under the KnoRBA Free Public License. See
+ |  LICENSE.TXT for details.
+ |
+ *//////////////////////////////////////////////////////////////////////////////
+
+#ifndef KFOUNDATION_OBJECTTABLE
+#define KFOUNDATION_OBJECTTABLE
+
+#include "definitions.h"
+#include "MemoryManager.h"
+
+/**
+ * @def KF_OBJECT_TABLE_PAGE_BITS
+ * Number of low bits of an object index that select a record within a page
+ * of an ObjectTable. The remaining high bits select the page.
+ * @ingroup memory
+ */
+
+#define KF_OBJECT_TABLE_PAGE_BITS 10
+
+/**
+ * @def KF_OBJECT_TABLE_PAGE_SIZE
+ * Number of records in each page of an ObjectTable.
+ * @ingroup memory
+ */
+
+#define KF_OBJECT_TABLE_PAGE_SIZE (1 << KF_OBJECT_TABLE_PAGE_BITS)
+
+/**
+ * @def KF_OBJECT_TABLE_PAGE_MASK
+ * Mask applied to an object index to get its offset within its page.
+ * @ingroup memory
+ */
+
+#define KF_OBJECT_TABLE_PAGE_MASK (KF_OBJECT_TABLE_PAGE_SIZE - 1)
+
+/**
+ * @def KF_OBJECT_TABLE_MAX_PAGES
+ * Maximum number of pages in an ObjectTable. The page directory is allocated
+ * with this size upfront. Unless KF_WIDE_OBJECT_RECORD is defined, the table
+ * is limited to the range of a 16-bit record index.
+ * @ingroup memory
+ */
+
+#ifdef KF_WIDE_OBJECT_RECORD
+#  define KF_OBJECT_TABLE_MAX_PAGES (1 << 14)
+#else
+#  define KF_OBJECT_TABLE_MAX_PAGES (32768 >> KF_OBJECT_TABLE_PAGE_BITS)
+#endif
+
+/**
+ * @def KF_OBJECT_TABLE_MAX_SIZE
+ * Maximum number of records in an ObjectTable.
+ * @ingroup memory
+ */
+
+#define KF_OBJECT_TABLE_MAX_SIZE \
+    (KF_OBJECT_TABLE_MAX_PAGES * KF_OBJECT_TABLE_PAGE_SIZE)
+
+namespace kfoundation {
+
+  /**
+   * A page of an ObjectTable. The records come first, so the address of a
+   * page is also the address of its first ObjectRecord.
+   */
+
+  struct __k_ObjectTablePage {
+    ObjectRecord records[KF_OBJECT_TABLE_PAGE_SIZE];
+    ObjectRecordInfo infos[KF_OBJECT_TABLE_PAGE_SIZE];
+  };
+
+
+  /**
+   * Record table used by memory managers. Records are stored in fixed-size
+   * pages, and the page holding each record is found by the high bits of its
+   * index. The directory of pages is allocated once, and the table grows by
+   * appending new pages to it. Thus, records never move once created, and
+   * readers can safely access the table while it is growing.
+   *
+   * Each page is laid out as a structure of arrays. The ObjectRecords, which
+   * are all that is needed to dereference, retain and release a pointer, are
+   * packed in one array, and the ObjectRecordInfos in another. This way, the
+   * cache lines touched by pointer validation are not shared with fields that
+   * are rarely read.
+   *
+   * The page directory is what managers return by MemoryManager::getTable().
+   *
+   * @ingroup memory
+   * @headerfile ObjectTable.h <kfoundation/ObjectTable.h>
+   */
+
+  class ObjectTable {
+
+  // --- FIELDS --- //
+
+    private: ObjectRecord** _pages;
+    private: kf_int32_t _nPages;
+
+
+  // --- (DE)CONSTRUCTORS --- //
+
+    public: ObjectTable();
+    public: ~ObjectTable();
+
+
+  // --- METHODS --- //
+
+    public: void reserve(kf_int32_t capacity);
+    public: kf_int32_t getCapacity() const;
+    public: ObjectRecord** getPages();
+    public: static inline ObjectRecordInfo& infoOf(ObjectRecord* const page,
+        const kf_int32_t index);
+
+    public: inline ObjectRecord& at(const kf_int32_t index);
+    public: inline const ObjectRecord& at(const kf_int32_t index) const;
+    public: inline ObjectRecordInfo& infoAt(const kf_int32_t index);
+
+    public: inline const ObjectRecordInfo& infoAt(const kf_int32_t index)
+        const;
+
+    public: inline bool isStatic(const kf_int32_t index) const;
+
+  };
+
+
+// --- INLINE METHODS --- //
+
+  /**
+   * Returns the ObjectRecordInfo with the given index, given the page holding
+   * it.
+   */
+
+  inline ObjectRecordInfo& ObjectTable::infoOf(ObjectRecord* const page,
+      const kf_int32_t index)
+  {
+    return ((__k_ObjectTablePage*)page)
+        ->infos[index & KF_OBJECT_TABLE_PAGE_MASK];
+  }
+
+
+  /**
+   * Returns the record at the given index. No boundary check is performed.
+   */
+
+  inline ObjectRecord& ObjectTable::at(const kf_int32_t index) {
+    return _pages[index >> KF_OBJECT_TABLE_PAGE_BITS]
+        [index & KF_OBJECT_TABLE_PAGE_MASK];
+  }
+
+
+  /**
+   * Returns the record at the given index. No boundary check is performed.
+   */
+
+  inline const ObjectRecord& ObjectTable::at(const kf_int32_t index) const {
+    return _pages[index >> KF_OBJECT_TABLE_PAGE_BITS]
+        [index & KF_OBJECT_TABLE_PAGE_MASK];
+  }
+
+
+  /**
+   * Returns the ObjectRecordInfo at the given index. No boundary check is
+   * performed.
+   */
+
+  inline ObjectRecordInfo& ObjectTable::infoAt(const kf_int32_t index) {
+    return infoOf(_pages[index >> KF_OBJECT_TABLE_PAGE_BITS], index);
+  }
+
+
+  /**
+   * Returns the ObjectRecordInfo at the given index. No boundary check is
+   * performed.
+   */
+
+  inline const ObjectRecordInfo& ObjectTable::infoAt(const kf_int32_t index)
+      const
+  {
+    return infoOf(_pages[index >> KF_OBJECT_TABLE_PAGE_BITS], index);
+  }
+
+
+  /**
+   * Checks if the record at the given index is static. Static records never
+   * have a positive retain count, so for records in use, the answer is found
+   * without touching their ObjectRecordInfo.
+   */
+
+  inline bool ObjectTable::isStatic(const kf_int32_t index) const {
+    return at(index).retainCount <= 0 && infoAt(index).isStatic;
+  }
+
+} // namespace kfoundation
+
+#endif /* defined(KFOUNDATION_OBJECTTABLE) */
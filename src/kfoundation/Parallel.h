@@ -0,0 +1,604 @@
+/*---[Parallel.h]----------------------------------------------m(._.)m--------*\
+ |
+ |  Project   : KFoundation
+ |  Declares  : kfoundation::Parallel::*
+ |  Implements: kfoundation::Parallel::*
+ |
+ |  Copyright (c) 2013, 2014, 2015, RIKEN (The Institute of Physical and
+ |  Chemial Research) All rights reserved.
+ |
+ |  Author: Hamed KHANDAN (hamed.khandan@port.kobe-u.ac.jp)
+ |
+ |  This file is distributed under the KnoRBA Free Public License. See
+ |  LICENSE.TXT for details.
+ |
+ *//////////////////////////////////////////////////////////////////////////////
+
+#ifndef KFOUNDATION_PARALLEL
+#define KFOUNDATION_PARALLEL
+
+// Std
+#include <vector>
+#include <algorithm>
+#include <functional>
+
+// Internal
+#include "ThreadPool.h"
+#include "Array.h"
+#include "NumericVector.h"
+#include "VectorExpression.h"
+
+namespace kfoundation {
+
+  using namespace std;
+
+//\/ Internal /\///////////////////////////////////////////////////////////////
+
+  // Most algorithms below cut the array into chunks of `grain` elements
+  // themselves, and give the pool a task over chunk indexes with a grain of
+  // one. This way, each chunk is processed the same way whether the pool
+  // runs it on a worker or on the calling thread.
+
+  inline kf_int32_t __k_chunkBegin(const kf_int32_t chunk,
+      const kf_int32_t grain)
+  {
+    return chunk * grain;
+  }
+
+
+  inline kf_int32_t __k_chunkEnd(const kf_int32_t chunk,
+      const kf_int32_t grain, const kf_int32_t size)
+  {
+    kf_int32_t begin = chunk * grain;
+    return size - begin < grain ? size : begin + grain;
+  }
+
+
+  inline kf_int32_t __k_countChunks(const kf_int32_t size,
+      const kf_int32_t grain)
+  {
+    return size <= 0 ? 0 : (size - 1) / grain + 1;
+  }
+
+
+  template<typename F>
+  class __k_ForEachTask : public ThreadPool::RangeTask {
+    private: const F& _body;
+    private: kf_int32_t _offset;
+
+    public: __k_ForEachTask(const F& body, const kf_int32_t offset)
+    : _body(body), _offset(offset)
+    {
+      // Nothing;
+    }
+
+    public: void run(const kf_int32_t begin, const kf_int32_t end) {
+      for(kf_int32_t i = begin; i < end; i++) {
+        _body(_offset + i);
+      }
+    }
+  };
+
+
+  template<typename T, typename R, typename F>
+  class __k_TransformTask : public ThreadPool::RangeTask {
+    private: const T* _input;
+    private: R* _output;
+    private: const F& _f;
+
+    public: __k_TransformTask(const T* input, R* output, const F& f)
+    : _input(input), _output(output), _f(f)
+    {
+      // Nothing;
+    }
+
+    public: void run(const kf_int32_t begin, const kf_int32_t end) {
+      for(kf_int32_t i = begin; i < end; i++) {
+        _output[i] = _f(_input[i]);
+      }
+    }
+  };
+
+
+  template<typename T, typename F>
+  class __k_ReduceTask : public ThreadPool::RangeTask {
+    private: const T* _input;
+    private: kf_int32_t _size;
+    private: kf_int32_t _grain;
+    private: const F& _op;
+    private: vector<T>& _partials;
+
+    public: __k_ReduceTask(const T* input, const kf_int32_t size,
+        const kf_int32_t grain, const F& op, vector<T>& partials)
+    : _input(input), _size(size), _grain(grain), _op(op), _partials(partials)
+    {
+      // Nothing;
+    }
+
+    public: void run(const kf_int32_t begin, const kf_int32_t end) {
+      for(kf_int32_t c = begin; c < end; c++) {
+        kf_int32_t last = __k_chunkEnd(c, _grain, _size);
+        kf_int32_t i = __k_chunkBegin(c, _grain);
+        T acc = _input[i];
+        for(i++; i < last; i++) {
+          acc = _op(acc, _input[i]);
+        }
+        _partials[c] = acc;
+      }
+    }
+  };
+
+
+  template<typename T, typename F>
+  class __k_ScanTask : public ThreadPool::RangeTask {
+    private: const T* _input;
+    private: T* _output;
+    private: kf_int32_t _size;
+    private: kf_int32_t _grain;
+    private: const F& _op;
+    private: vector<T>& _carries;
+
+    public: __k_ScanTask(const T* input, T* output, const kf_int32_t size,
+        const kf_int32_t grain, const F& op, vector<T>& carries)
+    : _input(input), _output(output), _size(size), _grain(grain), _op(op),
+      _carries(carries)
+    {
+      // Nothing;
+    }
+
+    public: void run(const kf_int32_t begin, const kf_int32_t end) {
+      for(kf_int32_t c = begin; c < end; c++) {
+        kf_int32_t last = __k_chunkEnd(c, _grain, _size);
+        kf_int32_t i = __k_chunkBegin(c, _grain);
+        T acc = c == 0 ? _input[i] : _op(_carries[c], _input[i]);
+        _output[i] = acc;
+        for(i++; i < last; i++) {
+          acc = _op(acc, _input[i]);
+          _output[i] = acc;
+        }
+      }
+    }
+  };
+
+
+  template<typename T, typename C>
+  class __k_SortTask : public ThreadPool::RangeTask {
+    private: T* _data;
+    private: kf_int32_t _size;
+    private: kf_int32_t _grain;
+    private: const C& _comp;
+    private: bool _isStable;
+
+    public: __k_SortTask(T* data, const kf_int32_t size,
+        const kf_int32_t grain, const C& comp, const bool isStable)
+    : _data(data), _size(size), _grain(grain), _comp(comp),
+      _isStable(isStable)
+    {
+      // Nothing;
+    }
+
+    public: void run(const kf_int32_t begin, const kf_int32_t end) {
+      for(kf_int32_t c = begin; c < end; c++) {
+        T* first = _data + __k_chunkBegin(c, _grain);
+        T* last = _data + __k_chunkEnd(c, _grain, _size);
+        if(_isStable) {
+          stable_sort(first, last, _comp);
+        } else {
+          sort(first, last, _comp);
+        }
+      }
+    }
+  };
+
+
+  // Merges pairs of adjacent sorted runs of `width` elements. On ties,
+  // elements of the first run come first, which keeps the sort stable.
+
+  template<typename T, typename C>
+  class __k_MergeTask : public ThreadPool::RangeTask {
+    private: const T* _source;
+    private: T* _target;
+    private: kf_int32_t _size;
+    private: kf_int32_t _width;
+    private: const C& _comp;
+
+    public: __k_MergeTask(const T* source, T* target, const kf_int32_t size,
+        const kf_int32_t width, const C& comp)
+    : _source(source), _target(target), _size(size), _width(width),
+      _comp(comp)
+    {
+      // Nothing;
+    }
+
+    public: void run(const kf_int32_t begin, const kf_int32_t end) {
+      for(kf_int32_t p = begin; p < end; p++) {
+        kf_int32_t lo = __k_chunkBegin(p, 2 * _width);
+        kf_int32_t hi = __k_chunkEnd(p, 2 * _width, _size);
+        kf_int32_t mid = hi - lo < _width ? hi : lo + _width;
+        merge(_source + lo, _source + mid, _source + mid, _source + hi,
+            _target + lo, _comp);
+      }
+    }
+  };
+
+
+  template<typename T>
+  class __k_CopyTask : public ThreadPool::RangeTask {
+    private: const T* _source;
+    private: T* _target;
+
+    public: __k_CopyTask(const T* source, T* target)
+    : _source(source), _target(target)
+    {
+      // Nothing;
+    }
+
+    public: void run(const kf_int32_t begin, const kf_int32_t end) {
+      copy(_source + begin, _source + end, _target + begin);
+    }
+  };
+
+
+  template<typename T, typename E>
+  class __k_EvaluateTask : public ThreadPool::RangeTask {
+    private: const VectorExpression<T, E>& _expression;
+    private: T* _output;
+
+    public: __k_EvaluateTask(const VectorExpression<T, E>& expression,
+        T* output)
+    : _expression(expression), _output(output)
+    {
+      // Nothing;
+    }
+
+    public: void run(const kf_int32_t begin, const kf_int32_t end) {
+      for(kf_int32_t i = begin; i < end; i++) {
+        _output[i] = _expression.at(i);
+      }
+    }
+  };
+
+
+//\/ Parallel /\///////////////////////////////////////////////////////////////
+
+  /**
+   * Bulk algorithms over Array and NumericVector, executed by a ThreadPool.
+   * Each algorithm cuts its input into chunks of `grain` elements, which
+   * are processed concurrently; the default pool is used unless another one
+   * is given. Inputs no larger than one chunk are processed on the calling
+   * thread. Usage:
+   *
+   *     struct Square {
+   *       int operator()(const int x) const { return x * x; }
+   *     };
+   *
+   *     Parallel::transform(*input, *output, Square());
+   *     Parallel::sort(*output);
+   *
+   * Functions and comparators are called concurrently from several threads,
+   * so they should not modify shared state. The operators given to reduce()
+   * and inclusiveScan() should be associative. Chunks are combined in
+   * order, so for a given grain, the result does not depend on the number
+   * of threads.
+   *
+   * @ingroup containers
+   * @ingroup thread
+   * @headerfile Parallel.h <kfoundation/Parallel.h>
+   */
+
+  class Parallel {
+
+  // --- STATIC FIELDS --- //
+
+    public: static const kf_int32_t DEFAULT_GRAIN = 4096;
+
+
+  // --- STATIC METHODS --- //
+
+    private: template<typename T, typename C>
+    static void mergeSort(Array<T>& array, const C& comp,
+        const kf_int32_t grain, ThreadPool& pool, const bool isStable);
+
+    public: template<typename F>
+    static void forEach(const kf_int32_t begin, const kf_int32_t end,
+        const F& body, const kf_int32_t grain = DEFAULT_GRAIN,
+        ThreadPool& pool = ThreadPool::getDefault());
+
+    public: template<typename T, typename R, typename F>
+    static void transform(const Array<T>& input, Array<R>& output,
+        const F& f, const kf_int32_t grain = DEFAULT_GRAIN,
+        ThreadPool& pool = ThreadPool::getDefault());
+
+    public: template<typename T, typename F>
+    static T reduce(const Array<T>& input, const T& identity, const F& op,
+        const kf_int32_t grain = DEFAULT_GRAIN,
+        ThreadPool& pool = ThreadPool::getDefault());
+
+    public: template<typename T, typename F>
+    static void inclusiveScan(const Array<T>& input, Array<T>& output,
+        const F& op, const kf_int32_t grain = DEFAULT_GRAIN,
+        ThreadPool& pool = ThreadPool::getDefault());
+
+    public: template<typename T>
+    static void sort(Array<T>& array, const kf_int32_t grain = DEFAULT_GRAIN,
+        ThreadPool& pool = ThreadPool::getDefault());
+
+    public: template<typename T, typename C>
+    static void sort(Array<T>& array, const C& comp,
+        const kf_int32_t grain = DEFAULT_GRAIN,
+        ThreadPool& pool = ThreadPool::getDefault());
+
+    public: template<typename T>
+    static void stableSort(Array<T>& array,
+        const kf_int32_t grain = DEFAULT_GRAIN,
+        ThreadPool& pool = ThreadPool::getDefault());
+
+    public: template<typename T, typename C>
+    static void stableSort(Array<T>& array, const C& comp,
+        const kf_int32_t grain = DEFAULT_GRAIN,
+        ThreadPool& pool = ThreadPool::getDefault());
+
+    public: template<typename T, typename E>
+    static void evaluate(NumericVector<T>& output,
+        const VectorExpression<T, E>& expression,
+        const kf_int32_t grain = DEFAULT_GRAIN,
+        ThreadPool& pool = ThreadPool::getDefault());
+
+  };
+
+
+// --- STATIC METHODS --- //
+
+  /**
+   * Sorts each chunk, which should hold at least `array.getSize()` divided by
+   * the number of threads elements, and then merges pairs of sorted runs,
+   * doubling their length until one is left. The last merges have fewer
+   * pairs than threads, and the very last one runs on a single thread.
+   */
+
+  template<typename T, typename C>
+  void Parallel::mergeSort(Array<T>& array, const C& comp,
+      const kf_int32_t grain, ThreadPool& pool, const bool isStable)
+  {
+    kf_int32_t n = array.getSize();
+    kf_int32_t width = max(max(grain, (kf_int32_t)1),
+        __k_countChunks(n, pool.getSize()));
+
+    T* data = array.getData();
+    __k_SortTask<T, C> sortTask(data, n, width, comp, isStable);
+    pool.execute(sortTask, __k_countChunks(n, width), 1);
+
+    if(width >= n) {
+      return;
+    }
+
+    vector<T> buffer(n);
+    T* source = data;
+    T* target = &buffer[0];
+
+    for(; width < n; width = n - width < width ? n : 2 * width) {
+      __k_MergeTask<T, C> mergeTask(source, target, n, width, comp);
+      pool.execute(mergeTask, __k_countChunks(n, 2 * width), 1);
+      swap(source, target);
+    }
+
+    if(source != data) {
+      __k_CopyTask<T> copyTask(source, data);
+      pool.execute(copyTask, n, grain);
+    }
+  }
+
+
+  /**
+   * Calls `body(i)` for every `i` in `[begin, end)`.
+   *
+   * @param begin The first index.
+   * @param end The index after the last.
+   * @param body The function object to call.
+   * @param grain The number of indexes in each chunk.
+   * @param pool The pool to run on.
+   */
+
+  template<typename F>
+  void Parallel::forEach(const kf_int32_t begin, const kf_int32_t end,
+      const F& body, const kf_int32_t grain, ThreadPool& pool)
+  {
+    __k_ForEachTask<F> task(body, begin);
+    pool.execute(task, end - begin, grain);
+  }
+
+
+  /**
+   * Sets `output[i] = f(input[i])` for every element of the input. The
+   * output is resized to the size of the input, and may be the same array.
+   *
+   * @param input The input array.
+   * @param output The output array.
+   * @param f The function object to apply.
+   * @param grain The number of elements in each chunk.
+   * @param pool The pool to run on.
+   */
+
+  template<typename T, typename R, typename F>
+  void Parallel::transform(const Array<T>& input, Array<R>& output,
+      const F& f, const kf_int32_t grain, ThreadPool& pool)
+  {
+    output.setSize(input.getSize());
+    __k_TransformTask<T, R, F> task(input.getData(), output.getData(), f);
+    pool.execute(task, input.getSize(), grain);
+  }
+
+
+  /**
+   * Combines all elements of the given array with the given operator, as in
+   * `identity op input[0] op input[1] op ...`.
+   *
+   * @param input The input array.
+   * @param identity The value returned for an empty array.
+   * @param op Associative binary function object.
+   * @param grain The number of elements in each chunk.
+   * @param pool The pool to run on.
+   */
+
+  template<typename T, typename F>
+  T Parallel::reduce(const Array<T>& input, const T& identity, const F& op,
+      const kf_int32_t grain, ThreadPool& pool)
+  {
+    kf_int32_t g = max(grain, (kf_int32_t)1);
+    kf_int32_t nChunks = __k_countChunks(input.getSize(), g);
+    vector<T> partials(nChunks, identity);
+
+    __k_ReduceTask<T, F> task(input.getData(), input.getSize(), g, op,
+        partials);
+    pool.execute(task, nChunks, 1);
+
+    T result = identity;
+    for(kf_int32_t c = 0; c < nChunks; c++) {
+      result = op(result, partials[c]);
+    }
+    return result;
+  }
+
+
+  /**
+   * Sets `output[i] = input[0] op input[1] op ... op input[i]` for every
+   * element of the input. The output is resized to the size of the input,
+   * and may be the same array.
+   *
+   * The sum of each chunk is computed first, then the running sums of the
+   * chunks, and finally the running sums within each chunk, reading the
+   * input twice.
+   *
+   * @param input The input array.
+   * @param output The output array.
+   * @param op Associative binary function object.
+   * @param grain The number of elements in each chunk.
+   * @param pool The pool to run on.
+   */
+
+  template<typename T, typename F>
+  void Parallel::inclusiveScan(const Array<T>& input, Array<T>& output,
+      const F& op, const kf_int32_t grain, ThreadPool& pool)
+  {
+    kf_int32_t n = input.getSize();
+    kf_int32_t g = max(grain, (kf_int32_t)1);
+    kf_int32_t nChunks = __k_countChunks(n, g);
+    if(nChunks == 0) {
+      output.setSize(0);
+      return;
+    }
+
+    vector<T> carries(nChunks);
+    if(nChunks > 1) {
+      __k_ReduceTask<T, F> reduceTask(input.getData(), n, g, op, carries);
+      pool.execute(reduceTask, nChunks - 1, 1);
+      for(kf_int32_t c = nChunks - 1; c > 0; c--) {
+        carries[c] = carries[c - 1];
+      }
+      for(kf_int32_t c = 2; c < nChunks; c++) {
+        carries[c] = op(carries[c - 1], carries[c]);
+      }
+    }
+
+    output.setSize(n);
+    __k_ScanTask<T, F> scanTask(input.getData(), output.getData(), n, g, op,
+        carries);
+    pool.execute(scanTask, nChunks, 1);
+  }
+
+
+  /**
+   * Sorts the given array in ascending order using `operator<`. The order
+   * of equal elements is not preserved.
+   *
+   * @param array The array to sort.
+   * @param grain The minimum number of elements in each chunk.
+   * @param pool The pool to run on.
+   */
+
+  template<typename T>
+  void Parallel::sort(Array<T>& array, const kf_int32_t grain,
+      ThreadPool& pool)
+  {
+    mergeSort(array, less<T>(), grain, pool, false);
+  }
+
+
+  /**
+   * Sorts the given array in ascending order using the given comparator.
+   * The order of equal elements is not preserved.
+   *
+   * @param array The array to sort.
+   * @param comp Function object returning `true` if its first argument
+   *             should come before its second.
+   * @param grain The minimum number of elements in each chunk.
+   * @param pool The pool to run on.
+   */
+
+  template<typename T, typename C>
+  void Parallel::sort(Array<T>& array, const C& comp,
+      const kf_int32_t grain, ThreadPool& pool)
+  {
+    mergeSort(array, comp, grain, pool, false);
+  }
+
+
+  /**
+   * Sorts the given array in ascending order using `operator<`, preserving
+   * the order of equal elements.
+   *
+   * @param array The array to sort.
+   * @param grain The minimum number of elements in each chunk.
+   * @param pool The pool to run on.
+   */
+
+  template<typename T>
+  void Parallel::stableSort(Array<T>& array, const kf_int32_t grain,
+      ThreadPool& pool)
+  {
+    mergeSort(array, less<T>(), grain, pool, true);
+  }
+
+
+  /**
+   * Sorts the given array in ascending order using the given comparator,
+   * preserving the order of equal elements.
+   *
+   * @param array The array to sort.
+   * @param comp Function object returning `true` if its first argument
+   *             should come before its second.
+   * @param grain The minimum number of elements in each chunk.
+   * @param pool The pool to run on.
+   */
+
+  template<typename T, typename C>
+  void Parallel::stableSort(Array<T>& array, const C& comp,
+      const kf_int32_t grain, ThreadPool& pool)
+  {
+    mergeSort(array, comp, grain, pool, true);
+  }
+
+
+  /**
+   * Sets the given vector to the result of the given expression, computing
+   * chunks of it concurrently. See NumericVector::assign().
+   *
+   * @param output The vector to assign.
+   * @param expression The expression to evaluate.
+   * @param grain The number of elements in each chunk.
+   * @param pool The pool to run on.
+   */
+
+  template<typename T, typename E>
+  void Parallel::evaluate(NumericVector<T>& output,
+      const VectorExpression<T, E>& expression, const kf_int32_t grain,
+      ThreadPool& pool)
+  {
+    output.setSize(expression.getSize());
+    __k_EvaluateTask<T, E> task(expression, output.getData());
+    pool.execute(task, expression.getSize(), grain);
+  }
+
+} // namespace kfoundation
+
+#endif /* defined(KFOUNDATION_PARALLEL) */
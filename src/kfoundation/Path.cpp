@@ -204,7 +204,7 @@ namespace kfoundation {
       return new Path(str);
     }
     
-    return getPtr().AS(Path).retain();
+    return KF_MOVE(getPtr().AS(Path));
   }
   
   
@@ -3,6 +3,7 @@
  |  Project   : KFoundation
  |  Declares  : -
  |  Implements: kfoundation::PtrBase::*
+ |              kfoundation::PtrVisitor::*
  |
  |  Copyright (c) 2013, 2014, 2015, RIKEN (The Institute of Physical and
  |  Chemial Research) All rights reserved.
@@ -22,8 +23,26 @@ namespace kfoundation {
 //\/ PtrBase /\////////////////////////////////////////////////////////////////
   
   MasterMemoryManager* PtrBase::master = NULL;
-  ObjectRecord** PtrBase::objectTable  = NULL;
+  ObjectRecord*** PtrBase::objectTable  = NULL;
   long int PtrBase::serial = 0;
   
+  
+//\/ PtrVisitor /\/////////////////////////////////////////////////////////////
+  
+  /**
+   * Deconstructor.
+   */
+  
+  PtrVisitor::~PtrVisitor() {
+    // Nothing;
+  }
+  
+  
+  /**
+   * @fn kfoundation::PtrVisitor::visit(PtrBase&)
+   *
+   * Called for each managed pointer held by the object being traversed.
+   */
+  
 }
 
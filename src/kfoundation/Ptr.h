@@ -5,6 +5,7 @@
  |  Implements: kfoundation::Ptr<T>::*
  |              kfoundation::SPtr<T>::*
  |              kfoundation::PPtr<T>::*
+ |              kfoundation::WPtr<T>::*
  |
  |  Copyright (c) 2013, 2014, 2015, RIKEN (The Institute of Physical and
  |  Chemial Research) All rights reserved.
@@ -27,6 +28,9 @@
 #include "NullPointerException.h"
 #include "MasterMemoryManager.h"
 #include "MemoryManager.h"
+#include "ObjectTable.h"
+#include "ReleasePool.h"
+#include "AllocationProfiler.h"
 #include "Logger.h"
 #include "ManagedObject.h"
 #include "System.h"
@@ -37,6 +41,37 @@
 namespace kfoundation {
 
   
+//\/ PtrBase /\////////////////////////////////////////////////////////////////
+
+  /**
+   * Returns the record at the given index of the object table of the given
+   * manager.
+   */
+  
+  inline ObjectRecord* PtrBase::getRecord(const kf_int8_t managerIndex,
+      const kf_int32_t objectIndex)
+  {
+    return (*(objectTable + managerIndex))
+        [objectIndex >> KF_OBJECT_TABLE_PAGE_BITS]
+        + (objectIndex & KF_OBJECT_TABLE_PAGE_MASK);
+  }
+  
+  
+  /**
+   * Returns the ObjectRecordInfo at the given index of the object table of
+   * the given manager.
+   */
+  
+  inline ObjectRecordInfo* PtrBase::getRecordInfo(const kf_int8_t managerIndex,
+      const kf_int32_t objectIndex)
+  {
+    return &ObjectTable::infoOf(
+        (*(objectTable + managerIndex))
+            [objectIndex >> KF_OBJECT_TABLE_PAGE_BITS],
+        objectIndex);
+  }
+  
+  
 //\/ Ptr /\////////////////////////////////////////////////////////////////////
   
 // --- (DE)CONSTRUCTORS --- //
@@ -79,6 +114,9 @@ namespace kfoundation {
         throw KFException("Master manager is not initialized.");
       }      
       _locator = obj->getPtr().getLocator();
+      if(AllocationProfiler::isEnabled()) {
+        AllocationProfiler::resolve(obj);
+      }
     }
     
     _locator.autorelease = true;
@@ -94,12 +132,16 @@ namespace kfoundation {
   
   template<typename T>
   Ptr<T>::Ptr(const kf_int8_t managerIndex, const kf_int32_t objectIndex) {
-    ObjectRecord* record = *(objectTable + managerIndex) + objectIndex;
+    ObjectRecord* record = getRecord(managerIndex, objectIndex);
     _locator.objectIndex = objectIndex;
     _locator.key = record->key;
     _locator.managerIndex = managerIndex;
     _locator.trace = false;
     _locator.autorelease = false;
+    
+    #ifdef KF_PTR_UNCHECKED
+    _locator.object = record->ptr;
+    #endif
 
     #ifdef DEBUG
     _obj = record->ptr;
@@ -131,6 +173,61 @@ namespace kfoundation {
   }
 
   
+#ifdef KF_RVALUE_REFERENCES
+  
+  /**
+   * Move constructor. Takes over the reference held by the other pointer
+   * without retaining it, and leaves the other pointer NULL so that it will
+   * not release the object. A passive pointer holds no reference to take
+   * over, so in that case the object is retained instead. Only available
+   * with C++11.
+   *
+   * While cycles are being collected, the object is retained for this
+   * pointer and released for the other one instead, so that the collector
+   * never finds one reference in two places; see
+   * RefCountMemoryManager::collectCycles().
+   *
+   * @param other The pointer to be moved.
+   */
+  
+  template<typename T>
+  inline Ptr<T>::Ptr(Ptr<T>&& other) {
+    #ifdef DEBUG
+    _obj = other._obj;
+    _serial = serial++;
+    #endif
+    
+    ObjectLocator locator = other._locator;
+    const bool isCopied = locator.objectIndex != -1
+        && (!locator.autorelease || master->isCollectingCycles());
+    
+    // See replace(const Ptr<T>&) for the order of the operations.
+    if(isCopied) {
+      master->getManagerAtIndex(locator.managerIndex)
+            ->retain(locator.objectIndex, locator.key);
+    }
+    
+    _locator = locator;
+    _locator.autorelease = true;
+    
+    if(isCopied && locator.autorelease) {
+      // Releases the reference of the other pointer after clearing it.
+      Ptr<T> source(other);
+      other._locator.objectIndex = -1;
+    } else if(locator.autorelease) {
+      other._locator.objectIndex = -1;
+    }
+    
+    #ifdef DEBUG
+    if(_locator.trace) {
+      printEvent("moved");
+    }
+    #endif
+  }
+  
+#endif
+  
+  
   /**
    * Deconstructor. If not a passive pointer, the pointed object will
    * be released.
@@ -250,9 +347,13 @@ namespace kfoundation {
     if(_locator.objectIndex == -1) {
       return *this;
     }
-
-    master->getManagerAtIndex(_locator.managerIndex)
-          ->release(_locator.objectIndex, _locator.key);
+    
+    if(!ReleasePool::defer(_locator.managerIndex, _locator.objectIndex,
+        _locator.key))
+    {
+      master->getManagerAtIndex(_locator.managerIndex)
+            ->release(_locator.objectIndex, _locator.key);
+    }
     
     #ifdef DEBUG
     if(_locator.trace) {
@@ -282,19 +383,22 @@ namespace kfoundation {
     }
     #endif
     
-    if(_locator.objectIndex != -1) {
-      release();
-    }
-    
     if(!master) {
       throw KFException("Master manager is not initialized.");
     }
     
+    // Takes over the reference to the previous object, and releases it once
+    // the new one is stored. See replace(const Ptr<T>&).
+    Ptr<T> previous(*this);
+    
     if(!replacement) {
       _locator.objectIndex = -1;
     } else {
       _locator = replacement->getPtr().getLocator();
       _locator.autorelease = true;
+      if(AllocationProfiler::isEnabled()) {
+        AllocationProfiler::resolve(replacement);
+      }
     }
     
     return *this;
@@ -319,17 +423,22 @@ namespace kfoundation {
     #endif
     
     const bool ar = _locator.autorelease;
+    ObjectLocator locator = replacement.getLocator();
     
-    if(ar && _locator.objectIndex != -1) {
-      release();
+    // The new object is retained before it is stored, and the previous one
+    // is released after, so that a pointer never holds an object it does not
+    // hold a reference to, as assumed by the cycle collector. This also makes
+    // assigning a pointer to itself safe.
+    if(ar && locator.objectIndex != -1) {
+      master->getManagerAtIndex(locator.managerIndex)
+            ->retain(locator.objectIndex, locator.key);
     }
     
-    _locator = replacement.getLocator();
-    _locator.autorelease = ar;
+    Ptr<T> previous(*this);
+    previous._locator.autorelease = ar;
     
-    if(ar && _locator.objectIndex != -1) {
-      retain();
-    }
+    _locator = locator;
+    _locator.autorelease = ar;
     
     return *this;
   }
@@ -369,14 +478,14 @@ namespace kfoundation {
       return RETAIN_COUNT_NULL;
     }
     
-    ObjectRecord* record = *(objectTable + _locator.managerIndex)
-        + _locator.objectIndex;
+    ObjectRecord* record
+        = getRecord(_locator.managerIndex, _locator.objectIndex);
     
     if(record->ptr == NULL || record->retainCount == 0) {
       return RETAIN_COUNT_INVALID;
     }
     
-    if(record->isStatic) {
+    if(getRecordInfo(_locator.managerIndex, _locator.objectIndex)->isStatic) {
       return RETAIN_COUNT_STATIC;
     }
     
@@ -405,8 +514,8 @@ namespace kfoundation {
       return false;
     }
     
-    ObjectRecord* record = *(objectTable + _locator.managerIndex)
-        + _locator.objectIndex;
+    ObjectRecord* record
+        = getRecord(_locator.managerIndex, _locator.objectIndex);
     
     return record->key == _locator.key;
   }
@@ -430,8 +539,12 @@ namespace kfoundation {
           + toShortString());
     }
     
-    ObjectRecord* record = *(objectTable + _locator.managerIndex)
-        + _locator.objectIndex;
+    #ifdef KF_PTR_UNCHECKED
+    return *((T*)_locator.object);
+    #endif
+    
+    ObjectRecord* record
+        = getRecord(_locator.managerIndex, _locator.objectIndex);
     
     if(record->key != _locator.key) {
       throw InvalidPointerException("Attempt to dereference an invalid pointer: "
@@ -452,8 +565,8 @@ namespace kfoundation {
       return NULL;
     }
     
-    ObjectRecord* record = *(objectTable + _locator.managerIndex)
-      + _locator.objectIndex;
+    ObjectRecord* record
+        = getRecord(_locator.managerIndex, _locator.objectIndex);
     
     if(record->key != _locator.key) {
       return NULL;
@@ -475,8 +588,12 @@ namespace kfoundation {
                                  + toShortString());
     }
     
-    ObjectRecord* record = *(objectTable + _locator.managerIndex)
-        + _locator.objectIndex;
+    #ifdef KF_PTR_UNCHECKED
+    return (T*)_locator.object;
+    #endif
+    
+    ObjectRecord* record
+        = getRecord(_locator.managerIndex, _locator.objectIndex);
     
     if(record->key != _locator.key) {
       throw InvalidPointerException("Attempt to dereference an invalid "
@@ -500,6 +617,66 @@ namespace kfoundation {
   }
 
   
+#ifdef KF_RVALUE_REFERENCES
+  
+  /**
+   * Move assignment. Releases the previous object, and takes over the
+   * reference held by the other pointer. If the other pointer is passive, the
+   * new object is retained instead. This pointer's autorelease setting is
+   * preserved, and a passive pointer only copies the other pointer. Only
+   * available with C++11.
+   *
+   * While cycles are being collected, the object is retained for this
+   * pointer and released for the other one instead; see the move
+   * constructor.
+   *
+   * @return Self
+   */
+  
+  template<typename T>
+  inline Ptr<T>& Ptr<T>::operator=(Ptr<T>&& other) {
+    if(this == &other) {
+      return *this;
+    }
+    
+    #ifdef DEBUG
+    _obj = other._obj;
+    if(_locator.trace) {
+      printEvent("is being moved to");
+    }
+    #endif
+    
+    const bool ar = _locator.autorelease;
+    ObjectLocator locator = other._locator;
+    const bool isCopied = ar && locator.objectIndex != -1
+        && (!locator.autorelease || master->isCollectingCycles());
+    
+    // See replace(const Ptr<T>&) for the order of the operations.
+    if(isCopied) {
+      master->getManagerAtIndex(locator.managerIndex)
+            ->retain(locator.objectIndex, locator.key);
+    }
+    
+    Ptr<T> previous(*this);
+    previous._locator.autorelease = ar;
+    
+    _locator = locator;
+    _locator.autorelease = ar;
+    
+    if(isCopied && locator.autorelease) {
+      // Releases the reference of the other pointer after clearing it.
+      Ptr<T> source(other);
+      other._locator.objectIndex = -1;
+    } else if(ar && locator.autorelease) {
+      other._locator.objectIndex = -1;
+    }
+    
+    return *this;
+  }
+  
+#endif
+  
+  
   /**
    * Replaces the pointed object with a new one, releases the previous object,
    * and retains the new one. Internally, it calls replace(T* const&).
@@ -623,7 +800,7 @@ namespace kfoundation {
     }
 #endif
     
-    return p.retain();
+    return KF_MOVE(p);
   }
  
 #ifdef DEBUG
@@ -719,13 +896,9 @@ namespace kfoundation {
   SPtr<T>::SPtr(T* obj)
   : Ptr<T>(obj)
   {
-    ObjectRecord* record = *(Ptr<T>::objectTable + Ptr<T>::_locator.managerIndex)
-        + Ptr<T>::_locator.objectIndex;
-    record->isStatic = true;
-    record->retainCount = -10;
     Ptr<T>::_locator.autorelease = false;
     Ptr<T>::_locator.selfDestruct = false;
-    System::getMasterMemoryManager().registerSPtr(this);
+    makeStatic();
   }
   
   
@@ -738,13 +911,32 @@ namespace kfoundation {
   SPtr<T>::SPtr(const Ptr<T>& obj)
   : Ptr<T>(obj)
   {
-    ObjectRecord* record = *(Ptr<T>::objectTable + Ptr<T>::_locator.managerIndex)
-        + Ptr<T>::_locator.objectIndex;
-    record->isStatic = true;
-    record->retainCount = -10;
     Ptr<T>::_locator.autorelease = false;
     Ptr<T>::_locator.selfDestruct = false;
-    System::getMasterMemoryManager().registerSPtr(this);
+    makeStatic();
+  }
+  
+  
+  /**
+   * Marks the pointed object as static, and registers this pointer to the
+   * master memory manager. A non-NULL object has already been registered to
+   * a manager, so the master is known to exist and is accessed directly,
+   * rather than via System::getMasterMemoryManager(). Both steps take
+   * constant time.
+   */
+  
+  template<typename T>
+  void SPtr<T>::makeStatic() {
+    const PtrBase::ObjectLocator& locator = Ptr<T>::_locator;
+    
+    if(locator.objectIndex == -1) {
+      return;
+    }
+    
+    Ptr<T>::master->getManagerAtIndex(locator.managerIndex)
+        ->setStatic(locator.objectIndex, locator.key);
+    
+    Ptr<T>::master->registerSPtr(this);
   }
   
   
@@ -833,6 +1025,156 @@ namespace kfoundation {
      // Nothing;
   }
   
+
+//\/ WPtr /\///////////////////////////////////////////////////////////////////
+  
+  /**
+   * Constructs a NULL weak pointer.
+   */
+  
+  template<typename T>
+  WPtr<T>::WPtr() {
+    _locator.objectIndex = -1;
+    _locator.autorelease = false;
+    _locator.trace = false;
+  }
+  
+  
+  /**
+   * Constructs a weak pointer to the object pointed by the given pointer.
+   *
+   * @param ptr The pointer to refer to.
+   */
+  
+  template<typename T>
+  WPtr<T>::WPtr(const Ptr<T>& ptr) {
+    _locator = ptr.getLocator();
+    _locator.autorelease = false;
+    _locator.trace = false;
+  }
+  
+  
+  /**
+   * Makes this pointer refer to the object pointed by the given pointer.
+   *
+   * @param ptr The pointer to refer to.
+   * @return Self
+   */
+  
+  template<typename T>
+  WPtr<T>& WPtr<T>::operator=(const Ptr<T>& ptr) {
+    _locator = ptr.getLocator();
+    _locator.autorelease = false;
+    _locator.trace = false;
+    return *this;
+  }
+  
+  
+  /**
+   * Returns a pointer to the referred object, and retains it, if the object
+   * still exists. Otherwise, returns a NULL pointer. The check and the
+   * retain are atomic, so an object that is concurrently being deleted is
+   * never returned.
+   */
+  
+  template<typename T>
+  Ptr<T> WPtr<T>::toPtr() const {
+    // Read once, so that the object retained is the one returned even if
+    // this pointer is reassigned meanwhile.
+    const ObjectLocator locator = _locator;
+    
+    if(locator.objectIndex == -1
+        || *(objectTable + locator.managerIndex) == NULL)
+    {
+      return Ptr<T>();
+    }
+    
+    if(!master->getManagerAtIndex(locator.managerIndex)
+        ->tryRetain(locator.objectIndex, locator.key))
+    {
+      return Ptr<T>();
+    }
+    
+    // Takes over the reference obtained by tryRetain().
+    Ptr<T> p(locator.managerIndex, locator.objectIndex);
+    p.setAutorelease(true);
+    
+    return KF_MOVE(p);
+  }
+  
+  
+  /**
+   * Checks if this is a NULL pointer.
+   */
+  
+  template<typename T>
+  inline bool WPtr<T>::isNull() const {
+    return _locator.objectIndex == -1;
+  }
+  
+  
+  /**
+   * Checks if the referred object exists. The object may be deleted right
+   * after this method returns by another thread; use toPtr() to access it.
+   */
+  
+  template<typename T>
+  bool WPtr<T>::isValid() const {
+    if(_locator.objectIndex == -1
+        || *(objectTable + _locator.managerIndex) == NULL)
+    {
+      return false;
+    }
+    
+    ObjectRecord* record
+        = getRecord(_locator.managerIndex, _locator.objectIndex);
+    
+    return record->key == _locator.key && record->ptr != NULL;
+  }
+  
+  
+  /**
+   * Equality operator.
+   */
+  
+  template<typename T>
+  inline bool WPtr<T>::operator==(const WPtr<T>& other) const {
+    return _locator.objectIndex == other._locator.objectIndex
+        && _locator.managerIndex == other._locator.managerIndex
+        && _locator.key == other._locator.key;
+  }
+  
+  
+  /**
+   * Checks if this pointer refers to the object pointed by the given pointer.
+   */
+  
+  template<typename T>
+  inline bool WPtr<T>::operator==(const Ptr<T>& ptr) const {
+    return *this == WPtr<T>(ptr);
+  }
+  
+  
+  /**
+   * Inequality operator.
+   */
+  
+  template<typename T>
+  inline bool WPtr<T>::operator!=(const WPtr<T>& other) const {
+    return !(*this == other);
+  }
+  
+  
+  /**
+   * Checks if this pointer does not refer to the object pointed by the given
+   * pointer.
+   */
+  
+  template<typename T>
+  inline bool WPtr<T>::operator!=(const Ptr<T>& ptr) const {
+    return !(*this == ptr);
+  }
+  
 } // namespace kfoundation
 
 
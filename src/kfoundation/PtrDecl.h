@@ -2,9 +2,11 @@
  |
  |  Project   : KFoundation
  |  Declares  : kfoundation::PtrBase::*
+ |              kfoundation::PtrVisitor::*
  |              kfoundation::Ptr<T>::*
  |              kfoundation::SPtr<T>::*
  |              kfoundation::PPtr<T>::*
+ |              kfoundation::WPtr<T>::*
  |  Implements: -
  |
  |  Copyright (c) 2013, 2014, 2015, RIKEN (The Institute of Physical and
@@ -23,6 +25,10 @@
 #include "definitions.h"
 #include "SerializingStreamer.h"
 
+#ifdef KF_RVALUE_REFERENCES
+#  include <utility>
+#endif
+
 /**
  * Operates like a member function on a Ptr<T> and returns a boolean. 
  * If `myObject.ISA(MyClass)` returns true, then myObject is an instance of
@@ -47,6 +53,45 @@
 
 #define AS(X) cast<X>()
 
+
+/**
+ * Transfers the reference held by the given pointer to the pointer that is
+ * copy-constructed from it, for example when returning a local Ptr or
+ * passing on a temporary one. Usage:
+ *
+ *     return KF_MOVE(myObject);
+ *
+ * With C++11 the pointer is moved, leaving the argument NULL, and the retain
+ * count is not touched. Otherwise, the argument is retained on behalf of the
+ * copy.
+ *
+ * @ingroup defs
+ * @ingroup memory
+ */
+
+#ifdef KF_RVALUE_REFERENCES
+#  define KF_MOVE(X) std::move(X)
+#else
+#  define KF_MOVE(X) (X).retain()
+#endif
+
+/**
+ * @def KF_PTR_UNCHECKED
+ * When defined, each Ptr caches the memory location of the object it points
+ * to, and operator->() and operator*() return it directly. The pointer is
+ * still checked for NULL, but it is no longer validated against the table of
+ * its memory manager, so dereferencing a pointer to a deleted object is
+ * undefined instead of throwing InvalidPointerException. isValid() and
+ * toPurePtr() keep performing the full check. The cached address makes each
+ * Ptr one machine word larger.
+ *
+ * Meant for release builds of code that is already known to be free of
+ * dangling pointers.
+ *
+ * @ingroup defs
+ * @ingroup memory
+ */
+
 #define RETAIN_COUNT_INVALID -1;
 #define RETAIN_COUNT_NULL -2;
 #define RETAIN_COUNT_STATIC -10;
@@ -61,6 +106,7 @@ namespace kfoundation {
   class MasterMemoryManager;
   class MemoryManager;
   struct ObjectRecord;
+  struct ObjectRecordInfo;
   
   template<typename T>
   class PPtr;
@@ -70,12 +116,16 @@ namespace kfoundation {
   
   class PtrBase {
   friend class MasterMemoryManager;
+  friend class RefCountMemoryManager;
     
   // --- NESTED TYPES --- //
     
     protected: struct ObjectLocator {
+      #ifdef KF_PTR_UNCHECKED
+      ManagedObject* object;
+      #endif
       kf_int32_t objectIndex;
-      kf_int16_t key;
+      kf_objectkey_t key;
       kf_int8_t managerIndex;
       bool autorelease: 1;
       bool trace: 1;
@@ -86,9 +136,18 @@ namespace kfoundation {
   // --- STATIC FIELDS --- //
     
     protected: static MasterMemoryManager* master;
-    protected: static ObjectRecord** objectTable;
+    protected: static ObjectRecord*** objectTable;
     protected: static long int serial;
     
+    
+  // --- STATIC METHODS --- //
+    
+    protected: static inline ObjectRecord* getRecord(
+        const kf_int8_t managerIndex, const kf_int32_t objectIndex);
+    
+    protected: static inline ObjectRecordInfo* getRecordInfo(
+        const kf_int8_t managerIndex, const kf_int32_t objectIndex);
+    
   
   // --- FIELDS --- //
     
@@ -96,6 +155,22 @@ namespace kfoundation {
     
   };
   
+  
+//\/ PtrVisitor /\/////////////////////////////////////////////////////////////
+  
+  /**
+   * Receives the managed pointers held by an object, when the object is
+   * traversed. See ManagedObject::traverse().
+   *
+   * @ingroup memory
+   * @headerfile PtrDecl.h <kfoundation/PtrDecl.h>
+   */
+  
+  class PtrVisitor {
+    public: virtual ~PtrVisitor();
+    public: virtual void visit(PtrBase& ptr) = 0;
+  };
+  
 
 //\/ Ptr /\////////////////////////////////////////////////////////////////////
   
@@ -158,14 +233,20 @@ namespace kfoundation {
    * defined. If you are sure within a cerain scope the retain count of an
    * object will not be changed, it is advisable to use PPtr to produce a 
    * faster program. SPtr makes the pointed object immortal. It should be used
-   * for static class members.
+   * for static class members. A weak pointer (WPtr) can be kept across
+   * scopes without keeping the object alive, and converted back to `Ptr`
+   * while the object exists.
    *
    * KFoundation managed pointers are designed to be fast and efficient.
-   * The size of `Ptr` is exactly 8 bytes --- the same as normal pointers on
-   * most platforms. To make it safe, the validity of the pointer is checked
+   * On 64-bit platforms, `Ptr` takes 16 bytes: a vtable pointer and an
+   * 8-byte locator. To make it safe, the validity of the pointer is checked
    * against the memory manager's registery on each access. To make it fast,
    * a novel fast algorithm with O(1) time complexity is developed to do the
    * task.
+   * In release builds where this check is not needed, it can be turned off by
+   * defining KF_PTR_UNCHECKED, which caches the object address in the
+   * locator and makes `Ptr` 24 bytes. Defining KF_WIDE_OBJECT_RECORD widens
+   * the key, which also makes it 24 bytes.
    *
    * On rare ocasions it might be needed to manage the reference count manually.
    * In such cases you may use retain(), release() and replace() methods.
@@ -192,7 +273,12 @@ namespace kfoundation {
     public: inline Ptr();
     public: Ptr(T* obj, bool trace = false);
     public: Ptr(const kf_int8_t managerIndex, const kf_int32_t objectIndex);
-    public: inline Ptr(const Ptr<T>& other);    
+    public: inline Ptr(const Ptr<T>& other);
+    
+    #ifdef KF_RVALUE_REFERENCES
+    public: inline Ptr(Ptr<T>&& other);
+    #endif
+    
     public: virtual ~Ptr();
 
     
@@ -221,6 +307,11 @@ namespace kfoundation {
     public: T* toPurePtr() const;
     public: inline T* operator->() const;
     public: inline Ptr<T>& operator=(const Ptr<T>& other);
+    
+    #ifdef KF_RVALUE_REFERENCES
+    public: inline Ptr<T>& operator=(Ptr<T>&& other);
+    #endif
+    
     public: inline Ptr<T>& operator=(T* const& obj);
     public: bool operator==(const Ptr<T>& other) const;
     public: bool operator==(const T* ptr) const;
@@ -258,6 +349,7 @@ namespace kfoundation {
   
   template<typename T>
   class SPtr : public Ptr<T> {
+    private: void makeStatic();
     public: SPtr();
     public: SPtr(T* obj);
     public: SPtr(const Ptr<T>& obj);
@@ -287,6 +379,54 @@ namespace kfoundation {
     public: PPtr(T* const obj);
   };
   
+  
+//\/ WPtr /\///////////////////////////////////////////////////////////////////
+  
+  /**
+   * Weak pointer, refers to an object without retaining it. Unlike PPtr, a
+   * WPtr remains safe to keep after the object is deleted, and after its
+   * record in the memory manager is reused by another object. The object
+   * cannot be accessed through a WPtr directly. Instead, toPtr() checks if
+   * the object still exists, and if so, retains it and returns a Ptr to it,
+   * otherwise a NULL pointer.
+   *
+   *     WPtr<MyClass> observer = myObject;
+   *     // ...
+   *     Ptr<MyClass> p = observer.toPtr();
+   *     if(!p.isNull()) {
+   *       p->notify();
+   *     }
+   *
+   * This is useful for caches and lists of observers, which should not keep
+   * the objects they refer to alive. Storing or copying a WPtr does not
+   * access the memory manager.
+   *
+   * @ingroup memory
+   * @headerfile Ptr.h <kfoundation/Ptr.h>
+   */
+  
+  template<typename T>
+  class WPtr : public PtrBase {
+    
+  // --- (DE)CONSTRUCTORS --- //
+    
+    public: WPtr();
+    public: WPtr(const Ptr<T>& ptr);
+    
+    
+  // --- METHODS --- //
+    
+    public: WPtr<T>& operator=(const Ptr<T>& ptr);
+    public: Ptr<T> toPtr() const;
+    public: inline bool isNull() const;
+    public: bool isValid() const;
+    public: inline bool operator==(const WPtr<T>& other) const;
+    public: inline bool operator==(const Ptr<T>& ptr) const;
+    public: inline bool operator!=(const WPtr<T>& other) const;
+    public: inline bool operator!=(const Ptr<T>& ptr) const;
+    
+  };
+  
 } // namespace kfoundation
 
 
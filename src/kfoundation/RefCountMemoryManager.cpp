@@ -16,11 +16,15 @@
 
 // std
 #include <cstdlib>
+#include <cstddef>
 #include <cassert>
+#include <map>
+#include <set>
 
 // Internal
 #include "Int.h"
 #include "InvalidPointerException.h"
+#include "OutOfMemoryException.h"
 #include "MasterMemoryManager.h"
 #include "Logger.h"
 #include "ObjectSerializer.h"
@@ -31,6 +35,23 @@
 
 namespace kfoundation {
   
+//\/ Internal /\///////////////////////////////////////////////////////////////
+  
+  /**
+   * Collects the pointers reported by ManagedObject::traverse().
+   */
+  
+  class __k_PtrCollector : public PtrVisitor {
+    public: vector<PtrBase*> ptrs;
+    
+    public: void visit(PtrBase& ptr) {
+      ptrs.push_back(&ptr);
+    }
+  };
+  
+  
+//\/ RefCountMemoryManager /\////////////////////////////////////////////////
+  
 // --- STATIC FIELDS --- //
   
   const int RefCountMemoryManager::INITIAL_SIZE = 64;
@@ -42,21 +63,30 @@ namespace kfoundation {
   
   /**
    * Constructor.
+   *
+   * @param master The master manager to register this manager with.
+   * @param isLockFree If `true`, retain() and release() will be performed
+   *                   using atomic operations instead of the mutex.
    */
   
-  RefCountMemoryManager::RefCountMemoryManager(MasterMemoryManager* master) {
+  RefCountMemoryManager::RefCountMemoryManager(MasterMemoryManager* master,
+      bool isLockFree)
+  {
     pthread_mutexattr_init(&_attribs);
     pthread_mutexattr_setpshared(&_attribs, PTHREAD_PROCESS_SHARED);
     pthread_mutex_init(&_mutex, &_attribs);
     _size  = INITIAL_SIZE;
     _count = 0;
-    _next  = 0;
+    _freeHead = -1;
     _counter = 0;
+    _nStatics = 0;
+    _peakCount = 0;
+    _nGrowths = 0;
+    _isLockFree = isLockFree;
+    _collectCycles = false;
     
-    _table = new ObjectRecord[_size];
-    for(int i = 0; i < _size; i++) {
-      _table[i].ptr = 0;
-    }
+    _table.reserve(_size);
+    linkFreeRecords(0, _size);
     
     _id    = master->registerManager(this);
     _master = master;
@@ -79,30 +109,68 @@ namespace kfoundation {
         << " are static." << EL;
     
     _master->unregisterManager(_id);
-    delete[] _table;
   }
   
   
 // --- METHODS --- //
   
+  /**
+   * Extends the table by appending new pages. Existing records are neither
+   * copied nor moved, thus concurrent readers are not affected. Should be
+   * called while holding the mutex.
+   *
+   * @throw OutOfMemoryException if the table has reached
+   *        KF_OBJECT_TABLE_MAX_SIZE.
+   */
+  
   void RefCountMemoryManager::grow() {
     int newSize = _size * GROWTH_RATE;
-    ObjectRecord* newTable = new ObjectRecord[newSize];
-    memset(newTable, 0, sizeof(ObjectRecord) * newSize);
-    memcpy((void*)newTable, (void*)_table, sizeof(ObjectRecord) * _size);
-    delete[] _table;
+    if(newSize > KF_OBJECT_TABLE_MAX_SIZE) {
+      newSize = KF_OBJECT_TABLE_MAX_SIZE;
+    }
+    
+    if(newSize == _size) {
+      // Int::toString() is used since constructing an Int would register a
+      // new object while the mutex is held.
+      throw OutOfMemoryException("RefCountMemoryManager "
+          + Int::toString(_id) + " cannot hold more than "
+          + Int::toString(_size) + " objects.");
+    }
+    
+    _table.reserve(newSize);
     
     LOG << "RefCountMemoryManager " << _id << " resized from " << _size
         << " to " << newSize << EL;
     
+    linkFreeRecords(_size, newSize);
     _size = newSize;
-    _table = newTable;
-    _master->updataTable(_id);
+    _nGrowths++;
+  }
+  
+  
+  /**
+   * Pushes the records in the given range to the free list. The records should
+   * be unused. Should be called while holding the mutex.
+   *
+   * @param begin The index of the first record.
+   * @param end The index after the last record.
+   */
+  
+  void RefCountMemoryManager::linkFreeRecords(int begin, int end) {
+    for(int i = begin; i < end - 1; i++) {
+      _table.infoAt(i).nextFree = i + 1;
+    }
+    
+    if(begin < end) {
+      _table.infoAt(end - 1).nextFree = _freeHead;
+      _freeHead = begin;
+    }
   }
   
   
   string RefCountMemoryManager::toString(int index) {
-    const ObjectRecord& rec = _table[index];
+    const ObjectRecord& rec = _table.at(index);
+    const ObjectRecordInfo& info = _table.infoAt(index);
     string typeName = "(deleted)";
     if(rec.ptr != NULL) {
       typeName = System::demangle(typeid(*rec.ptr).name());
@@ -111,78 +179,127 @@ namespace kfoundation {
     char buffer[400];
     sprintf(buffer, "[manager: %d, index: %d, type: %s, "
                     "retainCount: %d, isStatic: %d, key: %d, serial: %d]",
-            rec.manager, rec.index, typeName.c_str(), rec.retainCount,
-            rec.isStatic, rec.key, rec.serialNumber);
+            info.manager, info.index, typeName.c_str(), rec.retainCount,
+            info.isStatic, rec.key, info.serialNumber);
     return string(buffer);
   }
   
   
-  const ObjectRecord& RefCountMemoryManager::registerObject(ManagedObject* obj)
-  {
+  const ObjectRecordInfo&
+  RefCountMemoryManager::registerObject(ManagedObject* obj) {
     if(_isClosed) {
       throw MemoryException("Cannot register new object to a closed manager");
     }
     
     pthread_mutex_lock(&_mutex);
     
-    int index = _next;
-    
-    ObjectRecord& record = _table[index];
-    record.retainCount = 1;
-    record.index = index;
-    record.serialNumber = _counter;
-    record.ptr = obj;
-    record.key = rand() % 65530 - 32760;
-    record.manager = _id;
-    record.isStatic = false;
-    record.isBeingDeleted = false;
-
-    _count++;
+    if(_freeHead == -1) {
+      try {
+        grow();
+      } catch(KFException& e) {
+        pthread_mutex_unlock(&_mutex);
+        throw;
+      }
+    }
+    
+    int index = _freeHead;
     
-    if(_count == _size) {
-      grow();
-      record = _table[index];
+    ObjectRecord* record = &_table.at(index);
+    ObjectRecordInfo* info = &_table.infoAt(index);
+    _freeHead = info->nextFree;
+    
+    record->retainCount = 1;
+    info->index = index;
+    info->serialNumber = (kf_int32_t)_counter;
+    record->ptr = obj;
+    info->manager = _id;
+    
+    // The key of a static record is left unchanged by remove(), thus it has
+    // to be advanced before the record is reused.
+    if(info->isStatic) {
+      record->key = nextKey(record->key);
+      info->isStatic = false;
     }
     
-    while(_table[_next].ptr) {
-      _next++;
-      if(_next == _size) {
-        _next = 0;
-      }
+    info->isBeingDeleted = false;
+    info->isBuffered = false;
+
+    _counter++;
+    _count++;
+    if(_count > _peakCount) {
+      _peakCount = _count;
     }
 
     pthread_mutex_unlock(&_mutex);
     
     if(_trace) {
-      LOG << "Registered: " << toString(_next) << " Next: " << _next
+      LOG << "Registered: " << toString(index) << " Next: " << _freeHead
           << EL;
     }
     
-    return record;
+    return *info;
   }
   
   
-  void RefCountMemoryManager::retain(kf_int32_t index, kf_int16_t key) {
+  void RefCountMemoryManager::retain(kf_int32_t index, kf_objectkey_t key) {
+    if(_isLockFree) {
+      retainLockFree(index, key);
+      return;
+    }
+    
     pthread_mutex_lock(&_mutex);
-    ObjectRecord& record = _table[index];
+    ObjectRecord& record = _table.at(index);
     if(record.key != key) {
       pthread_mutex_unlock(&_mutex);
       untrace();
       throw InvalidPointerException("The pointer being retained is invalid: "
                                     + Int(_id) + ":" + Int(index));
     }
-    if(!record.isStatic) {
+    if(!_table.isStatic(index)) {
       record.retainCount++;
     }
     pthread_mutex_unlock(&_mutex);
     
     if(_trace) {
-      LOG << "Retained: " << toString(record.index) << EL;
+      LOG << "Retained: " << toString(index) << EL;
+    }
+  }
+  
+  
+  bool RefCountMemoryManager::tryRetain(kf_int32_t index, kf_objectkey_t key)
+  {
+    if(_isLockFree) {
+      return tryRetainLockFree(index, key);
     }
+    
+    bool isRetained = false;
+    
+    pthread_mutex_lock(&_mutex);
+    ObjectRecord& record = _table.at(index);
+    if(record.key == key && record.ptr != NULL
+        && !_table.infoAt(index).isBeingDeleted)
+    {
+      if(!_table.isStatic(index)) {
+        record.retainCount++;
+      }
+      isRetained = true;
+    }
+    pthread_mutex_unlock(&_mutex);
+    
+    if(_trace && isRetained) {
+      LOG << "Retained: " << toString(index) << EL;
+    }
+    
+    return isRetained;
   }
   
   
-  void RefCountMemoryManager::release(kf_int32_t index, kf_int16_t key) {
+  void RefCountMemoryManager::release(kf_int32_t index, kf_objectkey_t key) {
+    if(_isLockFree) {
+      releaseLockFree(index, key);
+      return;
+    }
+    
     bool doDelete = false;
     
     #ifdef DEBUG
@@ -194,8 +311,7 @@ namespace kfoundation {
     
     // synchronized {
     pthread_mutex_lock(&_mutex);
-    ObjectRecord* tbl = _table;
-    ObjectRecord* record = _table +index;
+    ObjectRecord* record = &_table.at(index);
     
     if(record->key != key) {
       pthread_mutex_unlock(&_mutex);
@@ -204,18 +320,21 @@ namespace kfoundation {
                                     + Int(_id) + ":" + Int(index));
     }
     
-    if(!record->isStatic) {
+    if(!_table.isStatic(index)) {
       record->retainCount--;
-      if(record->retainCount == 0 && !record->isBeingDeleted) {
+      ObjectRecordInfo& info = _table.infoAt(index);
+      if(record->retainCount == 0 && !info.isBeingDeleted) {
         doDelete = true;
-        record->isBeingDeleted = true;
+        info.isBeingDeleted = true;
       } else if(record->retainCount < 0) {
         pthread_mutex_unlock(&_mutex);
         throw InvalidPointerException("Object is released too many times: "
                                       + Int(_id) + ":" + Int(index));
+      } else if(_collectCycles && !info.isBuffered && !info.isBeingDeleted) {
+        info.isBuffered = true;
+        _candidates.push_back(index);
       }
     }
-    assert(tbl == _table);
     pthread_mutex_unlock(&_mutex);
     // } synchronized
     
@@ -225,41 +344,561 @@ namespace kfoundation {
     }
     #endif
     
+    // The record is cleared and put back to the free list by remove(), which
+    // is called by the deconstructor.
+    if(doDelete) {
+      delete record->ptr;
+    }
+  }
+  
+  
+  /**
+   * Releases a number of objects while holding the mutex only once. Objects
+   * whose retain count reaches zero are deleted after the mutex is released.
+   * In lock-free mode, each object is released individually. If any of the
+   * pointers is invalid, the rest of the batch is still released before
+   * InvalidPointerException is thrown.
+   */
+  
+  void RefCountMemoryManager::releaseBatch(const kf_int32_t* indexes,
+      const kf_objectkey_t* keys, const kf_int32_t n)
+  {
+    if(_isLockFree) {
+      MemoryManager::releaseBatch(indexes, keys, n);
+      return;
+    }
+    
+    ManagedObject** doomed = new ManagedObject*[n];
+    kf_int32_t nDoomed = 0;
+    kf_int32_t invalidIndex = -1;
+    
+    // synchronized {
+    pthread_mutex_lock(&_mutex);
+    for(kf_int32_t i = 0; i < n; i++) {
+      ObjectRecord* record = &_table.at(indexes[i]);
+      
+      if(record->key != keys[i] || _table.isStatic(indexes[i])) {
+        if(record->key != keys[i] && invalidIndex == -1) {
+          invalidIndex = indexes[i];
+        }
+        continue;
+      }
+      
+      record->retainCount--;
+      ObjectRecordInfo& info = _table.infoAt(indexes[i]);
+      if(record->retainCount == 0 && !info.isBeingDeleted) {
+        info.isBeingDeleted = true;
+        doomed[nDoomed++] = record->ptr;
+      } else if(record->retainCount < 0 && invalidIndex == -1) {
+        invalidIndex = indexes[i];
+      } else if(_collectCycles && !info.isBuffered && !info.isBeingDeleted) {
+        info.isBuffered = true;
+        _candidates.push_back(indexes[i]);
+      }
+    }
+    pthread_mutex_unlock(&_mutex);
+    // } synchronized
+    
+    if(_trace) {
+      LOG << "Released " << n << " objects, deleting " << nDoomed << EL;
+    }
+    
+    for(kf_int32_t i = 0; i < nDoomed; i++) {
+      delete doomed[i];
+    }
+    delete[] doomed;
+    
+    if(invalidIndex != -1) {
+      throw InvalidPointerException("The pointer being released is invalid: "
+                                    + Int(_id) + ":" + Int(invalidIndex));
+    }
+  }
+  
+  
+  void RefCountMemoryManager::retainLockFree(kf_int32_t index, kf_objectkey_t key)
+  {
+    ObjectRecord* record = &_table.at(index);
+    
+    while(true) {
+      __k_RecordState state = __k_loadState(*record);
+      
+      if(state.fields.key != key) {
+        untrace();
+        throw InvalidPointerException("The pointer being retained is invalid: "
+                                      + Int(_id) + ":" + Int(index));
+      }
+      
+      if(_table.isStatic(index)) {
+        break;
+      }
+      
+      if(state.fields.retainCount <= 0) {
+        throw InvalidPointerException("The pointer being retained is being "
+            "deleted: " + Int(_id) + ":" + Int(index));
+      }
+      
+      __k_RecordState newState = state;
+      newState.fields.retainCount++;
+      if(__k_swapState(*record, state, newState)) {
+        break;
+      }
+    }
+    
+    if(_trace) {
+      LOG << "Retained: " << toString(index) << EL;
+    }
+  }
+  
+  
+  bool RefCountMemoryManager::tryRetainLockFree(kf_int32_t index,
+      kf_objectkey_t key)
+  {
+    ObjectRecord* record = &_table.at(index);
+    
+    while(true) {
+      __k_RecordState state = __k_loadState(*record);
+      
+      if(state.fields.key != key) {
+        return false;
+      }
+      
+      if(_table.isStatic(index)) {
+        break;
+      }
+      
+      if(state.fields.retainCount <= 0) {
+        return false;
+      }
+      
+      __k_RecordState newState = state;
+      newState.fields.retainCount++;
+      if(__k_swapState(*record, state, newState)) {
+        break;
+      }
+    }
+    
+    if(_trace) {
+      LOG << "Retained: " << toString(index) << EL;
+    }
+    
+    return true;
+  }
+  
+  
+  void RefCountMemoryManager::releaseLockFree(kf_int32_t index, kf_objectkey_t key)
+  {
+    ObjectRecord* record = &_table.at(index);
+    bool doDelete = false;
+    
+    while(true) {
+      __k_RecordState state = __k_loadState(*record);
+      
+      if(state.fields.key != key) {
+        untrace();
+        throw InvalidPointerException("The pointer being released is invalid: "
+                                      + Int(_id) + ":" + Int(index));
+      }
+      
+      if(_table.isStatic(index)) {
+        break;
+      }
+      
+      if(state.fields.retainCount <= 0) {
+        throw InvalidPointerException("Object is released too many times: "
+                                      + Int(_id) + ":" + Int(index));
+      }
+      
+      __k_RecordState newState = state;
+      newState.fields.retainCount--;
+      if(__k_swapState(*record, state, newState)) {
+        doDelete = newState.fields.retainCount == 0;
+        break;
+      }
+    }
+    
+    #ifdef DEBUG
+    if(_trace) {
+      LOG << "Released: " << toString(index) << EL;
+    }
+    #endif
+    
+    // Only the thread that brought the count to zero gets here, and the
+    // record's ptr is never modified before remove() is called by the
+    // deconstructor.
     if(doDelete) {
+      _table.infoAt(index).isBeingDeleted = true;
       delete record->ptr;
-      record->ptr = NULL;
     }
   }
   
   
-  void RefCountMemoryManager::remove(kf_int32_t index, kf_int16_t key) {
-    ObjectRecord& record = _table[index];
+  void RefCountMemoryManager::remove(kf_int32_t index, kf_objectkey_t key) {
+    if(_isLockFree) {
+      pthread_mutex_lock(&_mutex);
+      
+      ObjectRecord& record = _table.at(index);
+      ObjectRecordInfo& info = _table.infoAt(index);
+      __k_RecordState state = __k_loadState(record);
+      if(state.fields.key != key) {
+        pthread_mutex_unlock(&_mutex);
+        throw InvalidPointerException("The pointer being removed is invalid: "
+            + Int(_id) + ":" + Int(index));
+      }
+      
+      bool wasUsed = record.ptr != NULL;
+      record.ptr = NULL;
+      
+      __k_RecordState newState;
+      do {
+        state = __k_loadState(record);
+        newState = state;
+        newState.fields.retainCount = 0;
+        if(!info.isStatic) {
+          newState.fields.key = nextKey(state.fields.key);
+        }
+      } while(!__k_swapState(record, state, newState));
+      
+      if(wasUsed) {
+        info.nextFree = _freeHead;
+        _freeHead = index;
+        _count--;
+        if(info.isStatic) {
+          _nStatics--;
+        }
+      }
+      
+      pthread_mutex_unlock(&_mutex);
+      
+      if(_trace) {
+        LOG << "Removed: " << toString(index) << EL;
+      }
+      
+      return;
+    }
+    
+    pthread_mutex_lock(&_mutex);
+    
+    ObjectRecord& record = _table.at(index);
+    ObjectRecordInfo& info = _table.infoAt(index);
     if(record.key != key) {
+      pthread_mutex_unlock(&_mutex);
       throw InvalidPointerException("The pointer being removed is invalid: "
           + Int(_id) + ":" + Int(index));
     }
     
     if(record.ptr != NULL) {
-      pthread_mutex_lock(&_mutex);
       record.ptr = NULL;
       record.retainCount = 0;
+      info.nextFree = _freeHead;
+      _freeHead = index;
+      _count--;
+      if(info.isStatic) {
+        _nStatics--;
+      }
+    }
+    
+    if(!info.isStatic) {
+      record.key = nextKey(record.key);
+    }
+    
+    pthread_mutex_unlock(&_mutex);
+    
+    if(_trace) {
+      LOG << "Removed: " << toString(index) << EL;
+    }
+  }
+  
+  
+  void RefCountMemoryManager::setStatic(kf_int32_t index, kf_objectkey_t key)
+  {
+    pthread_mutex_lock(&_mutex);
+    
+    ObjectRecord& record = _table.at(index);
+    ObjectRecordInfo& info = _table.infoAt(index);
+    
+    // The retain count is swapped, rather than assigned, since it may be
+    // concurrently updated by lock-free retain() and release().
+    __k_RecordState state;
+    __k_RecordState newState;
+    do {
+      state = __k_loadState(record);
+      if(state.fields.key != key) {
+        pthread_mutex_unlock(&_mutex);
+        throw InvalidPointerException("The pointer being made static is "
+            "invalid: " + Int(_id) + ":" + Int(index));
+      }
+      newState = state;
+      newState.fields.retainCount = -10;
+    } while(!__k_swapState(record, state, newState));
+    
+    if(!info.isStatic) {
+      info.isStatic = true;
+      _nStatics++;
+    }
+    
+    pthread_mutex_unlock(&_mutex);
+  }
+  
+  
+  /**
+   * Checks if this manager performs retain and release without locking.
+   */
+  
+  bool RefCountMemoryManager::isLockFree() const {
+    return _isLockFree;
+  }
+  
+  
+  /**
+   * Enables or disables cycle collection. Has no effect in lock-free mode.
+   * Disabling it discards the buffered objects.
+   *
+   * @param value If `true`, objects whose retain count is decreased without
+   *              reaching zero will be buffered for collectCycles().
+   */
+  
+  void RefCountMemoryManager::setCollectCycles(bool value) {
+    if(_isLockFree) {
+      return;
+    }
+    
+    pthread_mutex_lock(&_mutex);
+    _collectCycles = value;
+    if(!value) {
+      for(size_t i = 0; i < _candidates.size(); i++) {
+        _table.infoAt(_candidates[i]).isBuffered = false;
+      }
+      _candidates.clear();
+    }
+    pthread_mutex_unlock(&_mutex);
+  }
+  
+  
+  /**
+   * Checks if cycle collection is enabled.
+   */
+  
+  bool RefCountMemoryManager::isCollectingCycles() const {
+    return _collectCycles;
+  }
+  
+  
+  /**
+   * Finds the objects reachable from the given root, and determines by trial
+   * deletion which of them are only referenced by each other. Each object is
+   * given a trial count equal to its retain count, minus the number of
+   * pointers to it held by the objects found. Those with a positive trial
+   * count are referenced from elsewhere, and are alive along with all
+   * objects reachable from them. The rest are garbage; they are marked as
+   * being deleted and appended to `garbage`. Only objects of this manager
+   * are followed. Should be called while holding the mutex.
+   *
+   * @param root Index of the object to start from.
+   * @param maxObjects Maximum number of objects to examine.
+   * @param garbage Output, indexes of the garbage objects.
+   * @return The number of objects examined, or -1 if there were more than
+   *         `maxObjects`, in which case nothing is marked as garbage.
+   */
+  
+  kf_int32_t RefCountMemoryManager::scanCycles(const kf_int32_t root,
+      const kf_int32_t maxObjects, vector<kf_int32_t>& garbage)
+  {
+    map<kf_int32_t, kf_int32_t> positions;
+    vector<kf_int32_t> nodes;
+    vector<kf_int32_t> firstEdges;
+    vector<kf_int32_t> edges;
+    __k_PtrCollector collector;
+    
+    nodes.push_back(root);
+    positions[root] = 0;
+    
+    for(size_t i = 0; i < nodes.size(); i++) {
+      if((kf_int32_t)nodes.size() > maxObjects) {
+        return -1;
+      }
+      
+      firstEdges.push_back((kf_int32_t)edges.size());
+      collector.ptrs.clear();
+      _table.at(nodes[i]).ptr->traverse(collector);
+      
+      for(size_t j = 0; j < collector.ptrs.size(); j++) {
+        const PtrBase::ObjectLocator& l = collector.ptrs[j]->_locator;
+        if(!l.autorelease || l.managerIndex != _id || l.objectIndex < 0
+            || l.objectIndex >= _size)
+        {
+          continue;
+        }
+        
+        const ObjectRecord& record = _table.at(l.objectIndex);
+        if(record.ptr == NULL || record.key != l.key
+            || _table.isStatic(l.objectIndex)
+            || _table.infoAt(l.objectIndex).isBeingDeleted)
+        {
+          continue;
+        }
+        
+        map<kf_int32_t, kf_int32_t>::iterator it
+            = positions.find(l.objectIndex);
+        
+        if(it == positions.end()) {
+          it = positions.insert(std::make_pair(l.objectIndex,
+              (kf_int32_t)nodes.size())).first;
+          nodes.push_back(l.objectIndex);
+        }
+        
+        edges.push_back(it->second);
+      }
+    }
+    firstEdges.push_back((kf_int32_t)edges.size());
+    
+    const kf_int32_t n = (kf_int32_t)nodes.size();
+    
+    vector<kf_int32_t> trialCounts(n);
+    for(kf_int32_t i = 0; i < n; i++) {
+      trialCounts[i] = _table.at(nodes[i]).retainCount;
+    }
+    for(size_t e = 0; e < edges.size(); e++) {
+      trialCounts[edges[e]]--;
+    }
+    
+    vector<bool> isAlive(n, false);
+    vector<kf_int32_t> stack;
+    for(kf_int32_t i = 0; i < n; i++) {
+      if(trialCounts[i] <= 0 || isAlive[i]) {
+        continue;
+      }
+      
+      isAlive[i] = true;
+      stack.push_back(i);
+      while(!stack.empty()) {
+        kf_int32_t j = stack.back();
+        stack.pop_back();
+        for(kf_int32_t e = firstEdges[j]; e < firstEdges[j + 1]; e++) {
+          if(!isAlive[edges[e]]) {
+            isAlive[edges[e]] = true;
+            stack.push_back(edges[e]);
+          }
+        }
+      }
+    }
+    
+    for(kf_int32_t i = 0; i < n; i++) {
+      if(!isAlive[i]) {
+        _table.infoAt(nodes[i]).isBeingDeleted = true;
+        garbage.push_back(nodes[i]);
+      }
+    }
+    
+    return n;
+  }
+  
+  
+  /**
+   * Deletes garbage cycles found among the objects buffered since the last
+   * call. The mutex is held while examining the objects, but not while
+   * deleting the garbage, so the time other threads wait to register or
+   * release objects is bounded by `maxObjects`. Objects not examined in this
+   * call remain buffered for the next. A buffered object from which more
+   * than `maxObjects` objects are reachable is dropped from the buffer.
+   *
+   * Other threads may keep assigning the traversed Ptr fields meanwhile.
+   * The fields are read without the mutex, but every Ptr stored in a field
+   * is retained before it is stored and released after it is cleared, and
+   * neither can happen while the mutex is held. A field may thus be seen
+   * empty by the scan, which only keeps its target alive, but never holds
+   * a reference that is not counted. Ptr moves would skip the retain, so
+   * they are performed as a retain and a release while collection is
+   * enabled (see MasterMemoryManager::setCollectCycles()).
+   *
+   * Garbage objects are deleted on the calling thread. Before deleting them,
+   * the pointers between them are set to NULL, so their deconstructors
+   * should not dereference pointers to other objects in the same cycle.
+   *
+   * @param maxObjects Maximum number of objects to examine.
+   * @return The number of objects deleted.
+   */
+  
+  kf_int32_t RefCountMemoryManager::collectCycles(const kf_int32_t maxObjects)
+  {
+    if(!_collectCycles) {
+      return 0;
+    }
+    
+    vector<kf_int32_t> garbage;
+    kf_int32_t budget = maxObjects;
+    
+    // synchronized {
+    pthread_mutex_lock(&_mutex);
+    try {
+      while(_collectCycles && !_candidates.empty() && budget > 0) {
+        kf_int32_t root = _candidates.back();
+        ObjectRecordInfo& info = _table.infoAt(root);
+        
+        if(!info.isBuffered || info.isBeingDeleted
+            || _table.at(root).ptr == NULL || _table.isStatic(root))
+        {
+          info.isBuffered = false;
+          _candidates.pop_back();
+          continue;
+        }
+        
+        kf_int32_t n = scanCycles(root, budget, garbage);
+        if(n == -1 && budget < maxObjects) {
+          break;
+        }
+        
+        info.isBuffered = false;
+        _candidates.pop_back();
+        budget -= n == -1 ? budget : n;
+      }
+    } catch(...) {
       pthread_mutex_unlock(&_mutex);
+      throw;
+    }
+    pthread_mutex_unlock(&_mutex);
+    // } synchronized
+    
+    if(garbage.empty()) {
+      return 0;
     }
     
-    _count--;
+    set<kf_int32_t> isGarbage(garbage.begin(), garbage.end());
+    __k_PtrCollector collector;
+    
+    // Releases the pointers between garbage objects. Their retain counts
+    // drop to zero, but they are not deleted, as they are marked as being
+    // deleted.
+    for(size_t i = 0; i < garbage.size(); i++) {
+      collector.ptrs.clear();
+      _table.at(garbage[i]).ptr->traverse(collector);
+      for(size_t j = 0; j < collector.ptrs.size(); j++) {
+        PtrBase::ObjectLocator& l = collector.ptrs[j]->_locator;
+        if(l.autorelease && l.managerIndex == _id && l.objectIndex != -1
+            && isGarbage.count(l.objectIndex) > 0
+            && _table.at(l.objectIndex).key == l.key)
+        {
+          kf_int32_t index = l.objectIndex;
+          l.objectIndex = -1;
+          release(index, l.key);
+        }
+      }
+    }
     
-    if(!record.isStatic) {
-      record.key = rand() % 65530 - 32760;
+    for(size_t i = 0; i < garbage.size(); i++) {
+      delete _table.at(garbage[i]).ptr;
     }
     
     if(_trace) {
-      LOG << "Removed: " << toString(record.index) << EL;
+      LOG << "RefCountMemoryManager " << _id << " collected "
+          << (kf_int32_t)garbage.size() << " objects in cycles" << EL;
     }
+    
+    return (kf_int32_t)garbage.size();
   }
   
   
-  ObjectRecord* RefCountMemoryManager::getTable() {
-    return _table;
+  ObjectRecord** RefCountMemoryManager::getTable() {
+    return _table.getPages();
   }
   
   
@@ -280,23 +919,22 @@ namespace kfoundation {
   
   Statistics RefCountMemoryManager::getStats() const {
     Statistics stats;
-    stats.nObjects = 0;
-    stats.nStaticObjects = 0;
-    for(int i = 0; i < _size; i++) {
-      if(_table[i].ptr != NULL) {
-        if(_table[i].isStatic) {
-          stats.nStaticObjects++;
-        }
-        stats.nObjects++;
-      }
-    }
+    stats.nObjects = _count;
+    stats.nStaticObjects = _nStatics;
+    stats.peakObjects = _peakCount;
+    stats.tableSize = _size;
+    stats.nGrowths = _nGrowths;
+    stats.nAllocations = _counter;
+    stats.nReleases = _counter - _count;
     return stats;
   }
   
   
-  kf_int16_t RefCountMemoryManager::update(kf_int16_t index, kf_int16_t key) {
+  kf_int32_t RefCountMemoryManager::update(kf_int32_t index,
+      kf_objectkey_t key)
+  {
     for(int i = 0; i < _size; i++) {
-      if(_table[i].index == index && _table[i].key == key) {
+      if(_table.infoAt(i).index == index && _table.at(i).key == key) {
         return i;
       }
     }
@@ -305,23 +943,12 @@ namespace kfoundation {
   
   
   int RefCountMemoryManager::migrate(MasterMemoryManager& master) {
-    int size = 0;
-    for(int i = 0; i < _size; i++) {
-      if(_table[i].ptr != NULL) {
-        size = i + 1;
-      }
-    }
-    
     _id = master.registerManager(this);
     
-    ObjectRecord* newTable = new ObjectRecord[size];
-    for(int i = 0; i < size; i++) {
-      newTable[i] = _table[i];
-      newTable[i].manager = _id;
+    for(int i = 0; i < _size; i++) {
+      _table.infoAt(i).manager = _id;
     }
     
-    _size = size;
-    _table = newTable;
     _master = &master;
     _master->updataTable(_id);
     
@@ -331,8 +958,8 @@ namespace kfoundation {
   
   void RefCountMemoryManager::finalize() {
     for(int i = 0; i < _size; i++) {
-      ObjectRecord& record = _table[i];
-      if(record.ptr != NULL && record.isStatic) {
+      ObjectRecord& record = _table.at(i);
+      if(record.ptr != NULL && _table.infoAt(i).isStatic) {
         delete record.ptr;
         record.ptr = NULL;
         record.retainCount = 0;
@@ -354,13 +981,13 @@ namespace kfoundation {
     int c = _size;
     
     for(int i = 0; i < c; i++) {
-      const ObjectRecord& rec = _table[i];
+      const ObjectRecord& rec = _table.at(i);
       if(rec.ptr != NULL) {
         seralizer->member("[" + Int(i) + "]")->object("ObjectRecord")
                  ->attribute("type", System::demangle(typeid(*rec.ptr).name()))
                  ->attribute("retainCount", rec.retainCount)
-                 ->attribute("isStatic", rec.isStatic)
-                 ->attribute("index", rec.index)
+                 ->attribute("isStatic", _table.infoAt(i).isStatic)
+                 ->attribute("index", _table.infoAt(i).index)
                  ->attribute("key", rec.key)
                  ->endObject();
       }
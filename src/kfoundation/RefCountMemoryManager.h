@@ -18,16 +18,48 @@
 #define KFOUNDATION_REFCOUNTMEMORYMANAGER
 
 #include <pthread.h>
+#include <vector>
 
 #include "MemoryManager.h"
 #include "SerializingStreamer.h"
 #include "ManagedObject.h"
+#include "ObjectTable.h"
+
+/**
+ * @def KF_LOCK_FREE_RETAIN
+ * When defined, the default manager created by MasterMemoryManager runs in
+ * lock-free mode. See RefCountMemoryManager for details.
+ * @ingroup defs
+ * @ingroup memory
+ */
 
 namespace kfoundation {
   
   /**
    * Reference counting memory manager.
    *
+   * Unused records are chained into an intrusive free list through
+   * ObjectRecordInfo::nextFree, so acquiring and releasing a slot takes
+   * constant time regardless of the size or fragmentation of the table.
+   *
+   * By default, every retain and release is performed while holding the
+   * manager's mutex. In lock-free mode, the retain count and key of each
+   * record are instead checked and updated together by a single atomic
+   * compare-and-swap, so retain() and release() never take the lock.
+   * registerObject(), remove() and grow() remain synchronized. Records are
+   * kept in an ObjectTable, which grows by appending pages, so a record never
+   * moves and concurrent retains and releases are not affected by growth.
+   *
+   * The counters reported by getStats() are updated along with the free
+   * list, and are read without taking the mutex.
+   *
+   * Objects referencing each other in a cycle keep each other alive. When
+   * cycle collection is enabled, each object whose retain count is decreased
+   * without reaching zero is buffered as a possible member of a garbage
+   * cycle, and collectCycles() examines the buffered objects by trial
+   * deletion. Cycle collection relies on ManagedObject::traverse(), and is
+   * not available in lock-free mode. See also CycleCollector.
+   *
    * @ingroup memory
    * @headerfile RefCountMemoryManager.h <kfoundation/RefCountMemoryManager.h>
    */
@@ -46,38 +78,60 @@ namespace kfoundation {
     private: int _size;
     private: int _count;
     private: int _id;
-    private: int _next;
-    private: int _counter;
+    private: int _freeHead;
+    private: kf_int64_t _counter;
+    private: int _nStatics;
+    private: int _peakCount;
+    private: int _nGrowths;
     private: pthread_mutex_t _mutex;
     private: pthread_mutexattr_t _attribs;
-    private: ObjectRecord*   _table;
+    private: ObjectTable _table;
     private: MasterMemoryManager* _master;
     private: bool _trace;
     private: bool _isClosed;
+    private: bool _isLockFree;
+    private: bool _collectCycles;
+    private: vector<kf_int32_t> _candidates;
     
   // --- (DE)CONSTRUCOTRS --- //
     
-    public: RefCountMemoryManager(MasterMemoryManager* master);
+    public: RefCountMemoryManager(MasterMemoryManager* master,
+        bool isLockFree = false);
+    
     public: ~RefCountMemoryManager();
     
     
   // --- METHODS --- //
     
     private: void grow();
+    private: void linkFreeRecords(int begin, int end);
+    private: void retainLockFree(kf_int32_t index, kf_objectkey_t key);
+    private: bool tryRetainLockFree(kf_int32_t index, kf_objectkey_t key);
+    private: void releaseLockFree(kf_int32_t index, kf_objectkey_t key);
     private: string toString(int index);
+    private: kf_int32_t scanCycles(const kf_int32_t root,
+        const kf_int32_t maxObjects, vector<kf_int32_t>& garbage);
     public: int migrate(MasterMemoryManager& other);
+    public: bool isLockFree() const;
+    public: void setCollectCycles(bool value);
+    public: bool isCollectingCycles() const;
+    public: kf_int32_t collectCycles(const kf_int32_t maxObjects);
     
     // Inherited from MemoryManager
-    public: const ObjectRecord& registerObject(ManagedObject* obj);
-    public: void retain(kf_int32_t index, kf_int16_t key);
-    public: void release(kf_int32_t index, kf_int16_t key);
-    public: void remove(kf_int32_t index, kf_int16_t key);
-    public: ObjectRecord* getTable();
+    public: const ObjectRecordInfo& registerObject(ManagedObject* obj);
+    public: void retain(kf_int32_t index, kf_objectkey_t key);
+    public: bool tryRetain(kf_int32_t index, kf_objectkey_t key);
+    public: void release(kf_int32_t index, kf_objectkey_t key);
+    public: void releaseBatch(const kf_int32_t* indexes,
+        const kf_objectkey_t* keys, const kf_int32_t n);
+    public: void remove(kf_int32_t index, kf_objectkey_t key);
+    public: void setStatic(kf_int32_t index, kf_objectkey_t key);
+    public: ObjectRecord** getTable();
     public: kf_int32_t getTableSize() const;
     public: void trace(const pthread_t threadId);
     public: void untrace();
     public: Statistics getStats() const;
-    public: kf_int16_t update(kf_int16_t index, kf_int16_t key);
+    public: kf_int32_t update(kf_int32_t index, kf_objectkey_t key);
     public: void finalize();
 
     // Inherited from Serializing Streamer
@@ -0,0 +1,194 @@
+/*---[ReleasePool.cpp]-----------------------------------------m(._.)m--------*\
+ |
+ |  Project   : KFoundation
+ |  Declares  : -
+ |  Implements: kfoundation::ReleasePool::*
+ |
+ |  Copyright (c) 2013, 2014, 2015, RIKEN (The Institute of Physical and
+ |  Chemial Research) All rights reserved.
+ |
+ |  Author: Hamed KHANDAN (hamed.khandan@port.kobe-u.ac.jp)
+ |
+ |  This file is distributed under the KnoRBA Free Public License. See
+ |  LICENSE.TXT for details.
+ |
+ *//////////////////////////////////////////////////////////////////////////////
+
+// Internal
+#include "KFException.h"
+#include "InvalidPointerException.h"
+#include "Logger.h"
+#include "MasterMemoryManager.h"
+#include "MemoryManager.h"
+#include "System.h"
+
+// Self
+#include "ReleasePool.h"
+
+namespace kfoundation {
+
+// --- STATIC FIELDS --- //
+
+  pthread_key_t ReleasePool::_currentKey;
+  pthread_once_t ReleasePool::_keyOnce = PTHREAD_ONCE_INIT;
+  volatile kf_int32_t ReleasePool::_nActive = 0;
+
+
+// --- (DE)CONSTRUCTORS --- //
+
+  /**
+   * Constructor. Makes this pool the innermost pool of the calling thread.
+   */
+
+  ReleasePool::ReleasePool() {
+    pthread_once(&_keyOnce, &ReleasePool::createKey);
+    _parent = (ReleasePool*)pthread_getspecific(_currentKey);
+    _size = 0;
+    pthread_setspecific(_currentKey, this);
+    __sync_fetch_and_add(&_nActive, 1);
+  }
+
+
+  /**
+   * Deconstructor. Reinstates the enclosing pool, if any, and applies the
+   * recorded releases. A failure to release is logged rather than thrown,
+   * since the pool is often destroyed while unwinding from another exception.
+   */
+
+  ReleasePool::~ReleasePool() {
+    pthread_setspecific(_currentKey, _parent);
+    __sync_fetch_and_sub(&_nActive, 1);
+
+    try {
+      releaseAll();
+    } catch(KFException& e) {
+      LOG_ERR << "Failed to drain ReleasePool: " << e.getMessage() << EL;
+    }
+  }
+
+
+// --- STATIC METHODS --- //
+
+  void ReleasePool::createKey() {
+    pthread_key_create(&_currentKey, NULL);
+  }
+
+
+  /**
+   * Records a release in the innermost pool of the calling thread. If the
+   * pool is full, it is drained first.
+   *
+   * @return `false` if the calling thread has no pool.
+   */
+
+  bool ReleasePool::deferToCurrent(const kf_int8_t manager,
+      const kf_int32_t index, const kf_objectkey_t key)
+  {
+    ReleasePool* pool = (ReleasePool*)pthread_getspecific(_currentKey);
+    if(pool == NULL) {
+      return false;
+    }
+
+    if(pool->_size == CAPACITY) {
+      pool->drain();
+    }
+
+    pool->_managers[pool->_size] = manager;
+    pool->_indexes[pool->_size] = index;
+    pool->_keys[pool->_size] = key;
+    pool->_size++;
+
+    return true;
+  }
+
+
+// --- METHODS --- //
+
+  /**
+   * Applies all recorded releases, with the enclosing pool as the current one.
+   * Consecutive releases on the same manager are passed to
+   * MemoryManager::releaseBatch() together. Every batch is applied even if
+   * one of them throws; the first exception is rethrown afterwards.
+   */
+
+  void ReleasePool::releaseAll() {
+    MasterMemoryManager& master = System::getMasterMemoryManager();
+    const kf_int32_t size = _size;
+    _size = 0;
+
+    // Copies of the first failure. Invalid pointers are kept apart so that
+    // they are rethrown with their own type.
+    InvalidPointerException* invalid = NULL;
+    KFException* error = NULL;
+
+    kf_int32_t begin = 0;
+    while(begin < size) {
+      kf_int32_t end = begin + 1;
+      while(end < size && _managers[end] == _managers[begin]) {
+        end++;
+      }
+
+      try {
+        master.getManagerAtIndex(_managers[begin])
+            ->releaseBatch(_indexes + begin, _keys + begin, end - begin);
+      } catch(InvalidPointerException& e) {
+        if(invalid == NULL && error == NULL) {
+          invalid = new InvalidPointerException(e);
+        }
+      } catch(KFException& e) {
+        if(invalid == NULL && error == NULL) {
+          error = new KFException(e);
+        }
+      }
+
+      begin = end;
+    }
+
+    if(invalid != NULL) {
+      InvalidPointerException e(*invalid);
+      delete invalid;
+      throw e;
+    }
+
+    if(error != NULL) {
+      KFException e(*error);
+      delete error;
+      throw e;
+    }
+  }
+
+
+  /**
+   * Applies all recorded releases. Releases caused by the deletion of objects
+   * during draining go to the enclosing pool, or are performed immediately if
+   * there is none. If any release fails, the rest are still applied before
+   * the first exception is rethrown.
+   */
+
+  void ReleasePool::drain() {
+    if(_size == 0) {
+      return;
+    }
+
+    pthread_setspecific(_currentKey, _parent);
+
+    try {
+      releaseAll();
+    } catch(KFException& e) {
+      pthread_setspecific(_currentKey, this);
+      throw;
+    }
+
+    pthread_setspecific(_currentKey, this);
+  }
+
+
+  /**
+   * Returns the number of releases recorded and not yet applied.
+   */
+
+  kf_int32_t ReleasePool::getSize() const {
+    return _size;
+  }
+
+} // namespace kfoundation
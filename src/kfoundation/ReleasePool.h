@@ -0,0 +1,121 @@
+/*---[ReleasePool.h]-------------------------------------------m(._.)m--------*\
+ |
+ |  Project   : KFoundation
+ |  Declares  : kfoundation::ReleasePool::*
+ |  Implements: kfoundation::ReleasePool::defer()
+ |
+ |  Copyright (c) 2013, 2014, 2015, RIKEN (The Institute of Physical and
+ |  Chemial Research) All rights reserved.
+ |
+ |  Author: Hamed KHANDAN (hamed.khandan@port.kobe-u.ac.jp)
+ |
+ |  This file is distributed under the KnoRBA Free Public License. See
+ |  LICENSE.TXT for details.
+ |
+ *//////////////////////////////////////////////////////////////////////////////
+
+#ifndef KFOUNDATION_RELEASEPOOL
+#define KFOUNDATION_RELEASEPOOL
+
+// Posix
+#include <pthread.h>
+
+// Internal
+#include "definitions.h"
+
+namespace kfoundation {
+
+  /**
+   * Defers releases performed by the current thread. While a ReleasePool is
+   * alive, every Ptr released by the thread that created it is recorded in
+   * the pool instead of being released immediately. The recorded releases
+   * are applied when the pool is drained, grouped by memory manager, so each
+   * manager is locked once per batch instead of once per object. The pool is
+   * drained automatically when it is deconstructed, or when its buffer is
+   * full. Usage:
+   *
+   *     {
+   *       ReleasePool pool;
+   *       array->clear();
+   *     } // Objects are released here.
+   *
+   * Objects whose last reference is released inside the scope are kept alive
+   * until the pool is drained. Pools can be nested, in which case releases
+   * are recorded in the innermost one. A pool must be created on stack, and
+   * it has no effect on other threads.
+   *
+   * @ingroup memory
+   * @headerfile ReleasePool.h <kfoundation/ReleasePool.h>
+   */
+
+  class ReleasePool {
+
+  // --- STATIC FIELDS --- //
+
+    public: static const kf_int32_t CAPACITY = 1024;
+    private: static pthread_key_t _currentKey;
+    private: static pthread_once_t _keyOnce;
+    private: static volatile kf_int32_t _nActive;
+
+
+  // --- FIELDS --- //
+
+    private: ReleasePool* _parent;
+    private: kf_int32_t _size;
+    private: kf_int32_t _indexes[CAPACITY];
+    private: kf_objectkey_t _keys[CAPACITY];
+    private: kf_int8_t _managers[CAPACITY];
+
+
+  // --- (DE)CONSTRUCTORS --- //
+
+    public: ReleasePool();
+    public: ~ReleasePool();
+
+
+  // --- STATIC METHODS --- //
+
+    private: static void createKey();
+    private: static bool deferToCurrent(const kf_int8_t manager,
+        const kf_int32_t index, const kf_objectkey_t key);
+
+    public: static inline bool defer(const kf_int8_t manager,
+        const kf_int32_t index, const kf_objectkey_t key);
+
+
+  // --- METHODS --- //
+
+    private: ReleasePool(const ReleasePool&);
+    private: ReleasePool& operator=(const ReleasePool&);
+    private: void releaseAll();
+    public: void drain();
+    public: kf_int32_t getSize() const;
+
+  };
+
+
+// --- INLINE METHODS --- //
+
+  /**
+   * Records a release in the innermost pool of the calling thread, if any.
+   * While no pool exists in the process, this costs a single comparison.
+   *
+   * @param manager The index of the manager owning the object.
+   * @param index The index of the object's record.
+   * @param key The key of the object's record.
+   * @return `true` if the release is deferred, `false` if the caller should
+   *         perform the release itself.
+   */
+
+  inline bool ReleasePool::defer(const kf_int8_t manager,
+      const kf_int32_t index, const kf_objectkey_t key)
+  {
+    if(_nActive == 0) {
+      return false;
+    }
+    return deferToCurrent(manager, index, key);
+  }
+
+} // namespace kfoundation
+
+#endif /* defined(KFOUNDATION_RELEASEPOOL) */
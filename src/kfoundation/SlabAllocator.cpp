@@ -0,0 +1,258 @@
+/*---[SlabAllocator.cpp]---------------------------------------m(._.)m--------*\
+ |
+ |  Project   : KFoundation
+ |  Declares  : -
+ |  Implements: kfoundation::SlabAllocator::*
+ |
+ |  Copyright (c) 2013, 2014, 2015, RIKEN (The Institute of Physical and
+ |  Chemial Research) All rights reserved.
+ |
+ |  Author: Hamed KHANDAN (hamed.khandan@port.kobe-u.ac.jp)
+ |
+ |  This file is distributed under the KnoRBA Free Public License. See
+ |  LICENSE.TXT for details.
+ |
+ *//////////////////////////////////////////////////////////////////////////////
+
+// Std
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+// Posix
+#include <pthread.h>
+
+// Self
+#include "SlabAllocator.h"
+
+namespace kfoundation {
+
+//\/ Internal /\///////////////////////////////////////////////////////////////
+
+  struct __k_SlabBlock {
+    __k_SlabBlock* next;
+  };
+
+
+  /**
+   * Per-thread cache of free blocks, one list for each size class.
+   */
+
+  struct __k_SlabCache {
+    __k_SlabBlock* heads[SlabAllocator::N_SIZE_CLASSES];
+    kf_int32_t counts[SlabAllocator::N_SIZE_CLASSES];
+  };
+
+
+  /**
+   * Shared free list of a size class.
+   */
+
+  struct __k_SlabClass {
+    pthread_mutex_t mutex;
+    __k_SlabBlock* head;
+    kf_int32_t count;
+  };
+
+
+  static __k_SlabClass __k_slabClasses[SlabAllocator::N_SIZE_CLASSES];
+  static pthread_key_t __k_slabCacheKey;
+  static pthread_once_t __k_slabOnce = PTHREAD_ONCE_INIT;
+  static volatile kf_int64_t __k_nSlabs = 0;
+
+
+  /**
+   * Moves up to `n` blocks from the given cache list to the shared list of
+   * the given size class.
+   */
+
+  static void __k_giveBack(__k_SlabCache* cache, const kf_int32_t c,
+      kf_int32_t n)
+  {
+    if(n == 0) {
+      return;
+    }
+
+    __k_SlabBlock* first = cache->heads[c];
+    __k_SlabBlock* last = first;
+    for(kf_int32_t i = 1; i < n; i++) {
+      last = last->next;
+    }
+
+    cache->heads[c] = last->next;
+    cache->counts[c] -= n;
+
+    __k_SlabClass& sc = __k_slabClasses[c];
+    pthread_mutex_lock(&sc.mutex);
+    last->next = sc.head;
+    sc.head = first;
+    sc.count += n;
+    pthread_mutex_unlock(&sc.mutex);
+  }
+
+
+  static void __k_releaseCache(void* arg) {
+    __k_SlabCache* cache = (__k_SlabCache*)arg;
+    for(kf_int32_t c = 0; c < SlabAllocator::N_SIZE_CLASSES; c++) {
+      __k_giveBack(cache, c, cache->counts[c]);
+    }
+    free(cache);
+  }
+
+
+  static void __k_initSlabs() {
+    for(kf_int32_t c = 0; c < SlabAllocator::N_SIZE_CLASSES; c++) {
+      pthread_mutex_init(&__k_slabClasses[c].mutex, NULL);
+      __k_slabClasses[c].head = NULL;
+      __k_slabClasses[c].count = 0;
+    }
+    pthread_key_create(&__k_slabCacheKey, &__k_releaseCache);
+  }
+
+
+  static __k_SlabCache* __k_getCache() {
+    __k_SlabCache* cache
+        = (__k_SlabCache*)pthread_getspecific(__k_slabCacheKey);
+
+    if(cache == NULL) {
+      cache = (__k_SlabCache*)malloc(sizeof(__k_SlabCache));
+      if(cache == NULL) {
+        throw std::bad_alloc();
+      }
+      memset(cache, 0, sizeof(__k_SlabCache));
+      pthread_setspecific(__k_slabCacheKey, cache);
+    }
+
+    return cache;
+  }
+
+
+  /**
+   * Fills an empty cache list with half of CACHE_LIMIT blocks, taken from
+   * the shared list of the size class, or from a new slab if the shared list
+   * is empty.
+   */
+
+  static void __k_refill(__k_SlabCache* cache, const kf_int32_t c) {
+    const kf_int32_t batch = SlabAllocator::CACHE_LIMIT / 2;
+    __k_SlabClass& sc = __k_slabClasses[c];
+
+    pthread_mutex_lock(&sc.mutex);
+    if(sc.head != NULL) {
+      __k_SlabBlock* first = sc.head;
+      __k_SlabBlock* last = first;
+      kf_int32_t n = 1;
+      while(n < batch && last->next != NULL) {
+        last = last->next;
+        n++;
+      }
+      sc.head = last->next;
+      sc.count -= n;
+      pthread_mutex_unlock(&sc.mutex);
+
+      last->next = NULL;
+      cache->heads[c] = first;
+      cache->counts[c] = n;
+      return;
+    }
+    pthread_mutex_unlock(&sc.mutex);
+
+    char* slab = (char*)malloc(SlabAllocator::SLAB_SIZE);
+    if(slab == NULL) {
+      throw std::bad_alloc();
+    }
+    __sync_fetch_and_add(&__k_nSlabs, 1);
+
+    const kf_int32_t blockSize = (c + 1) * SlabAllocator::GRANULARITY;
+    const kf_int32_t nBlocks = SlabAllocator::SLAB_SIZE / blockSize;
+
+    for(kf_int32_t i = 0; i < nBlocks - 1; i++) {
+      ((__k_SlabBlock*)(slab + i * blockSize))->next
+          = (__k_SlabBlock*)(slab + (i + 1) * blockSize);
+    }
+    ((__k_SlabBlock*)(slab + (nBlocks - 1) * blockSize))->next = NULL;
+
+    cache->heads[c] = (__k_SlabBlock*)slab;
+    cache->counts[c] = nBlocks;
+
+    if(nBlocks > SlabAllocator::CACHE_LIMIT) {
+      __k_giveBack(cache, c, nBlocks - batch);
+    }
+  }
+
+
+//\/ SlabAllocator /\//////////////////////////////////////////////////////////
+
+// --- STATIC METHODS --- //
+
+  /**
+   * Allocates a block of at least the given size.
+   *
+   * @param size Number of bytes to allocate.
+   * @return Pointer to the allocated block, aligned to GRANULARITY bytes.
+   * @throw std::bad_alloc if the system is out of memory.
+   */
+
+  void* SlabAllocator::allocate(const size_t size) {
+    if(size > (size_t)MAX_SIZE) {
+      return ::operator new(size);
+    }
+
+    pthread_once(&__k_slabOnce, &__k_initSlabs);
+
+    const kf_int32_t c = size == 0 ? 0 : (kf_int32_t)(size - 1) / GRANULARITY;
+    __k_SlabCache* cache = __k_getCache();
+
+    if(cache->heads[c] == NULL) {
+      __k_refill(cache, c);
+    }
+
+    __k_SlabBlock* block = cache->heads[c];
+    cache->heads[c] = block->next;
+    cache->counts[c]--;
+
+    return block;
+  }
+
+
+  /**
+   * Frees a block allocated by allocate().
+   *
+   * @param block The block to free, or NULL.
+   * @param size The size passed to allocate() when the block was allocated.
+   */
+
+  void SlabAllocator::deallocate(void* const block, const size_t size) {
+    if(block == NULL) {
+      return;
+    }
+
+    if(size > (size_t)MAX_SIZE) {
+      ::operator delete(block);
+      return;
+    }
+
+    const kf_int32_t c = size == 0 ? 0 : (kf_int32_t)(size - 1) / GRANULARITY;
+    __k_SlabCache* cache = __k_getCache();
+
+    __k_SlabBlock* b = (__k_SlabBlock*)block;
+    b->next = cache->heads[c];
+    cache->heads[c] = b;
+    cache->counts[c]++;
+
+    if(cache->counts[c] > CACHE_LIMIT) {
+      __k_giveBack(cache, c, CACHE_LIMIT / 2);
+    }
+  }
+
+
+  /**
+   * Returns the number of slabs obtained from the system so far. Multiplied
+   * by SLAB_SIZE, it gives the memory held by the allocator.
+   */
+
+  kf_int64_t SlabAllocator::getNumberOfSlabs() {
+    return __k_nSlabs;
+  }
+
+} // namespace kfoundation
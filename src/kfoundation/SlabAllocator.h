@@ -0,0 +1,78 @@
+/*---[SlabAllocator.h]-----------------------------------------m(._.)m--------*\
+ |
+ |  Project   : KFoundation
+ |  Declares  : kfoundation::SlabAllocator::*
+ |  Implements: -
+ |
+ |  Copyright (c) 2013, 2014, 2015, RIKEN (The Institute of Physical and
+ |  Chemial Research) All rights reserved.
+ |
+ |  Author: Hamed KHANDAN (hamed.khandan@port.kobe-u.ac.jp)
+ |
+ |  This file is distributed under the KnoRBA Free Public License. See
+ |  LICENSE.TXT for details.
+ |
+ *//////////////////////////////////////////////////////////////////////////////
+
+#ifndef KFOUNDATION_SLABALLOCATOR
+#define KFOUNDATION_SLABALLOCATOR
+
+// Std
+#include <cstddef>
+
+// Internal
+#include "definitions.h"
+
+/**
+ * @def KF_SLAB_ALLOCATOR
+ * When defined, ManagedObject and all its subclasses are allocated by
+ * SlabAllocator instead of the global `new` operator.
+ * @ingroup defs
+ * @ingroup memory
+ */
+
+namespace kfoundation {
+
+  /**
+   * Size-class allocator for small objects. Requested sizes are rounded up
+   * to a multiple of GRANULARITY, and each rounded size is served from its
+   * own free list. Memory is obtained from the system in slabs of SLAB_SIZE
+   * bytes, which are carved into blocks of a single size class.
+   *
+   * Each thread keeps a cache of free blocks for every size class, so that
+   * most allocations and deallocations take no lock. When a cache runs out,
+   * it is refilled with a batch of blocks from the shared free list of the
+   * size class, and when it holds more than CACHE_LIMIT blocks, half of them
+   * are given back. Blocks freed by a thread other than the allocating one
+   * simply join the cache of the freeing thread. The caches of a thread are
+   * returned to the shared lists when the thread exits.
+   *
+   * Requests larger than MAX_SIZE are forwarded to the global `new` operator.
+   * Slabs are never returned to the system.
+   *
+   * @ingroup memory
+   * @headerfile SlabAllocator.h <kfoundation/SlabAllocator.h>
+   */
+
+  class SlabAllocator {
+
+  // --- STATIC FIELDS --- //
+
+    public: static const kf_int32_t GRANULARITY = 16;
+    public: static const kf_int32_t MAX_SIZE = 512;
+    public: static const kf_int32_t N_SIZE_CLASSES = MAX_SIZE / GRANULARITY;
+    public: static const kf_int32_t SLAB_SIZE = 64 * 1024;
+    public: static const kf_int32_t CACHE_LIMIT = 256;
+
+
+  // --- STATIC METHODS --- //
+
+    public: static void* allocate(const size_t size);
+    public: static void deallocate(void* const block, const size_t size);
+    public: static kf_int64_t getNumberOfSlabs();
+
+  };
+
+} // namespace kfoundation
+
+#endif /* defined(KFOUNDATION_SLABALLOCATOR) */
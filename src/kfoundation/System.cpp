@@ -226,7 +226,7 @@ namespace kfoundation {
   #if defined(KF_UNIX)
     Dl_info info;
     int code = dladdr(ptr, &info);
-    if(code != 0) {
+    if(code != 0 && info.dli_sname != NULL) {
       return string(info.dli_sname);
     }
     return "";
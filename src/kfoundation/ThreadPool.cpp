@@ -0,0 +1,315 @@
+/*---[ThreadPool.cpp]------------------------------------------m(._.)m--------*\
+ |
+ |  Project   : KFoundation
+ |  Declares  : kfoundation::ThreadPool::Worker::*
+ |  Implements: kfoundation::ThreadPool::*
+ |              kfoundation::ThreadPool::Worker::*
+ |
+ |  Copyright (c) 2013, 2014, 2015, RIKEN (The Institute of Physical and
+ |  Chemial Research) All rights reserved.
+ |
+ |  Author: Hamed KHANDAN (hamed.khandan@port.kobe-u.ac.jp)
+ |
+ |  This file is distributed under the KnoRBA Free Public License. See
+ |  LICENSE.TXT for details.
+ |
+ *//////////////////////////////////////////////////////////////////////////////
+
+// Posix
+#include <pthread.h>
+#include <unistd.h>
+
+// Internal
+#include "Ptr.h"
+#include "Int.h"
+#include "Thread.h"
+#include "KFException.h"
+
+// Self
+#include "ThreadPool.h"
+
+namespace kfoundation {
+
+//\/ ThreadPool::Worker /\/////////////////////////////////////////////////////
+
+  class ThreadPool::Worker : public Thread {
+    private: ThreadPool& _pool;
+    public: Worker(ThreadPool& pool, const kf_int32_t index);
+    public: void run();
+  };
+
+
+  ThreadPool::Worker::Worker(ThreadPool& pool, const kf_int32_t index)
+  : Thread("ThreadPool Worker " + Int::toString(index)),
+    _pool(pool)
+  {
+    // Nothing;
+  }
+
+
+  void ThreadPool::Worker::run() {
+    _pool.work();
+  }
+
+
+//\/ ThreadPool::RangeTask /\//////////////////////////////////////////////////
+
+  ThreadPool::RangeTask::~RangeTask() {
+    // Nothing;
+  }
+
+
+//\/ ThreadPool /\/////////////////////////////////////////////////////////////
+
+// --- STATIC FIELDS --- //
+
+  ThreadPool* ThreadPool::_default = NULL;
+  pthread_once_t ThreadPool::_defaultOnce = PTHREAD_ONCE_INIT;
+
+
+// --- (DE)CONSTRUCTORS --- //
+
+  /**
+   * Constructor, starts the worker threads.
+   *
+   * @param nThreads The number of threads executing each task, including the
+   *                 thread calling execute(), which means `nThreads - 1`
+   *                 workers are started. If zero, the number of cores is
+   *                 used.
+   */
+
+  ThreadPool::ThreadPool(const kf_int32_t nThreads) {
+    _size = nThreads > 0 ? nThreads : getNumberOfCores();
+    _nWorkers = 0;
+    _nBusy = 0;
+    _generation = 0;
+    _task = NULL;
+    _taskSize = 0;
+    _grain = 1;
+    _nChunks = 0;
+    _nextChunk = 0;
+    _hasFailed = false;
+    _isShuttingDown = false;
+
+    pthread_mutex_init(&_executeMutex, NULL);
+    pthread_mutex_init(&_mutex, NULL);
+    pthread_cond_init(&_taskAvailable, NULL);
+    pthread_cond_init(&_taskDone, NULL);
+    pthread_key_create(&_workerKey, NULL);
+
+    for(kf_int32_t i = 1; i < _size; i++) {
+      Ptr<Worker> worker(new Worker(*this, i));
+      _nWorkers++;
+      worker->start();
+    }
+  }
+
+
+  /**
+   * Deconstructor, stops the worker threads and waits for them to end.
+   * Should not be called while a task is being executed.
+   */
+
+  ThreadPool::~ThreadPool() {
+    pthread_mutex_lock(&_mutex);
+    _isShuttingDown = true;
+    pthread_cond_broadcast(&_taskAvailable);
+    while(_nWorkers > 0) {
+      pthread_cond_wait(&_taskDone, &_mutex);
+    }
+    pthread_mutex_unlock(&_mutex);
+
+    pthread_key_delete(_workerKey);
+    pthread_cond_destroy(&_taskDone);
+    pthread_cond_destroy(&_taskAvailable);
+    pthread_mutex_destroy(&_mutex);
+    pthread_mutex_destroy(&_executeMutex);
+  }
+
+
+// --- STATIC METHODS --- //
+
+  void ThreadPool::createDefault() {
+    _default = new ThreadPool();
+  }
+
+
+  /**
+   * Returns the pool shared by the whole process, with one thread per core.
+   * It is created at the first call, and never deleted.
+   */
+
+  ThreadPool& ThreadPool::getDefault() {
+    pthread_once(&_defaultOnce, &ThreadPool::createDefault);
+    return *_default;
+  }
+
+
+  /**
+   * Returns the number of processor cores online.
+   */
+
+  kf_int32_t ThreadPool::getNumberOfCores() {
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (kf_int32_t)n : 1;
+  }
+
+
+// --- METHODS --- //
+
+  /**
+   * Takes chunks of the current task and runs them until none is left.
+   */
+
+  void ThreadPool::runChunks() {
+    while(true) {
+      kf_int32_t chunk = __sync_fetch_and_add(&_nextChunk, 1);
+      if(chunk >= _nChunks) {
+        return;
+      }
+
+      kf_int32_t begin = chunk * _grain;
+      kf_int32_t end = _taskSize - begin < _grain ? _taskSize : begin + _grain;
+      _task->run(begin, end);
+    }
+  }
+
+
+  /**
+   * Waits for the workers to finish the current task, and allows the next
+   * one to be executed.
+   *
+   * @return `true` if the task failed on a worker.
+   */
+
+  bool ThreadPool::finish() {
+    pthread_mutex_lock(&_mutex);
+    while(_nBusy > 0) {
+      pthread_cond_wait(&_taskDone, &_mutex);
+    }
+    bool hasFailed = _hasFailed;
+    _task = NULL;
+    pthread_mutex_unlock(&_mutex);
+    pthread_mutex_unlock(&_executeMutex);
+    return hasFailed;
+  }
+
+
+  /**
+   * Main loop of the worker threads. Every time the generation changes, the
+   * worker runs chunks of the new task. A worker that starts late sees the
+   * change from generation 0, so it never misses a task.
+   */
+
+  void ThreadPool::work() {
+    pthread_setspecific(_workerKey, this);
+
+    kf_int64_t generation = 0;
+
+    pthread_mutex_lock(&_mutex);
+    while(true) {
+      while(_generation == generation && !_isShuttingDown) {
+        pthread_cond_wait(&_taskAvailable, &_mutex);
+      }
+
+      if(_isShuttingDown) {
+        break;
+      }
+
+      generation = _generation;
+      pthread_mutex_unlock(&_mutex);
+
+      try {
+        runChunks();
+      } catch(...) {
+        _hasFailed = true;
+        _nextChunk = _nChunks;
+      }
+
+      pthread_mutex_lock(&_mutex);
+      _nBusy--;
+      if(_nBusy == 0) {
+        pthread_cond_broadcast(&_taskDone);
+      }
+    }
+
+    _nWorkers--;
+    pthread_cond_broadcast(&_taskDone);
+    pthread_mutex_unlock(&_mutex);
+  }
+
+
+  /**
+   * Checks if the calling thread is a worker of this pool, or is running
+   * chunks of a task in execute().
+   */
+
+  bool ThreadPool::isWorkerThread() const {
+    return pthread_getspecific(_workerKey) == this;
+  }
+
+
+  /**
+   * Executes the given task over `[0, size)`, cut into chunks of `grain`
+   * indexes, and returns once all chunks are done. If the range fits in a
+   * single chunk, the pool has no workers, or this method is called from a
+   * task running on this pool, the whole range is run on the calling thread.
+   *
+   * @param task The task to execute.
+   * @param size The number of indexes.
+   * @param grain The number of indexes in each chunk.
+   * @throw Rethrows the exception thrown by the task on the calling thread,
+   *        or throws KFException if it threw on a worker. In both cases, no
+   *        more chunks are started.
+   */
+
+  void ThreadPool::execute(RangeTask& task, const kf_int32_t size,
+      const kf_int32_t grain)
+  {
+    if(size <= 0) {
+      return;
+    }
+
+    kf_int32_t g = grain < 1 ? 1 : grain;
+
+    if(_nWorkers == 0 || size <= g || isWorkerThread()) {
+      task.run(0, size);
+      return;
+    }
+
+    pthread_mutex_lock(&_executeMutex);
+
+    pthread_mutex_lock(&_mutex);
+    _task = &task;
+    _taskSize = size;
+    _grain = g;
+    _nChunks = (size - 1) / g + 1;
+    _nextChunk = 0;
+    _hasFailed = false;
+    _nBusy = _nWorkers;
+    _generation++;
+    pthread_cond_broadcast(&_taskAvailable);
+    pthread_mutex_unlock(&_mutex);
+
+    // While running chunks, the calling thread counts as a worker, so that
+    // nested calls from the task run serially instead of locking
+    // _executeMutex again.
+    pthread_setspecific(_workerKey, this);
+
+    try {
+      runChunks();
+    } catch(...) {
+      pthread_setspecific(_workerKey, NULL);
+      _nextChunk = _nChunks;
+      finish();
+      throw;
+    }
+
+    pthread_setspecific(_workerKey, NULL);
+
+    if(finish()) {
+      throw KFException("Task failed on a worker thread of the ThreadPool");
+    }
+  }
+
+} // namespace kfoundation
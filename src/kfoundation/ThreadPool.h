@@ -0,0 +1,147 @@
+/*---[ThreadPool.h]--------------------------------------------m(._.)m--------*\
+ |
+ |  Project   : KFoundation
+ |  Declares  : kfoundation::ThreadPool::*
+ |  Implements: kfoundation::ThreadPool::getSize()
+ |
+ |  Copyright (c) 2013, 2014, 2015, RIKEN (The Institute of Physical and
+ |  Chemial Research) All rights reserved.
+ |
+ |  Author: Hamed KHANDAN (hamed.khandan@port.kobe-u.ac.jp)
+ |
+ |  This file is distributed under the KnoRBA Free Public License. See
+ |  LICENSE.TXT for details.
+ |
+ *//////////////////////////////////////////////////////////////////////////////
+
+#ifndef KFOUNDATION_THREADPOOL
+#define KFOUNDATION_THREADPOOL
+
+// Posix
+#include <pthread.h>
+
+// Internal
+#include "definitions.h"
+
+namespace kfoundation {
+
+  /**
+   * Fixed set of worker threads that run data-parallel tasks. A task is a
+   * range of indexes `[0, size)` cut into chunks of `grain` indexes. The
+   * chunks are handed out one at a time to the workers and to the thread
+   * calling execute(), which returns once all of them are done. Usage:
+   *
+   *     class MyTask : public ThreadPool::RangeTask {
+   *       public: void run(const kf_int32_t begin, const kf_int32_t end) {
+   *         // Process [begin, end)
+   *       }
+   *     };
+   *
+   *     MyTask task;
+   *     ThreadPool::getDefault().execute(task, size, 1024);
+   *
+   * The grain should be large enough for a chunk to take much longer than
+   * handing it out, which costs an atomic increment, but small enough to
+   * leave several chunks per thread for load balancing.
+   *
+   * A pool runs one task at a time; concurrent calls to execute() wait for
+   * each other. When called from inside a running task of the same pool,
+   * whether on a worker or on the thread that called execute(), it runs the
+   * whole range on the calling thread. See Parallel for algorithms built on
+   * this class.
+   *
+   * @ingroup thread
+   * @headerfile ThreadPool.h <kfoundation/ThreadPool.h>
+   */
+
+  class ThreadPool {
+
+  // --- NESTED TYPES --- //
+
+    /**
+     * A task to be executed by a ThreadPool.
+     */
+
+    public: class RangeTask {
+      public: virtual ~RangeTask();
+
+      /**
+       * Processes the indexes in `[begin, end)`. Called concurrently for
+       * different chunks.
+       */
+
+      public: virtual void run(const kf_int32_t begin,
+          const kf_int32_t end) = 0;
+    };
+
+    private: class Worker;
+
+
+  // --- STATIC FIELDS --- //
+
+    private: static ThreadPool* _default;
+    private: static pthread_once_t _defaultOnce;
+
+
+  // --- FIELDS --- //
+
+    private: pthread_mutex_t _executeMutex;
+    private: pthread_mutex_t _mutex;
+    private: pthread_cond_t _taskAvailable;
+    private: pthread_cond_t _taskDone;
+    private: pthread_key_t _workerKey;
+    private: kf_int32_t _size;
+    private: kf_int32_t _nWorkers;
+    private: kf_int32_t _nBusy;
+    private: kf_int64_t _generation;
+    private: RangeTask* _task;
+    private: kf_int32_t _taskSize;
+    private: kf_int32_t _grain;
+    private: kf_int32_t _nChunks;
+    private: volatile kf_int32_t _nextChunk;
+    private: volatile bool _hasFailed;
+    private: bool _isShuttingDown;
+
+
+  // --- (DE)CONSTRUCTORS --- //
+
+    public: ThreadPool(const kf_int32_t nThreads = 0);
+    public: ~ThreadPool();
+
+
+  // --- STATIC METHODS --- //
+
+    private: static void createDefault();
+    public: static ThreadPool& getDefault();
+    public: static kf_int32_t getNumberOfCores();
+
+
+  // --- METHODS --- //
+
+    private: ThreadPool(const ThreadPool&);
+    private: ThreadPool& operator=(const ThreadPool&);
+    private: void runChunks();
+    private: bool finish();
+    private: void work();
+    public: inline kf_int32_t getSize() const;
+    public: bool isWorkerThread() const;
+    public: void execute(RangeTask& task, const kf_int32_t size,
+        const kf_int32_t grain);
+
+  };
+
+
+// --- INLINE METHODS --- //
+
+  /**
+   * Returns the number of threads that execute a task, including the
+   * calling thread.
+   */
+
+  inline kf_int32_t ThreadPool::getSize() const {
+    return _size;
+  }
+
+} // namespace kfoundation
+
+#endif /* defined(KFOUNDATION_THREADPOOL) */
@@ -170,7 +170,7 @@ namespace kfoundation {
   throw(IndexOutOfBoundException)
   {
     Ptr<UniChar> ch(new UniChar(getCodePointAt(index)));
-    return ch.retain();
+    return KF_MOVE(ch);
   }
   
   kf_int32_t UniString::getIndexOf(const wchar_t& ch) const {
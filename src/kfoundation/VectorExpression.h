@@ -0,0 +1,344 @@
+/*---[VectorExpression.h]--------------------------------------m(._.)m--------*\
+ |
+ |  Project   : KFoundation
+ |  Declares  : kfoundation::VectorExpression::*
+ |  Implements: kfoundation::VectorExpression::*
+ |              kfoundation::operator+(VectorExpression, VectorExpression)
+ |              kfoundation::operator-(VectorExpression, VectorExpression)
+ |              kfoundation::operator-(VectorExpression)
+ |              kfoundation::operator*(VectorExpression, T)
+ |              kfoundation::operator*(T, VectorExpression)
+ |
+ |  Copyright (c) 2013, 2014, 2015, RIKEN (The Institute of Physical and
+ |  Chemial Research) All rights reserved.
+ |
+ |  Author: Hamed KHANDAN (hamed.khandan@port.kobe-u.ac.jp)
+ |
+ |  This file is distributed under the KnoRBA Free Public License. See
+ |  LICENSE.TXT for details.
+ |
+ *//////////////////////////////////////////////////////////////////////////////
+
+#ifndef KFOUNDATION_VECTOREXPRESSION
+#define KFOUNDATION_VECTOREXPRESSION
+
+// Internal
+#include "definitions.h"
+#include "KFException.h"
+#include "Int.h"
+
+namespace kfoundation {
+
+//\/ Internal /\///////////////////////////////////////////////////////////////
+
+  // Nodes of an expression tree. Each computes one element of its result
+  // at a time from the same element of its operands, so evaluating a tree
+  // takes a single pass, without storing intermediate results.
+
+  template<typename T>
+  class __k_VectorRef {
+    private: const T* _data;
+    private: kf_int32_t _size;
+
+    public: __k_VectorRef(const T* data, const kf_int32_t size)
+    : _data(data), _size(size)
+    {
+      // Nothing;
+    }
+
+    public: inline T at(const kf_int32_t i) const {
+      return _data[i];
+    }
+
+    public: inline kf_int32_t getSize() const {
+      return _size;
+    }
+  };
+
+
+  template<typename T, typename L, typename R>
+  class __k_VectorAdd {
+    private: L _left;
+    private: R _right;
+
+    public: __k_VectorAdd(const L& left, const R& right)
+    : _left(left), _right(right)
+    {
+      // Nothing;
+    }
+
+    public: inline T at(const kf_int32_t i) const {
+      return _left.at(i) + _right.at(i);
+    }
+
+    public: inline kf_int32_t getSize() const {
+      return _left.getSize();
+    }
+  };
+
+
+  template<typename T, typename L, typename R>
+  class __k_VectorSub {
+    private: L _left;
+    private: R _right;
+
+    public: __k_VectorSub(const L& left, const R& right)
+    : _left(left), _right(right)
+    {
+      // Nothing;
+    }
+
+    public: inline T at(const kf_int32_t i) const {
+      return _left.at(i) - _right.at(i);
+    }
+
+    public: inline kf_int32_t getSize() const {
+      return _left.getSize();
+    }
+  };
+
+
+  template<typename T, typename E>
+  class __k_VectorMul {
+    private: E _operand;
+    private: T _coef;
+
+    public: __k_VectorMul(const E& operand, const T& coef)
+    : _operand(operand), _coef(coef)
+    {
+      // Nothing;
+    }
+
+    public: inline T at(const kf_int32_t i) const {
+      return _operand.at(i) * _coef;
+    }
+
+    public: inline kf_int32_t getSize() const {
+      return _operand.getSize();
+    }
+  };
+
+
+  template<typename T, typename E>
+  class __k_VectorNegate {
+    private: E _operand;
+
+    public: __k_VectorNegate(const E& operand)
+    : _operand(operand)
+    {
+      // Nothing;
+    }
+
+    public: inline T at(const kf_int32_t i) const {
+      return -_operand.at(i);
+    }
+
+    public: inline kf_int32_t getSize() const {
+      return _operand.getSize();
+    }
+  };
+
+
+  inline void __k_checkVectorSizes(const kf_int32_t a, const kf_int32_t b) {
+    if(a != b) {
+      throw KFException("Vector size mismatch: " + Int::toString(a) + " and "
+          + Int::toString(b));
+    }
+  }
+
+
+//\/ VectorExpression /\///////////////////////////////////////////////////////
+
+  /**
+   * A lazily evaluated arithmetic expression on vectors with elements of
+   * type `T`. Expressions are obtained with NumericVector::expr() and
+   * combined with `+`, `-` and `*` by a scalar. No computation is done until
+   * the expression is given to a NumericVector, which then computes all its
+   * elements in a single pass, without allocating intermediate vectors:
+   *
+   *     Ptr< NumericVector<float> > r = new NumericVector<float>(
+   *         (a->expr() + b->expr() - c->expr()) * k);
+   *
+   *     r->assign(r->expr() * 2 - a->expr());
+   *
+   * The type `E` describes the shape of the expression, and is not meant to
+   * be spelled out. An expression refers to the memory of the vectors it is
+   * made of, so it should be evaluated before any of them is resized or
+   * deleted; in practice, within the same statement. Since each element of
+   * the result only depends on the same element of the operands, a vector
+   * can be assigned an expression that contains itself.
+   *
+   * The sizes of the operands are checked when they are combined.
+   *
+   * @ingroup containers
+   * @headerfile VectorExpression.h <kfoundation/VectorExpression.h>
+   * @see NumericVector
+   */
+
+  template<typename T, typename E>
+  class VectorExpression {
+
+  // --- NESTED TYPES --- //
+
+    public: typedef T value_t;
+    public: typedef E node_t;
+
+
+  // --- FIELDS --- //
+
+    private: E _node;
+
+
+  // --- (DE)CONSTRUCTORS --- //
+
+    public: VectorExpression(const E& node);
+
+
+  // --- METHODS --- //
+
+    public: inline T at(const kf_int32_t index) const;
+    public: inline kf_int32_t getSize() const;
+    public: inline const E& getNode() const;
+    public: void evaluate(T* result) const;
+
+  };
+
+
+// --- (DE)CONSTRUCTORS --- //
+
+  /**
+   * Constructor, wraps the given tree node.
+   */
+
+  template<typename T, typename E>
+  VectorExpression<T, E>::VectorExpression(const E& node)
+  : _node(node)
+  {
+    // Nothing;
+  }
+
+
+// --- METHODS --- //
+
+  /**
+   * Computes the element at the given index. The index is not checked.
+   */
+
+  template<typename T, typename E>
+  inline T VectorExpression<T, E>::at(const kf_int32_t index) const {
+    return _node.at(index);
+  }
+
+
+  /**
+   * Returns the number of elements of the result.
+   */
+
+  template<typename T, typename E>
+  inline kf_int32_t VectorExpression<T, E>::getSize() const {
+    return _node.getSize();
+  }
+
+
+  /**
+   * Returns the root of the expression tree.
+   */
+
+  template<typename T, typename E>
+  inline const E& VectorExpression<T, E>::getNode() const {
+    return _node;
+  }
+
+
+  /**
+   * Computes all elements in a single pass, and writes them to the given
+   * memory, which should have room for getSize() elements.
+   */
+
+  template<typename T, typename E>
+  void VectorExpression<T, E>::evaluate(T* result) const {
+    kf_int32_t n = _node.getSize();
+    for(kf_int32_t i = 0; i < n; i++) {
+      result[i] = _node.at(i);
+    }
+  }
+
+
+// --- OPERATORS --- //
+
+  /**
+   * Returns the element-wise sum of the given expressions.
+   *
+   * @throw KFException if their sizes are different.
+   */
+
+  template<typename T, typename L, typename R>
+  VectorExpression< T, __k_VectorAdd<T, L, R> >
+  operator+(const VectorExpression<T, L>& left,
+      const VectorExpression<T, R>& right)
+  {
+    __k_checkVectorSizes(left.getSize(), right.getSize());
+    return VectorExpression< T, __k_VectorAdd<T, L, R> >(
+        __k_VectorAdd<T, L, R>(left.getNode(), right.getNode()));
+  }
+
+
+  /**
+   * Returns the element-wise difference of the given expressions.
+   *
+   * @throw KFException if their sizes are different.
+   */
+
+  template<typename T, typename L, typename R>
+  VectorExpression< T, __k_VectorSub<T, L, R> >
+  operator-(const VectorExpression<T, L>& left,
+      const VectorExpression<T, R>& right)
+  {
+    __k_checkVectorSizes(left.getSize(), right.getSize());
+    return VectorExpression< T, __k_VectorSub<T, L, R> >(
+        __k_VectorSub<T, L, R>(left.getNode(), right.getNode()));
+  }
+
+
+  /**
+   * Returns the element-wise negative of the given expression.
+   */
+
+  template<typename T, typename E>
+  VectorExpression< T, __k_VectorNegate<T, E> >
+  operator-(const VectorExpression<T, E>& operand) {
+    return VectorExpression< T, __k_VectorNegate<T, E> >(
+        __k_VectorNegate<T, E>(operand.getNode()));
+  }
+
+
+  /**
+   * Returns the given expression multiplied by the given scalar value.
+   */
+
+  template<typename T, typename E>
+  VectorExpression< T, __k_VectorMul<T, E> >
+  operator*(const VectorExpression<T, E>& operand,
+      const typename VectorExpression<T, E>::value_t& coef)
+  {
+    return VectorExpression< T, __k_VectorMul<T, E> >(
+        __k_VectorMul<T, E>(operand.getNode(), coef));
+  }
+
+
+  /**
+   * Returns the given expression multiplied by the given scalar value.
+   */
+
+  template<typename T, typename E>
+  VectorExpression< T, __k_VectorMul<T, E> >
+  operator*(const typename VectorExpression<T, E>::value_t& coef,
+      const VectorExpression<T, E>& operand)
+  {
+    return VectorExpression< T, __k_VectorMul<T, E> >(
+        __k_VectorMul<T, E>(operand.getNode(), coef));
+  }
+
+} // namespace kfoundation
+
+#endif /* defined(KFOUNDATION_VECTOREXPRESSION) */
@@ -0,0 +1,251 @@
+/*---[VectorKernelLoops.h]-------------------------------------m(._.)m--------*\
+ |
+ |  Project   : KFoundation
+ |  Declares  : kfoundation::__k_VectorKernelTable
+ |              kfoundation::__k_VectorKernelSet
+ |  Implements: kfoundation::__k_*Loop()
+ |              kfoundation::__k_fillVectorKernelTable()
+ |
+ |  Copyright (c) 2013, 2014, 2015, RIKEN (The Institute of Physical and
+ |  Chemial Research) All rights reserved.
+ |
+ |  Author: Hamed KHANDAN (hamed.khandan@port.kobe-u.ac.jp)
+ |
+ |  This file is distributed under the KnoRBA Free Public License. See
+ |  LICENSE.TXT for details.
+ |
+ *//////////////////////////////////////////////////////////////////////////////
+
+// This file is internal to VectorKernels, and is not installed.
+
+#ifndef KFOUNDATION_VECTORKERNELLOOPS
+#define KFOUNDATION_VECTORKERNELLOOPS
+
+#include "definitions.h"
+
+namespace kfoundation {
+
+//\/ Internal /\///////////////////////////////////////////////////////////////
+
+  /**
+   * The kernels of one instruction set for elements of type T.
+   */
+
+  template<typename T>
+  struct __k_VectorKernelTable {
+    void (*add)(const T* a, const T* b, T* result, kf_int32_t n);
+    void (*sub)(const T* a, const T* b, T* result, kf_int32_t n);
+    void (*mul)(const T* a, T coef, T* result, kf_int32_t n);
+    void (*negate)(const T* a, T* result, kf_int32_t n);
+    void (*fma)(const T* a, T coef, const T* b, T* result, kf_int32_t n);
+    T (*dot)(const T* a, const T* b, kf_int32_t n);
+    T (*sum)(const T* a, kf_int32_t n);
+    T (*min)(const T* a, kf_int32_t n);
+    T (*max)(const T* a, kf_int32_t n);
+  };
+
+
+  /**
+   * The kernels of one instruction set for all supported types.
+   */
+
+  struct __k_VectorKernelSet {
+    __k_VectorKernelTable<kf_int32_t> ints;
+    __k_VectorKernelTable<float> floats;
+    __k_VectorKernelTable<double> doubles;
+  };
+
+
+  // The loops below are generic over an instruction set description `I`,
+  // which provides the vector type `vector_t` holding `WIDTH` elements of
+  // type `value_t`, and the operations on it. The remaining elements that do
+  // not fill a vector are handled one by one.
+
+  template<typename I>
+  void __k_addLoop(const typename I::value_t* a,
+      const typename I::value_t* b, typename I::value_t* result, kf_int32_t n)
+  {
+    kf_int32_t i = 0;
+    for(; i + I::WIDTH <= n; i += I::WIDTH) {
+      I::store(result + i, I::add(I::load(a + i), I::load(b + i)));
+    }
+    for(; i < n; i++) {
+      result[i] = a[i] + b[i];
+    }
+  }
+
+
+  template<typename I>
+  void __k_subLoop(const typename I::value_t* a,
+      const typename I::value_t* b, typename I::value_t* result, kf_int32_t n)
+  {
+    kf_int32_t i = 0;
+    for(; i + I::WIDTH <= n; i += I::WIDTH) {
+      I::store(result + i, I::sub(I::load(a + i), I::load(b + i)));
+    }
+    for(; i < n; i++) {
+      result[i] = a[i] - b[i];
+    }
+  }
+
+
+  template<typename I>
+  void __k_mulLoop(const typename I::value_t* a, typename I::value_t coef,
+      typename I::value_t* result, kf_int32_t n)
+  {
+    typename I::vector_t c = I::set(coef);
+    kf_int32_t i = 0;
+    for(; i + I::WIDTH <= n; i += I::WIDTH) {
+      I::store(result + i, I::mul(I::load(a + i), c));
+    }
+    for(; i < n; i++) {
+      result[i] = a[i] * coef;
+    }
+  }
+
+
+  template<typename I>
+  void __k_negateLoop(const typename I::value_t* a,
+      typename I::value_t* result, kf_int32_t n)
+  {
+    kf_int32_t i = 0;
+    for(; i + I::WIDTH <= n; i += I::WIDTH) {
+      I::store(result + i, I::negate(I::load(a + i)));
+    }
+    for(; i < n; i++) {
+      result[i] = -a[i];
+    }
+  }
+
+
+  template<typename I>
+  void __k_fmaLoop(const typename I::value_t* a, typename I::value_t coef,
+      const typename I::value_t* b, typename I::value_t* result,
+      kf_int32_t n)
+  {
+    typename I::vector_t c = I::set(coef);
+    kf_int32_t i = 0;
+    for(; i + I::WIDTH <= n; i += I::WIDTH) {
+      I::store(result + i,
+          I::add(I::mul(I::load(a + i), c), I::load(b + i)));
+    }
+    for(; i < n; i++) {
+      result[i] = a[i] * coef + b[i];
+    }
+  }
+
+
+  // Reductions keep two accumulators, so that consecutive additions do not
+  // wait for each other.
+
+  template<typename I>
+  typename I::value_t __k_dotLoop(const typename I::value_t* a,
+      const typename I::value_t* b, kf_int32_t n)
+  {
+    typename I::vector_t acc0 = I::set(0);
+    typename I::vector_t acc1 = I::set(0);
+    kf_int32_t i = 0;
+    for(; i + 2 * I::WIDTH <= n; i += 2 * I::WIDTH) {
+      acc0 = I::add(acc0, I::mul(I::load(a + i), I::load(b + i)));
+      acc1 = I::add(acc1, I::mul(I::load(a + i + I::WIDTH),
+          I::load(b + i + I::WIDTH)));
+    }
+    for(; i + I::WIDTH <= n; i += I::WIDTH) {
+      acc0 = I::add(acc0, I::mul(I::load(a + i), I::load(b + i)));
+    }
+    typename I::value_t result = I::reduceAdd(I::add(acc0, acc1));
+    for(; i < n; i++) {
+      result += a[i] * b[i];
+    }
+    return result;
+  }
+
+
+  template<typename I>
+  typename I::value_t __k_sumLoop(const typename I::value_t* a, kf_int32_t n)
+  {
+    typename I::vector_t acc0 = I::set(0);
+    typename I::vector_t acc1 = I::set(0);
+    kf_int32_t i = 0;
+    for(; i + 2 * I::WIDTH <= n; i += 2 * I::WIDTH) {
+      acc0 = I::add(acc0, I::load(a + i));
+      acc1 = I::add(acc1, I::load(a + i + I::WIDTH));
+    }
+    for(; i + I::WIDTH <= n; i += I::WIDTH) {
+      acc0 = I::add(acc0, I::load(a + i));
+    }
+    typename I::value_t result = I::reduceAdd(I::add(acc0, acc1));
+    for(; i < n; i++) {
+      result += a[i];
+    }
+    return result;
+  }
+
+
+  // The min and max loops expect at least one element. A NaN element makes
+  // the result NaN; `a[i] != a[i]` detects it in the tail and is always false
+  // for integers.
+
+  template<typename I>
+  typename I::value_t __k_minLoop(const typename I::value_t* a, kf_int32_t n)
+  {
+    typename I::value_t result = a[0];
+    kf_int32_t i = 0;
+    if(n >= I::WIDTH) {
+      typename I::vector_t acc = I::load(a);
+      for(i = I::WIDTH; i + I::WIDTH <= n; i += I::WIDTH) {
+        acc = I::min(acc, I::load(a + i));
+      }
+      result = I::reduceMin(acc);
+    }
+    for(; i < n; i++) {
+      if(a[i] < result || a[i] != a[i]) {
+        result = a[i];
+      }
+    }
+    return result;
+  }
+
+
+  template<typename I>
+  typename I::value_t __k_maxLoop(const typename I::value_t* a, kf_int32_t n)
+  {
+    typename I::value_t result = a[0];
+    kf_int32_t i = 0;
+    if(n >= I::WIDTH) {
+      typename I::vector_t acc = I::load(a);
+      for(i = I::WIDTH; i + I::WIDTH <= n; i += I::WIDTH) {
+        acc = I::max(acc, I::load(a + i));
+      }
+      result = I::reduceMax(acc);
+    }
+    for(; i < n; i++) {
+      if(a[i] > result || a[i] != a[i]) {
+        result = a[i];
+      }
+    }
+    return result;
+  }
+
+
+  template<typename I>
+  void __k_fillVectorKernelTable(
+      __k_VectorKernelTable<typename I::value_t>& table)
+  {
+    table.add = &__k_addLoop<I>;
+    table.sub = &__k_subLoop<I>;
+    table.mul = &__k_mulLoop<I>;
+    table.negate = &__k_negateLoop<I>;
+    table.fma = &__k_fmaLoop<I>;
+    table.dot = &__k_dotLoop<I>;
+    table.sum = &__k_sumLoop<I>;
+    table.min = &__k_minLoop<I>;
+    table.max = &__k_maxLoop<I>;
+  }
+
+
+  bool __k_fillAvx2VectorKernels(__k_VectorKernelSet& set);
+
+} // namespace kfoundation
+
+#endif /* defined(KFOUNDATION_VECTORKERNELLOOPS) */
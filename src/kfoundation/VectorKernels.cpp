@@ -0,0 +1,739 @@
+/*---[VectorKernels.cpp]---------------------------------------m(._.)m--------*\
+ |
+ |  Project   : KFoundation
+ |  Declares  : -
+ |  Implements: kfoundation::VectorKernels::*
+ |
+ |  Copyright (c) 2013, 2014, 2015, RIKEN (The Institute of Physical and
+ |  Chemial Research) All rights reserved.
+ |
+ |  Author: Hamed KHANDAN (hamed.khandan@port.kobe-u.ac.jp)
+ |
+ |  This file is distributed under the KnoRBA Free Public License. See
+ |  LICENSE.TXT for details.
+ |
+ *//////////////////////////////////////////////////////////////////////////////
+
+// Posix
+#include <pthread.h>
+
+// Intel
+#if defined(__i386__) || defined(__x86_64__)
+#  include <cpuid.h>
+#endif
+
+#ifdef __SSE2__
+#  include <emmintrin.h>
+#endif
+
+// Internal
+#include "KFException.h"
+#include "VectorKernelLoops.h"
+
+// Self
+#include "VectorKernels.h"
+
+namespace kfoundation {
+
+//\/ Internal /\///////////////////////////////////////////////////////////////
+
+  /**
+   * Instruction set description for plain loops, one element at a time.
+   */
+
+  template<typename T>
+  struct __k_ScalarIsa {
+    typedef T value_t;
+    typedef T vector_t;
+    static const kf_int32_t WIDTH = 1;
+    static inline T load(const T* p) { return *p; }
+    static inline void store(T* p, const T v) { *p = v; }
+    static inline T set(const T v) { return v; }
+    static inline T add(const T a, const T b) { return a + b; }
+    static inline T sub(const T a, const T b) { return a - b; }
+    static inline T mul(const T a, const T b) { return a * b; }
+    static inline T negate(const T a) { return -a; }
+
+    // A NaN operand makes the result NaN, as in the SIMD descriptions. The
+    // extra comparison is always false for integers.
+    static inline T min(const T a, const T b) {
+      return b < a || b != b ? b : a;
+    }
+
+    static inline T max(const T a, const T b) {
+      return b > a || b != b ? b : a;
+    }
+
+    static inline T reduceAdd(const T v) { return v; }
+    static inline T reduceMin(const T v) { return v; }
+    static inline T reduceMax(const T v) { return v; }
+  };
+
+
+#ifdef __SSE2__
+
+  /**
+   * Instruction set description for SSE2 on `kf_int32_t`. SSE2 lacks 32-bit
+   * multiplication, minimum and maximum, which are composed of other
+   * instructions.
+   */
+
+  struct __k_Sse2IntIsa {
+    typedef kf_int32_t value_t;
+    typedef __m128i vector_t;
+    static const kf_int32_t WIDTH = 4;
+
+    static inline __m128i load(const kf_int32_t* p) {
+      return _mm_loadu_si128((const __m128i*)p);
+    }
+
+    static inline void store(kf_int32_t* p, const __m128i v) {
+      _mm_storeu_si128((__m128i*)p, v);
+    }
+
+    static inline __m128i set(const kf_int32_t v) {
+      return _mm_set1_epi32(v);
+    }
+
+    static inline __m128i add(const __m128i a, const __m128i b) {
+      return _mm_add_epi32(a, b);
+    }
+
+    static inline __m128i sub(const __m128i a, const __m128i b) {
+      return _mm_sub_epi32(a, b);
+    }
+
+    static inline __m128i mul(const __m128i a, const __m128i b) {
+      __m128i even = _mm_mul_epu32(a, b);
+      __m128i odd = _mm_mul_epu32(_mm_srli_si128(a, 4), _mm_srli_si128(b, 4));
+      return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0,0,2,0)),
+          _mm_shuffle_epi32(odd, _MM_SHUFFLE(0,0,2,0)));
+    }
+
+    static inline __m128i negate(const __m128i a) {
+      return _mm_sub_epi32(_mm_setzero_si128(), a);
+    }
+
+    static inline __m128i min(const __m128i a, const __m128i b) {
+      __m128i mask = _mm_cmpgt_epi32(a, b);
+      return _mm_or_si128(_mm_and_si128(mask, b), _mm_andnot_si128(mask, a));
+    }
+
+    static inline __m128i max(const __m128i a, const __m128i b) {
+      __m128i mask = _mm_cmpgt_epi32(a, b);
+      return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+    }
+
+    static inline kf_int32_t reduceAdd(const __m128i v) {
+      kf_int32_t e[4];
+      store(e, v);
+      return e[0] + e[1] + e[2] + e[3];
+    }
+
+    static inline kf_int32_t reduceMin(const __m128i v) {
+      kf_int32_t e[4];
+      store(e, v);
+      return __k_ScalarIsa<kf_int32_t>::min(
+          __k_ScalarIsa<kf_int32_t>::min(e[0], e[1]),
+          __k_ScalarIsa<kf_int32_t>::min(e[2], e[3]));
+    }
+
+    static inline kf_int32_t reduceMax(const __m128i v) {
+      kf_int32_t e[4];
+      store(e, v);
+      return __k_ScalarIsa<kf_int32_t>::max(
+          __k_ScalarIsa<kf_int32_t>::max(e[0], e[1]),
+          __k_ScalarIsa<kf_int32_t>::max(e[2], e[3]));
+    }
+  };
+
+
+  /**
+   * Instruction set description for SSE2 on `float`.
+   */
+
+  struct __k_Sse2FloatIsa {
+    typedef float value_t;
+    typedef __m128 vector_t;
+    static const kf_int32_t WIDTH = 4;
+
+    static inline __m128 load(const float* p) { return _mm_loadu_ps(p); }
+    static inline void store(float* p, const __m128 v) { _mm_storeu_ps(p, v); }
+    static inline __m128 set(const float v) { return _mm_set1_ps(v); }
+
+    static inline __m128 add(const __m128 a, const __m128 b) {
+      return _mm_add_ps(a, b);
+    }
+
+    static inline __m128 sub(const __m128 a, const __m128 b) {
+      return _mm_sub_ps(a, b);
+    }
+
+    static inline __m128 mul(const __m128 a, const __m128 b) {
+      return _mm_mul_ps(a, b);
+    }
+
+    static inline __m128 negate(const __m128 a) {
+      return _mm_xor_ps(a, _mm_set1_ps(-0.0f));
+    }
+
+    static inline __m128 min(const __m128 a, const __m128 b) {
+      return _mm_or_ps(_mm_min_ps(a, b), _mm_cmpunord_ps(a, b));
+    }
+
+    static inline __m128 max(const __m128 a, const __m128 b) {
+      return _mm_or_ps(_mm_max_ps(a, b), _mm_cmpunord_ps(a, b));
+    }
+
+    static inline float reduceAdd(const __m128 v) {
+      float e[4];
+      store(e, v);
+      return (e[0] + e[1]) + (e[2] + e[3]);
+    }
+
+    static inline float reduceMin(const __m128 v) {
+      float e[4];
+      store(e, v);
+      return __k_ScalarIsa<float>::min(__k_ScalarIsa<float>::min(e[0], e[1]),
+          __k_ScalarIsa<float>::min(e[2], e[3]));
+    }
+
+    static inline float reduceMax(const __m128 v) {
+      float e[4];
+      store(e, v);
+      return __k_ScalarIsa<float>::max(__k_ScalarIsa<float>::max(e[0], e[1]),
+          __k_ScalarIsa<float>::max(e[2], e[3]));
+    }
+  };
+
+
+  /**
+   * Instruction set description for SSE2 on `double`.
+   */
+
+  struct __k_Sse2DoubleIsa {
+    typedef double value_t;
+    typedef __m128d vector_t;
+    static const kf_int32_t WIDTH = 2;
+
+    static inline __m128d load(const double* p) { return _mm_loadu_pd(p); }
+
+    static inline void store(double* p, const __m128d v) {
+      _mm_storeu_pd(p, v);
+    }
+
+    static inline __m128d set(const double v) { return _mm_set1_pd(v); }
+
+    static inline __m128d add(const __m128d a, const __m128d b) {
+      return _mm_add_pd(a, b);
+    }
+
+    static inline __m128d sub(const __m128d a, const __m128d b) {
+      return _mm_sub_pd(a, b);
+    }
+
+    static inline __m128d mul(const __m128d a, const __m128d b) {
+      return _mm_mul_pd(a, b);
+    }
+
+    static inline __m128d negate(const __m128d a) {
+      return _mm_xor_pd(a, _mm_set1_pd(-0.0));
+    }
+
+    static inline __m128d min(const __m128d a, const __m128d b) {
+      return _mm_or_pd(_mm_min_pd(a, b), _mm_cmpunord_pd(a, b));
+    }
+
+    static inline __m128d max(const __m128d a, const __m128d b) {
+      return _mm_or_pd(_mm_max_pd(a, b), _mm_cmpunord_pd(a, b));
+    }
+
+    static inline double reduceAdd(const __m128d v) {
+      double e[2];
+      store(e, v);
+      return e[0] + e[1];
+    }
+
+    static inline double reduceMin(const __m128d v) {
+      double e[2];
+      store(e, v);
+      return __k_ScalarIsa<double>::min(e[0], e[1]);
+    }
+
+    static inline double reduceMax(const __m128d v) {
+      double e[2];
+      store(e, v);
+      return __k_ScalarIsa<double>::max(e[0], e[1]);
+    }
+  };
+
+#endif /* defined(__SSE2__) */
+
+
+  static __k_VectorKernelSet __k_vectorKernels;
+  static VectorKernels::isa_t __k_bestIsa;
+  static VectorKernels::isa_t __k_isa;
+  static pthread_once_t __k_vectorKernelsOnce = PTHREAD_ONCE_INIT;
+
+
+  /**
+   * Queries the processor with cpuid. AVX2 is only reported if the
+   * operating system saves the 256-bit registers, and the AVX2 kernels are
+   * compiled in.
+   */
+
+  static VectorKernels::isa_t __k_detectIsa() {
+    VectorKernels::isa_t isa = VectorKernels::SCALAR;
+
+    #if defined(__SSE2__) && (defined(__i386__) || defined(__x86_64__))
+    unsigned int eax, ebx, ecx, edx;
+    if(!__get_cpuid(1, &eax, &ebx, &ecx, &edx) || !(edx & bit_SSE2)) {
+      return isa;
+    }
+
+    isa = VectorKernels::SSE2;
+
+    if(!(ecx & bit_OSXSAVE) || !(ecx & bit_AVX)) {
+      return isa;
+    }
+
+    unsigned int xcr0Low, xcr0High;
+    __asm__("xgetbv" : "=a"(xcr0Low), "=d"(xcr0High) : "c"(0));
+    if((xcr0Low & 6) != 6 || __get_cpuid_max(0, NULL) < 7) {
+      return isa;
+    }
+
+    __cpuid_count(7, 0, eax, ebx, ecx, edx);
+    __k_VectorKernelSet set;
+    if((ebx & bit_AVX2) && __k_fillAvx2VectorKernels(set)) {
+      isa = VectorKernels::AVX2;
+    }
+    #endif
+
+    return isa;
+  }
+
+
+  static void __k_selectVectorKernels(const VectorKernels::isa_t isa) {
+    switch(isa) {
+      case VectorKernels::SCALAR:
+        __k_fillVectorKernelTable< __k_ScalarIsa<kf_int32_t> >(
+            __k_vectorKernels.ints);
+        __k_fillVectorKernelTable< __k_ScalarIsa<float> >(
+            __k_vectorKernels.floats);
+        __k_fillVectorKernelTable< __k_ScalarIsa<double> >(
+            __k_vectorKernels.doubles);
+        break;
+
+      #ifdef __SSE2__
+      case VectorKernels::SSE2:
+        __k_fillVectorKernelTable<__k_Sse2IntIsa>(__k_vectorKernels.ints);
+        __k_fillVectorKernelTable<__k_Sse2FloatIsa>(__k_vectorKernels.floats);
+        __k_fillVectorKernelTable<__k_Sse2DoubleIsa>(
+            __k_vectorKernels.doubles);
+        break;
+      #endif
+
+      case VectorKernels::AVX2:
+        __k_fillAvx2VectorKernels(__k_vectorKernels);
+        break;
+
+      default:
+        break;
+    }
+
+    __k_isa = isa;
+  }
+
+
+  static void __k_initVectorKernels() {
+    __k_bestIsa = __k_detectIsa();
+    __k_selectVectorKernels(__k_bestIsa);
+  }
+
+
+  static inline const __k_VectorKernelSet& __k_getVectorKernels() {
+    pthread_once(&__k_vectorKernelsOnce, __k_initVectorKernels);
+    return __k_vectorKernels;
+  }
+
+
+//\/ VectorKernels /\//////////////////////////////////////////////////////////
+
+// --- STATIC METHODS --- //
+
+  /**
+   * Returns the best instruction set supported by both the processor and
+   * this build of the library.
+   */
+
+  VectorKernels::isa_t VectorKernels::getBestIsa() {
+    pthread_once(&__k_vectorKernelsOnce, __k_initVectorKernels);
+    return __k_bestIsa;
+  }
+
+
+  /**
+   * Returns the instruction set currently used by the kernels.
+   */
+
+  VectorKernels::isa_t VectorKernels::getIsa() {
+    pthread_once(&__k_vectorKernelsOnce, __k_initVectorKernels);
+    return __k_isa;
+  }
+
+
+  /**
+   * Makes the kernels use the given instruction set, for example to compare
+   * their throughput. The instruction set should not be better than
+   * getBestIsa(). This method is not thread-safe, and should not be called
+   * while the kernels are in use.
+   *
+   * @param isa The instruction set to use.
+   * @throw KFException if the instruction set is not supported.
+   */
+
+  void VectorKernels::setIsa(const isa_t isa) {
+    pthread_once(&__k_vectorKernelsOnce, __k_initVectorKernels);
+
+    if(isa > __k_bestIsa) {
+      throw KFException("Instruction set " + isaToString(isa)
+          + " is not supported on this machine");
+    }
+
+    __k_selectVectorKernels(isa);
+  }
+
+
+  /**
+   * Returns the name of the given instruction set.
+   */
+
+  string VectorKernels::isaToString(const isa_t isa) {
+    switch(isa) {
+      case SCALAR:
+        return "SCALAR";
+
+      case SSE2:
+        return "SSE2";
+
+      case AVX2:
+        return "AVX2";
+    }
+    return "UNKNOWN";
+  }
+
+
+  /**
+   * Sets `result[i] = a[i] + b[i]` for `0 <= i < n`.
+   */
+
+  void VectorKernels::add(const kf_int32_t* a, const kf_int32_t* b,
+      kf_int32_t* result, const kf_int32_t n)
+  {
+    __k_getVectorKernels().ints.add(a, b, result, n);
+  }
+
+
+  /**
+   * Sets `result[i] = a[i] + b[i]` for `0 <= i < n`.
+   */
+
+  void VectorKernels::add(const float* a, const float* b, float* result,
+      const kf_int32_t n)
+  {
+    __k_getVectorKernels().floats.add(a, b, result, n);
+  }
+
+
+  /**
+   * Sets `result[i] = a[i] + b[i]` for `0 <= i < n`.
+   */
+
+  void VectorKernels::add(const double* a, const double* b, double* result,
+      const kf_int32_t n)
+  {
+    __k_getVectorKernels().doubles.add(a, b, result, n);
+  }
+
+
+  /**
+   * Sets `result[i] = a[i] - b[i]` for `0 <= i < n`.
+   */
+
+  void VectorKernels::sub(const kf_int32_t* a, const kf_int32_t* b,
+      kf_int32_t* result, const kf_int32_t n)
+  {
+    __k_getVectorKernels().ints.sub(a, b, result, n);
+  }
+
+
+  /**
+   * Sets `result[i] = a[i] - b[i]` for `0 <= i < n`.
+   */
+
+  void VectorKernels::sub(const float* a, const float* b, float* result,
+      const kf_int32_t n)
+  {
+    __k_getVectorKernels().floats.sub(a, b, result, n);
+  }
+
+
+  /**
+   * Sets `result[i] = a[i] - b[i]` for `0 <= i < n`.
+   */
+
+  void VectorKernels::sub(const double* a, const double* b, double* result,
+      const kf_int32_t n)
+  {
+    __k_getVectorKernels().doubles.sub(a, b, result, n);
+  }
+
+
+  /**
+   * Sets `result[i] = a[i] * coef` for `0 <= i < n`.
+   */
+
+  void VectorKernels::mul(const kf_int32_t* a, const kf_int32_t coef,
+      kf_int32_t* result, const kf_int32_t n)
+  {
+    __k_getVectorKernels().ints.mul(a, coef, result, n);
+  }
+
+
+  /**
+   * Sets `result[i] = a[i] * coef` for `0 <= i < n`.
+   */
+
+  void VectorKernels::mul(const float* a, const float coef, float* result,
+      const kf_int32_t n)
+  {
+    __k_getVectorKernels().floats.mul(a, coef, result, n);
+  }
+
+
+  /**
+   * Sets `result[i] = a[i] * coef` for `0 <= i < n`.
+   */
+
+  void VectorKernels::mul(const double* a, const double coef,
+      double* result, const kf_int32_t n)
+  {
+    __k_getVectorKernels().doubles.mul(a, coef, result, n);
+  }
+
+
+  /**
+   * Sets `result[i] = -a[i]` for `0 <= i < n`.
+   */
+
+  void VectorKernels::negate(const kf_int32_t* a, kf_int32_t* result,
+      const kf_int32_t n)
+  {
+    __k_getVectorKernels().ints.negate(a, result, n);
+  }
+
+
+  /**
+   * Sets `result[i] = -a[i]` for `0 <= i < n`.
+   */
+
+  void VectorKernels::negate(const float* a, float* result,
+      const kf_int32_t n)
+  {
+    __k_getVectorKernels().floats.negate(a, result, n);
+  }
+
+
+  /**
+   * Sets `result[i] = -a[i]` for `0 <= i < n`.
+   */
+
+  void VectorKernels::negate(const double* a, double* result,
+      const kf_int32_t n)
+  {
+    __k_getVectorKernels().doubles.negate(a, result, n);
+  }
+
+
+  /**
+   * Sets `result[i] = a[i] * coef + b[i]` for `0 <= i < n`.
+   */
+
+  void VectorKernels::fma(const kf_int32_t* a, const kf_int32_t coef,
+      const kf_int32_t* b, kf_int32_t* result, const kf_int32_t n)
+  {
+    __k_getVectorKernels().ints.fma(a, coef, b, result, n);
+  }
+
+
+  /**
+   * Sets `result[i] = a[i] * coef + b[i]` for `0 <= i < n`.
+   */
+
+  void VectorKernels::fma(const float* a, const float coef, const float* b,
+      float* result, const kf_int32_t n)
+  {
+    __k_getVectorKernels().floats.fma(a, coef, b, result, n);
+  }
+
+
+  /**
+   * Sets `result[i] = a[i] * coef + b[i]` for `0 <= i < n`.
+   */
+
+  void VectorKernels::fma(const double* a, const double coef,
+      const double* b, double* result, const kf_int32_t n)
+  {
+    __k_getVectorKernels().doubles.fma(a, coef, b, result, n);
+  }
+
+
+  /**
+   * Returns the sum of `a[i] * b[i]` for `0 <= i < n`.
+   */
+
+  kf_int32_t VectorKernels::dot(const kf_int32_t* a, const kf_int32_t* b,
+      const kf_int32_t n)
+  {
+    return __k_getVectorKernels().ints.dot(a, b, n);
+  }
+
+
+  /**
+   * Returns the sum of `a[i] * b[i]` for `0 <= i < n`.
+   */
+
+  float VectorKernels::dot(const float* a, const float* b,
+      const kf_int32_t n)
+  {
+    return __k_getVectorKernels().floats.dot(a, b, n);
+  }
+
+
+  /**
+   * Returns the sum of `a[i] * b[i]` for `0 <= i < n`.
+   */
+
+  double VectorKernels::dot(const double* a, const double* b,
+      const kf_int32_t n)
+  {
+    return __k_getVectorKernels().doubles.dot(a, b, n);
+  }
+
+
+  /**
+   * Returns the sum of `a[i]` for `0 <= i < n`.
+   */
+
+  kf_int32_t VectorKernels::sum(const kf_int32_t* a, const kf_int32_t n) {
+    return __k_getVectorKernels().ints.sum(a, n);
+  }
+
+
+  /**
+   * Returns the sum of `a[i]` for `0 <= i < n`.
+   */
+
+  float VectorKernels::sum(const float* a, const kf_int32_t n) {
+    return __k_getVectorKernels().floats.sum(a, n);
+  }
+
+
+  /**
+   * Returns the sum of `a[i]` for `0 <= i < n`.
+   */
+
+  double VectorKernels::sum(const double* a, const kf_int32_t n) {
+    return __k_getVectorKernels().doubles.sum(a, n);
+  }
+
+
+  /**
+   * Returns the smallest of `a[i]` for `0 <= i < n`.
+   *
+   * @throw IndexOutOfBoundException if `n` is zero.
+   */
+
+  kf_int32_t VectorKernels::min(const kf_int32_t* a, const kf_int32_t n) {
+    if(n <= 0) {
+      throw IndexOutOfBoundException("Can't find minimum of an empty array");
+    }
+    return __k_getVectorKernels().ints.min(a, n);
+  }
+
+
+  /**
+   * Returns the smallest of `a[i]` for `0 <= i < n`, or NaN if any of them is
+   * NaN.
+   *
+   * @throw IndexOutOfBoundException if `n` is zero.
+   */
+
+  float VectorKernels::min(const float* a, const kf_int32_t n) {
+    if(n <= 0) {
+      throw IndexOutOfBoundException("Can't find minimum of an empty array");
+    }
+    return __k_getVectorKernels().floats.min(a, n);
+  }
+
+
+  /**
+   * Returns the smallest of `a[i]` for `0 <= i < n`, or NaN if any of them is
+   * NaN.
+   *
+   * @throw IndexOutOfBoundException if `n` is zero.
+   */
+
+  double VectorKernels::min(const double* a, const kf_int32_t n) {
+    if(n <= 0) {
+      throw IndexOutOfBoundException("Can't find minimum of an empty array");
+    }
+    return __k_getVectorKernels().doubles.min(a, n);
+  }
+
+
+  /**
+   * Returns the largest of `a[i]` for `0 <= i < n`.
+   *
+   * @throw IndexOutOfBoundException if `n` is zero.
+   */
+
+  kf_int32_t VectorKernels::max(const kf_int32_t* a, const kf_int32_t n) {
+    if(n <= 0) {
+      throw IndexOutOfBoundException("Can't find maximum of an empty array");
+    }
+    return __k_getVectorKernels().ints.max(a, n);
+  }
+
+
+  /**
+   * Returns the largest of `a[i]` for `0 <= i < n`, or NaN if any of them is
+   * NaN.
+   *
+   * @throw IndexOutOfBoundException if `n` is zero.
+   */
+
+  float VectorKernels::max(const float* a, const kf_int32_t n) {
+    if(n <= 0) {
+      throw IndexOutOfBoundException("Can't find maximum of an empty array");
+    }
+    return __k_getVectorKernels().floats.max(a, n);
+  }
+
+
+  /**
+   * Returns the largest of `a[i]` for `0 <= i < n`, or NaN if any of them is
+   * NaN.
+   *
+   * @throw IndexOutOfBoundException if `n` is zero.
+   */
+
+  double VectorKernels::max(const double* a, const kf_int32_t n) {
+    if(n <= 0) {
+      throw IndexOutOfBoundException("Can't find maximum of an empty array");
+    }
+    return __k_getVectorKernels().doubles.max(a, n);
+  }
+
+} // namespace kfoundation
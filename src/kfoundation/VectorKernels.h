@@ -0,0 +1,325 @@
+/*---[VectorKernels.h]-----------------------------------------m(._.)m--------*\
+ |
+ |  Project   : KFoundation
+ |  Declares  : kfoundation::VectorKernels::*
+ |  Implements: kfoundation::VectorKernels::add<T>()
+ |              kfoundation::VectorKernels::sub<T>()
+ |              kfoundation::VectorKernels::mul<T>()
+ |              kfoundation::VectorKernels::negate<T>()
+ |              kfoundation::VectorKernels::fma<T>()
+ |              kfoundation::VectorKernels::dot<T>()
+ |              kfoundation::VectorKernels::sum<T>()
+ |              kfoundation::VectorKernels::min<T>()
+ |              kfoundation::VectorKernels::max<T>()
+ |
+ |  Copyright (c) 2013, 2014, 2015, RIKEN (The Institute of Physical and
+ |  Chemial Research) All rights reserved.
+ |
+ |  Author: Hamed KHANDAN (hamed.khandan@port.kobe-u.ac.jp)
+ |
+ |  This file is distributed under the KnoRBA Free Public License. See
+ |  LICENSE.TXT for details.
+ |
+ *//////////////////////////////////////////////////////////////////////////////
+
+#ifndef KFOUNDATION_VECTORKERNELS
+#define KFOUNDATION_VECTORKERNELS
+
+// Std
+#include <string>
+
+// Internal
+#include "definitions.h"
+#include "IndexOutOfBoundException.h"
+
+namespace kfoundation {
+
+  using namespace std;
+
+
+  /**
+   * Arithmetic kernels on C-style arrays of numbers, used by NumericVector.
+   * For `kf_int32_t`, `float` and `double`, they process several elements
+   * per instruction using SSE2 or AVX2, whichever is the best supported by
+   * the processor. The choice is made once, at the first call, by querying
+   * the processor with cpuid. Other types are handled by plain loops.
+   *
+   * The result array of add(), sub(), mul(), negate() and fma() may be the
+   * same as one of the operands, which makes the operation in-place:
+   *
+   *     VectorKernels::add(a, b, a, n); // a += b
+   *
+   * All instruction sets give the same results for element-wise
+   * operations. fma() multiplies and adds in two steps, rather than with a
+   * fused instruction. For floating point types, dot() and sum() add the
+   * elements in a different order depending on the instruction set, so
+   * their results may differ in the last bits. For `float` and `double`,
+   * min() and max() return NaN if any of the elements is NaN, with every
+   * instruction set.
+   *
+   * @ingroup containers
+   * @headerfile VectorKernels.h <kfoundation/VectorKernels.h>
+   */
+
+  class VectorKernels {
+
+  // --- NESTED TYPES --- //
+
+    /**
+     * Instruction set used by the kernels.
+     */
+
+    public: typedef enum {
+      SCALAR, ///< One element at a time
+      SSE2,   ///< 128-bit SSE2
+      AVX2    ///< 256-bit AVX2
+    } isa_t;
+
+
+  // --- STATIC METHODS --- //
+
+    public: static isa_t getBestIsa();
+    public: static isa_t getIsa();
+    public: static void setIsa(const isa_t isa);
+    public: static string isaToString(const isa_t isa);
+
+    public: static void add(const kf_int32_t* a, const kf_int32_t* b,
+        kf_int32_t* result, const kf_int32_t n);
+
+    public: static void add(const float* a, const float* b, float* result,
+        const kf_int32_t n);
+
+    public: static void add(const double* a, const double* b, double* result,
+        const kf_int32_t n);
+
+    public: static void sub(const kf_int32_t* a, const kf_int32_t* b,
+        kf_int32_t* result, const kf_int32_t n);
+
+    public: static void sub(const float* a, const float* b, float* result,
+        const kf_int32_t n);
+
+    public: static void sub(const double* a, const double* b, double* result,
+        const kf_int32_t n);
+
+    public: static void mul(const kf_int32_t* a, const kf_int32_t coef,
+        kf_int32_t* result, const kf_int32_t n);
+
+    public: static void mul(const float* a, const float coef, float* result,
+        const kf_int32_t n);
+
+    public: static void mul(const double* a, const double coef,
+        double* result, const kf_int32_t n);
+
+    public: static void negate(const kf_int32_t* a, kf_int32_t* result,
+        const kf_int32_t n);
+
+    public: static void negate(const float* a, float* result,
+        const kf_int32_t n);
+
+    public: static void negate(const double* a, double* result,
+        const kf_int32_t n);
+
+    public: static void fma(const kf_int32_t* a, const kf_int32_t coef,
+        const kf_int32_t* b, kf_int32_t* result, const kf_int32_t n);
+
+    public: static void fma(const float* a, const float coef, const float* b,
+        float* result, const kf_int32_t n);
+
+    public: static void fma(const double* a, const double coef,
+        const double* b, double* result, const kf_int32_t n);
+
+    public: static kf_int32_t dot(const kf_int32_t* a, const kf_int32_t* b,
+        const kf_int32_t n);
+
+    public: static float dot(const float* a, const float* b,
+        const kf_int32_t n);
+
+    public: static double dot(const double* a, const double* b,
+        const kf_int32_t n);
+
+    public: static kf_int32_t sum(const kf_int32_t* a, const kf_int32_t n);
+    public: static float sum(const float* a, const kf_int32_t n);
+    public: static double sum(const double* a, const kf_int32_t n);
+    public: static kf_int32_t min(const kf_int32_t* a, const kf_int32_t n);
+    public: static float min(const float* a, const kf_int32_t n);
+    public: static double min(const double* a, const kf_int32_t n);
+    public: static kf_int32_t max(const kf_int32_t* a, const kf_int32_t n);
+    public: static float max(const float* a, const kf_int32_t n);
+    public: static double max(const double* a, const kf_int32_t n);
+
+    public: template<typename T>
+    static void add(const T* a, const T* b, T* result,
+        const kf_int32_t n);
+
+    public: template<typename T>
+    static void sub(const T* a, const T* b, T* result,
+        const kf_int32_t n);
+
+    public: template<typename T>
+    static void mul(const T* a, const T coef, T* result,
+        const kf_int32_t n);
+
+    public: template<typename T>
+    static void negate(const T* a, T* result, const kf_int32_t n);
+
+    public: template<typename T>
+    static void fma(const T* a, const T coef, const T* b, T* result,
+        const kf_int32_t n);
+
+    public: template<typename T>
+    static T dot(const T* a, const T* b, const kf_int32_t n);
+
+    public: template<typename T>
+    static T sum(const T* a, const kf_int32_t n);
+
+    public: template<typename T>
+    static T min(const T* a, const kf_int32_t n);
+
+    public: template<typename T>
+    static T max(const T* a, const kf_int32_t n);
+
+  };
+
+
+// --- INLINE METHODS --- //
+
+  /**
+   * Sets `result[i] = a[i] + b[i]` for `0 <= i < n`.
+   */
+
+  template<typename T>
+  void VectorKernels::add(const T* a, const T* b, T* result,
+      const kf_int32_t n)
+  {
+    for(kf_int32_t i = 0; i < n; i++) {
+      result[i] = a[i] + b[i];
+    }
+  }
+
+
+  /**
+   * Sets `result[i] = a[i] - b[i]` for `0 <= i < n`.
+   */
+
+  template<typename T>
+  void VectorKernels::sub(const T* a, const T* b, T* result,
+      const kf_int32_t n)
+  {
+    for(kf_int32_t i = 0; i < n; i++) {
+      result[i] = a[i] - b[i];
+    }
+  }
+
+
+  /**
+   * Sets `result[i] = a[i] * coef` for `0 <= i < n`.
+   */
+
+  template<typename T>
+  void VectorKernels::mul(const T* a, const T coef, T* result,
+      const kf_int32_t n)
+  {
+    for(kf_int32_t i = 0; i < n; i++) {
+      result[i] = a[i] * coef;
+    }
+  }
+
+
+  /**
+   * Sets `result[i] = -a[i]` for `0 <= i < n`.
+   */
+
+  template<typename T>
+  void VectorKernels::negate(const T* a, T* result, const kf_int32_t n) {
+    for(kf_int32_t i = 0; i < n; i++) {
+      result[i] = -a[i];
+    }
+  }
+
+
+  /**
+   * Sets `result[i] = a[i] * coef + b[i]` for `0 <= i < n`.
+   */
+
+  template<typename T>
+  void VectorKernels::fma(const T* a, const T coef, const T* b, T* result,
+      const kf_int32_t n)
+  {
+    for(kf_int32_t i = 0; i < n; i++) {
+      result[i] = a[i] * coef + b[i];
+    }
+  }
+
+
+  /**
+   * Returns the sum of `a[i] * b[i]` for `0 <= i < n`.
+   */
+
+  template<typename T>
+  T VectorKernels::dot(const T* a, const T* b, const kf_int32_t n) {
+    T result = 0;
+    for(kf_int32_t i = 0; i < n; i++) {
+      result += a[i] * b[i];
+    }
+    return result;
+  }
+
+
+  /**
+   * Returns the sum of `a[i]` for `0 <= i < n`.
+   */
+
+  template<typename T>
+  T VectorKernels::sum(const T* a, const kf_int32_t n) {
+    T result = 0;
+    for(kf_int32_t i = 0; i < n; i++) {
+      result += a[i];
+    }
+    return result;
+  }
+
+
+  /**
+   * Returns the smallest of `a[i]` for `0 <= i < n`.
+   *
+   * @throw IndexOutOfBoundException if `n` is zero.
+   */
+
+  template<typename T>
+  T VectorKernels::min(const T* a, const kf_int32_t n) {
+    if(n <= 0) {
+      throw IndexOutOfBoundException("Can't find minimum of an empty array");
+    }
+    T result = a[0];
+    for(kf_int32_t i = 1; i < n; i++) {
+      if(a[i] < result) {
+        result = a[i];
+      }
+    }
+    return result;
+  }
+
+
+  /**
+   * Returns the largest of `a[i]` for `0 <= i < n`.
+   *
+   * @throw IndexOutOfBoundException if `n` is zero.
+   */
+
+  template<typename T>
+  T VectorKernels::max(const T* a, const kf_int32_t n) {
+    if(n <= 0) {
+      throw IndexOutOfBoundException("Can't find maximum of an empty array");
+    }
+    T result = a[0];
+    for(kf_int32_t i = 1; i < n; i++) {
+      if(a[i] > result) {
+        result = a[i];
+      }
+    }
+    return result;
+  }
+
+} // namespace kfoundation
+
+#endif /* defined(KFOUNDATION_VECTORKERNELS) */
@@ -0,0 +1,279 @@
+/*---[VectorKernelsAvx2.cpp]-----------------------------------m(._.)m--------*\
+ |
+ |  Project   : KFoundation
+ |  Declares  : -
+ |  Implements: kfoundation::__k_fillAvx2VectorKernels()
+ |
+ |  Copyright (c) 2013, 2014, 2015, RIKEN (The Institute of Physical and
+ |  Chemial Research) All rights reserved.
+ |
+ |  Author: Hamed KHANDAN (hamed.khandan@port.kobe-u.ac.jp)
+ |
+ |  This file is distributed under the KnoRBA Free Public License. See
+ |  LICENSE.TXT for details.
+ |
+ *//////////////////////////////////////////////////////////////////////////////
+
+// This file is compiled with -mavx2 where supported. Its code only runs
+// after VectorKernels has checked that the processor supports AVX2, so it
+// should not include headers with inline functions used elsewhere.
+
+// Intel
+#ifdef __AVX2__
+#  include <immintrin.h>
+#endif
+
+// Internal
+#include "VectorKernelLoops.h"
+
+namespace kfoundation {
+
+#ifdef __AVX2__
+
+//\/ Internal /\///////////////////////////////////////////////////////////////
+
+  // 128-bit minimum and maximum for the horizontal reductions. As with the
+  // vector operations below, a NaN operand makes the result NaN.
+
+  static inline __m128 __k_minPs(const __m128 a, const __m128 b) {
+    return _mm_or_ps(_mm_min_ps(a, b), _mm_cmpunord_ps(a, b));
+  }
+
+  static inline __m128 __k_maxPs(const __m128 a, const __m128 b) {
+    return _mm_or_ps(_mm_max_ps(a, b), _mm_cmpunord_ps(a, b));
+  }
+
+  static inline __m128d __k_minPd(const __m128d a, const __m128d b) {
+    return _mm_or_pd(_mm_min_pd(a, b), _mm_cmpunord_pd(a, b));
+  }
+
+  static inline __m128d __k_maxPd(const __m128d a, const __m128d b) {
+    return _mm_or_pd(_mm_max_pd(a, b), _mm_cmpunord_pd(a, b));
+  }
+
+
+  /**
+   * Instruction set description for AVX2 on `kf_int32_t`.
+   */
+
+  struct __k_Avx2IntIsa {
+    typedef kf_int32_t value_t;
+    typedef __m256i vector_t;
+    static const kf_int32_t WIDTH = 8;
+
+    static inline __m256i load(const kf_int32_t* p) {
+      return _mm256_loadu_si256((const __m256i*)p);
+    }
+
+    static inline void store(kf_int32_t* p, const __m256i v) {
+      _mm256_storeu_si256((__m256i*)p, v);
+    }
+
+    static inline __m256i set(const kf_int32_t v) {
+      return _mm256_set1_epi32(v);
+    }
+
+    static inline __m256i add(const __m256i a, const __m256i b) {
+      return _mm256_add_epi32(a, b);
+    }
+
+    static inline __m256i sub(const __m256i a, const __m256i b) {
+      return _mm256_sub_epi32(a, b);
+    }
+
+    static inline __m256i mul(const __m256i a, const __m256i b) {
+      return _mm256_mullo_epi32(a, b);
+    }
+
+    static inline __m256i negate(const __m256i a) {
+      return _mm256_sub_epi32(_mm256_setzero_si256(), a);
+    }
+
+    static inline __m256i min(const __m256i a, const __m256i b) {
+      return _mm256_min_epi32(a, b);
+    }
+
+    static inline __m256i max(const __m256i a, const __m256i b) {
+      return _mm256_max_epi32(a, b);
+    }
+
+    static inline kf_int32_t reduceAdd(const __m256i v) {
+      __m128i x = _mm_add_epi32(_mm256_castsi256_si128(v),
+          _mm256_extracti128_si256(v, 1));
+      x = _mm_add_epi32(x, _mm_shuffle_epi32(x, _MM_SHUFFLE(1,0,3,2)));
+      x = _mm_add_epi32(x, _mm_shuffle_epi32(x, _MM_SHUFFLE(2,3,0,1)));
+      return _mm_cvtsi128_si32(x);
+    }
+
+    static inline kf_int32_t reduceMin(const __m256i v) {
+      __m128i x = _mm_min_epi32(_mm256_castsi256_si128(v),
+          _mm256_extracti128_si256(v, 1));
+      x = _mm_min_epi32(x, _mm_shuffle_epi32(x, _MM_SHUFFLE(1,0,3,2)));
+      x = _mm_min_epi32(x, _mm_shuffle_epi32(x, _MM_SHUFFLE(2,3,0,1)));
+      return _mm_cvtsi128_si32(x);
+    }
+
+    static inline kf_int32_t reduceMax(const __m256i v) {
+      __m128i x = _mm_max_epi32(_mm256_castsi256_si128(v),
+          _mm256_extracti128_si256(v, 1));
+      x = _mm_max_epi32(x, _mm_shuffle_epi32(x, _MM_SHUFFLE(1,0,3,2)));
+      x = _mm_max_epi32(x, _mm_shuffle_epi32(x, _MM_SHUFFLE(2,3,0,1)));
+      return _mm_cvtsi128_si32(x);
+    }
+  };
+
+
+  /**
+   * Instruction set description for AVX2 on `float`.
+   */
+
+  struct __k_Avx2FloatIsa {
+    typedef float value_t;
+    typedef __m256 vector_t;
+    static const kf_int32_t WIDTH = 8;
+
+    static inline __m256 load(const float* p) { return _mm256_loadu_ps(p); }
+
+    static inline void store(float* p, const __m256 v) {
+      _mm256_storeu_ps(p, v);
+    }
+
+    static inline __m256 set(const float v) { return _mm256_set1_ps(v); }
+
+    static inline __m256 add(const __m256 a, const __m256 b) {
+      return _mm256_add_ps(a, b);
+    }
+
+    static inline __m256 sub(const __m256 a, const __m256 b) {
+      return _mm256_sub_ps(a, b);
+    }
+
+    static inline __m256 mul(const __m256 a, const __m256 b) {
+      return _mm256_mul_ps(a, b);
+    }
+
+    static inline __m256 negate(const __m256 a) {
+      return _mm256_xor_ps(a, _mm256_set1_ps(-0.0f));
+    }
+
+    static inline __m256 min(const __m256 a, const __m256 b) {
+      return _mm256_or_ps(_mm256_min_ps(a, b),
+          _mm256_cmp_ps(a, b, _CMP_UNORD_Q));
+    }
+
+    static inline __m256 max(const __m256 a, const __m256 b) {
+      return _mm256_or_ps(_mm256_max_ps(a, b),
+          _mm256_cmp_ps(a, b, _CMP_UNORD_Q));
+    }
+
+    static inline float reduceAdd(const __m256 v) {
+      __m128 x = _mm_add_ps(_mm256_castps256_ps128(v),
+          _mm256_extractf128_ps(v, 1));
+      x = _mm_add_ps(x, _mm_movehl_ps(x, x));
+      x = _mm_add_ss(x, _mm_shuffle_ps(x, x, _MM_SHUFFLE(1,1,1,1)));
+      return _mm_cvtss_f32(x);
+    }
+
+    static inline float reduceMin(const __m256 v) {
+      __m128 x = __k_minPs(_mm256_castps256_ps128(v),
+          _mm256_extractf128_ps(v, 1));
+      x = __k_minPs(x, _mm_movehl_ps(x, x));
+      x = __k_minPs(x, _mm_shuffle_ps(x, x, _MM_SHUFFLE(1,1,1,1)));
+      return _mm_cvtss_f32(x);
+    }
+
+    static inline float reduceMax(const __m256 v) {
+      __m128 x = __k_maxPs(_mm256_castps256_ps128(v),
+          _mm256_extractf128_ps(v, 1));
+      x = __k_maxPs(x, _mm_movehl_ps(x, x));
+      x = __k_maxPs(x, _mm_shuffle_ps(x, x, _MM_SHUFFLE(1,1,1,1)));
+      return _mm_cvtss_f32(x);
+    }
+  };
+
+
+  /**
+   * Instruction set description for AVX2 on `double`.
+   */
+
+  struct __k_Avx2DoubleIsa {
+    typedef double value_t;
+    typedef __m256d vector_t;
+    static const kf_int32_t WIDTH = 4;
+
+    static inline __m256d load(const double* p) { return _mm256_loadu_pd(p); }
+
+    static inline void store(double* p, const __m256d v) {
+      _mm256_storeu_pd(p, v);
+    }
+
+    static inline __m256d set(const double v) { return _mm256_set1_pd(v); }
+
+    static inline __m256d add(const __m256d a, const __m256d b) {
+      return _mm256_add_pd(a, b);
+    }
+
+    static inline __m256d sub(const __m256d a, const __m256d b) {
+      return _mm256_sub_pd(a, b);
+    }
+
+    static inline __m256d mul(const __m256d a, const __m256d b) {
+      return _mm256_mul_pd(a, b);
+    }
+
+    static inline __m256d negate(const __m256d a) {
+      return _mm256_xor_pd(a, _mm256_set1_pd(-0.0));
+    }
+
+    static inline __m256d min(const __m256d a, const __m256d b) {
+      return _mm256_or_pd(_mm256_min_pd(a, b),
+          _mm256_cmp_pd(a, b, _CMP_UNORD_Q));
+    }
+
+    static inline __m256d max(const __m256d a, const __m256d b) {
+      return _mm256_or_pd(_mm256_max_pd(a, b),
+          _mm256_cmp_pd(a, b, _CMP_UNORD_Q));
+    }
+
+    static inline double reduceAdd(const __m256d v) {
+      __m128d x = _mm_add_pd(_mm256_castpd256_pd128(v),
+          _mm256_extractf128_pd(v, 1));
+      return _mm_cvtsd_f64(_mm_add_sd(x, _mm_unpackhi_pd(x, x)));
+    }
+
+    static inline double reduceMin(const __m256d v) {
+      __m128d x = __k_minPd(_mm256_castpd256_pd128(v),
+          _mm256_extractf128_pd(v, 1));
+      return _mm_cvtsd_f64(__k_minPd(x, _mm_unpackhi_pd(x, x)));
+    }
+
+    static inline double reduceMax(const __m256d v) {
+      __m128d x = __k_maxPd(_mm256_castpd256_pd128(v),
+          _mm256_extractf128_pd(v, 1));
+      return _mm_cvtsd_f64(__k_maxPd(x, _mm_unpackhi_pd(x, x)));
+    }
+  };
+
+#endif /* defined(__AVX2__) */
+
+
+  /**
+   * Fills the given set with the AVX2 kernels.
+   *
+   * @return `false` if the library is built without AVX2 kernels, in which
+   *         case the set is not changed.
+   */
+
+  bool __k_fillAvx2VectorKernels(__k_VectorKernelSet& set) {
+    #ifdef __AVX2__
+    __k_fillVectorKernelTable<__k_Avx2IntIsa>(set.ints);
+    __k_fillVectorKernelTable<__k_Avx2FloatIsa>(set.floats);
+    __k_fillVectorKernelTable<__k_Avx2DoubleIsa>(set.doubles);
+    return true;
+    #else
+    (void)set;
+    return false;
+    #endif
+  }
+
+} // namespace kfoundation
@@ -104,7 +104,7 @@ namespace kfoundation {
   }
   
   Ptr<Token> XmlElement::next() throw(ParseException) {
-    return _owner->next().retain();
+    return KF_MOVE(_owner->next());
   }
   
   void XmlElement::printToStream(ostream &os) const {
@@ -154,7 +154,7 @@ namespace kfoundation {
   }
   
   Ptr<Token> XmlEndElement::next() throw(ParseException) {
-    return _owner->next().retain();
+    return KF_MOVE(_owner->next());
   }
   
   void XmlEndElement::printToStream(ostream &os) const {
@@ -228,7 +228,7 @@ namespace kfoundation {
   }
   
   Ptr<Token> XmlAttribute::next() throw(ParseException) {
-    return _owner->next().retain();
+    return KF_MOVE(_owner->next());
   }
   
   void XmlAttribute::printToStream(ostream &os) const {
@@ -278,7 +278,7 @@ namespace kfoundation {
   }
   
   Ptr<Token> XmlText::next() throw(ParseException) {
-    return _owner->next().retain();
+    return KF_MOVE(_owner->next());
   }
   
   
@@ -336,7 +336,7 @@ namespace kfoundation {
   }
   
   Ptr<Token> XmlCollection::next() throw(ParseException) {
-    return _owner->next().retain();
+    return KF_MOVE(_owner->next());
   }
   
   
@@ -366,7 +366,7 @@ namespace kfoundation {
   }
   
   Ptr<Token> XmlEndCollection::next() throw(ParseException) {
-    return _owner->next().retain();
+    return KF_MOVE(_owner->next());
   }
   
   
@@ -467,7 +467,7 @@ namespace kfoundation {
     }
     
     Ptr<XmlAttribute> attrib = new XmlAttribute(getPtr().AS(XmlObjectStreamReader), CodeRange(begin, end), name, value);
-    return attrib.retain();
+    return KF_MOVE(attrib);
   }
   
   
@@ -530,10 +530,10 @@ namespace kfoundation {
         collection = new XmlCollection(getPtr().AS(XmlObjectStreamReader), element->codeRange);
       }
       element.release();
-      return collection.AS(Token).retain();
+      return KF_MOVE(collection.AS(Token));
     }
     
-    return element.AS(Token).retain();
+    return KF_MOVE(element.AS(Token));
   }
   
   void XmlObjectStreamReader::readStringUnescaped(string& output, const wchar_t& endChar) {
@@ -630,10 +630,10 @@ namespace kfoundation {
     if(endElement->getClassName() == ObjectSerializer::COLLECTION_CLASS_NAME) {
       Ptr<XmlEndCollection> endCollection(
           new XmlEndCollection(getPtr().AS(XmlObjectStreamReader), endElement->codeRange));
-      return endCollection.AS(Token).retain();
+      return KF_MOVE(endCollection.AS(Token));
     }
     
-    return endElement.AS(Token).retain();
+    return KF_MOVE(endElement.AS(Token));
   }
   
   
@@ -650,20 +650,20 @@ namespace kfoundation {
     
     switch (_state) {
       case INITIAL:
-        return readElement().AS(Token).retain();
+        return KF_MOVE(readElement().AS(Token));
       
       case ELEMENT_HEAD: {
         if(!_nextAttrib.isNull()) {
           Ptr<Token> t = _nextAttrib.AS(Token);
           _nextAttrib = NULL;
-          return t.retain();
+          return KF_MOVE(t);
         }
         
         _parser->skipSpacesAndNewLines();
         
         Ptr<XmlAttribute> attr = readAttribute();
         if(!attr.isNull()) {
-          return attr.AS(Token).retain();
+          return KF_MOVE(attr.AS(Token));
         }
         
         if(_parser->testSequence(L"/>")) {
@@ -701,12 +701,12 @@ namespace kfoundation {
         
         Ptr<Token> closeTag = readEndElementOrEndCollection();
         if(!closeTag.isNull()) {
-          return closeTag.retain();
+          return KF_MOVE(closeTag);
         }
         
         Ptr<Token> child = readElementOrCollection();
         if(!child.isNull()) {
-          return child.retain();
+          return KF_MOVE(child);
         }
         
         CodeLocation begin = _parser->getCodeLocation();
@@ -739,12 +739,12 @@ namespace kfoundation {
         
         Ptr<Token> closeTag = readEndElementOrEndCollection();
         if(!closeTag.isNull()) {
-          return closeTag.retain();
+          return KF_MOVE(closeTag);
         }
         
         Ptr<Token> nextElement = readElementOrCollection();
         if(!nextElement.isNull()) {
-          return nextElement.retain();
+          return KF_MOVE(nextElement);
         }
         
         throw ParseException("Open or close tag expected", _parser->getCodeLocation());
@@ -753,12 +753,12 @@ namespace kfoundation {
       case TEXT: {
         Ptr<Token> closeTag = readEndElementOrEndCollection();
         if(!closeTag.isNull()) {
-          return closeTag.retain();
+          return KF_MOVE(closeTag);
         }
         
         Ptr<Token> nextElement = readElementOrCollection();
         if(!nextElement.isNull()) {
-          return nextElement.retain();
+          return KF_MOVE(nextElement);
         }
         
         throw ParseException("Open or close tag expected", _parser->getCodeLocation());
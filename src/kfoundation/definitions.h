@@ -169,6 +169,32 @@
 #define KF_NOP while(false){}
 
 
+/**
+ * @def KF_RVALUE_REFERENCES
+ * @brief is defined when the compiler supports C++11 rvalue references and
+ * move semantics.
+ * @ingroup defs
+ */
+
+#if __cplusplus >= 201103L || defined(__doxygen__)
+#  define KF_RVALUE_REFERENCES
+#endif
+
+
+/**
+ * @def KF_WIDE_OBJECT_RECORD
+ * @brief When defined, memory managers use 32-bit indexes, keys and retain
+ * counts for object records instead of 16-bit ones.
+ * @ingroup defs
+ * @ingroup memory
+ *
+ * The default narrow layout limits each manager to 32768 records and each
+ * object to 32767 references. The wide layout lifts both limits at the cost
+ * of larger records and pointers. All code linked together should be built
+ * with the same setting.
+ */
+
+
 namespace kfoundation {
   
   /**
@@ -222,6 +248,43 @@ namespace kfoundation {
   
   typedef long int kf_int64_t;
   
+  
+#if defined(KF_WIDE_OBJECT_RECORD) || defined(__doxygen__)
+  
+  /**
+   * @brief Index of an object record within the table of its memory manager.
+   * @ingroup defs
+   * @see KF_WIDE_OBJECT_RECORD
+   */
+  
+  typedef kf_int32_t kf_objectindex_t;
+  
+  
+  /**
+   * @brief Key used to validate a pointer against an object record.
+   * @ingroup defs
+   * @see KF_WIDE_OBJECT_RECORD
+   */
+  
+  typedef kf_int32_t kf_objectkey_t;
+  
+  
+  /**
+   * @brief Retain count of a managed object.
+   * @ingroup defs
+   * @see KF_WIDE_OBJECT_RECORD
+   */
+  
+  typedef kf_int32_t kf_retaincount_t;
+  
+#else
+  
+  typedef kf_int16_t kf_objectindex_t;
+  typedef kf_int16_t kf_objectkey_t;
+  typedef kf_int16_t kf_retaincount_t;
+  
+#endif
+  
 } // namespace kfoundation
 
 #endif
\ No newline at end of file